@@ -14,6 +14,7 @@
 #include <qobject.h>
 #include <qtmetamacros.h>
 #include <qvectornd.h>
+#include <utility>
 
 namespace App::Controllers {
 
@@ -60,8 +61,13 @@ auto CommandController::onAttackClick(qreal sx, qreal sy, int viewportWidth,
     return result;
   }
 
-  Game::Systems::CommandService::attack_target(*m_world, selected, target_id,
-                                               true);
+  // Orders run on the sim thread at its next sync point, since they add
+  // and remove components.
+  m_world->commands().defer(
+      [units = selected, target_id](Engine::Core::World &world) {
+        Game::Systems::CommandService::attack_target(world, units, target_id,
+                                                     true);
+      });
 
   emit attack_targetSelected();
 
@@ -88,7 +94,8 @@ auto CommandController::onStopCommand() -> CommandResult {
     }
 
     resetMovement(entity);
-    entity->removeComponent<Engine::Core::AttackTargetComponent>();
+    m_world->commands().removeComponent<Engine::Core::AttackTargetComponent>(
+        id);
 
     if (auto *patrol = entity->getComponent<Engine::Core::PatrolComponent>()) {
       patrol->patrolling = false;
@@ -143,7 +150,8 @@ auto CommandController::onHoldCommand() -> CommandResult {
     }
 
     resetMovement(entity);
-    entity->removeComponent<Engine::Core::AttackTargetComponent>();
+    m_world->commands().removeComponent<Engine::Core::AttackTargetComponent>(
+        id);
 
     if (auto *patrol = entity->getComponent<Engine::Core::PatrolComponent>()) {
       patrol->patrolling = false;
@@ -151,16 +159,22 @@ auto CommandController::onHoldCommand() -> CommandResult {
     }
 
     if (hold_mode == nullptr) {
-      hold_mode = entity->addComponent<Engine::Core::HoldModeComponent>();
+      Engine::Core::HoldModeComponent added;
+      added.active = true;
+      added.exitCooldown = 0.0F;
+      m_world->commands().addComponent<Engine::Core::HoldModeComponent>(
+          id, std::move(added));
+    } else {
+      hold_mode->active = true;
+      hold_mode->exitCooldown = 0.0F;
     }
-    hold_mode->active = true;
-    hold_mode->exitCooldown = 0.0F;
     emit hold_modeChanged(true);
 
     auto *movement = entity->getComponent<Engine::Core::MovementComponent>();
     if (movement != nullptr) {
       movement->hasTarget = false;
       movement->path.clear();
+      movement->flowField.reset();
       movement->pathPending = false;
       movement->vx = 0.0F;
       movement->vz = 0.0F;
@@ -225,22 +239,28 @@ auto CommandController::onPatrolClick(qreal sx, qreal sy, int viewportWidth,
       continue;
     }
 
+    Engine::Core::PatrolComponent added;
     auto *patrol = entity->getComponent<Engine::Core::PatrolComponent>();
-    if (patrol == nullptr) {
-      patrol = entity->addComponent<Engine::Core::PatrolComponent>();
+    bool const missing = patrol == nullptr;
+    if (missing) {
+      patrol = &added;
     }
 
-    if (patrol != nullptr) {
-      patrol->waypoints.clear();
-      patrol->waypoints.emplace_back(m_patrolFirstWaypoint.x(),
-                                     m_patrolFirstWaypoint.z());
-      patrol->waypoints.emplace_back(second_waypoint.x(), second_waypoint.z());
-      patrol->currentWaypoint = 0;
-      patrol->patrolling = true;
+    patrol->waypoints.clear();
+    patrol->waypoints.emplace_back(m_patrolFirstWaypoint.x(),
+                                   m_patrolFirstWaypoint.z());
+    patrol->waypoints.emplace_back(second_waypoint.x(), second_waypoint.z());
+    patrol->currentWaypoint = 0;
+    patrol->patrolling = true;
+
+    if (missing) {
+      m_world->commands().addComponent<Engine::Core::PatrolComponent>(
+          id, std::move(added));
     }
 
     resetMovement(entity);
-    entity->removeComponent<Engine::Core::AttackTargetComponent>();
+    m_world->commands().removeComponent<Engine::Core::AttackTargetComponent>(
+        id);
   }
 
   clearPatrolFirstWaypoint();
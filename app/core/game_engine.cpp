@@ -25,6 +25,7 @@
 #include <QVariant>
 #include <memory>
 #include <optional>
+#include <span>
 #include <qbuffer.h>
 #include <qcoreapplication.h>
 #include <qdir.h>
@@ -45,6 +46,7 @@
 #include "../models/selected_units_model.h"
 #include "game/core/component.h"
 #include "game/core/event_manager.h"
+#include "game/core/profiler.h"
 #include "game/core/world.h"
 #include "game/game_config.h"
 #include "game/map/environment.h"
@@ -76,6 +78,8 @@
 #include "game/systems/production_system.h"
 #include "game/systems/save_load_service.h"
 #include "game/systems/selection_system.h"
+#include "game/systems/spatial_index.h"
+#include "game/systems/spatial_index_system.h"
 #include "game/systems/terrain_alignment_system.h"
 #include "game/systems/troop_count_registry.h"
 #include "game/systems/victory_service.h"
@@ -112,6 +116,11 @@ GameEngine::GameEngine(QObject *parent)
     : QObject(parent),
       m_selectedUnitsModel(new SelectedUnitsModel(this, this)) {
 
+  if (qEnvironmentVariableIsSet("SOI_PROFILE_TRACE")) {
+    Engine::Core::Profiler::setEnabled(true);
+    Engine::Core::Profiler::instance().setThreadName("Main");
+  }
+
   Game::Systems::NationRegistry::instance().initializeDefaults();
   Game::Systems::TroopCountRegistry::instance().initialize();
   Game::Systems::GlobalStatsRegistry::instance().initialize();
@@ -140,7 +149,11 @@ GameEngine::GameEngine(QObject *parent)
       std::make_unique<Game::Systems::ArrowSystem>();
   m_world->addSystem(std::move(arrow_sys));
 
+  // Stages are runs of neighbouring systems without conflicting access, so
+  // this order is the sequential order: arrows share a stage with movement
+  // and terrain alignment with cleanup.
   m_world->addSystem(std::make_unique<Game::Systems::MovementSystem>());
+  m_world->addSystem(std::make_unique<Game::Systems::SpatialIndexSystem>());
   m_world->addSystem(std::make_unique<Game::Systems::PatrolSystem>());
   m_world->addSystem(std::make_unique<Game::Systems::CombatSystem>());
   m_world->addSystem(std::make_unique<Game::Systems::CaptureSystem>());
@@ -268,27 +281,47 @@ GameEngine::GameEngine(QObject *parent)
 
   m_unitDiedSubscription =
       Engine::Core::ScopedEventSubscription<Engine::Core::UnitDiedEvent>(
-          [this](const Engine::Core::UnitDiedEvent &e) {
-            onUnitDied(e);
-            if (e.owner_id != m_runtime.localOwnerId) {
-
-              int const individuals_per_unit =
-                  Game::Units::TroopConfig::instance().getIndividualsPerUnit(
-                      e.spawn_type);
-              m_enemyTroopsDefeated += individuals_per_unit;
+          Engine::Core::kDeferredDispatch,
+          [this](std::span<const Engine::Core::UnitDiedEvent> events) {
+            int defeated = 0;
+            for (const auto &e : events) {
+              onUnitDied(e);
+              if (e.owner_id != m_runtime.localOwnerId) {
+                defeated +=
+                    Game::Units::TroopConfig::instance().getIndividualsPerUnit(
+                        e.spawn_type);
+              }
+            }
+            if (defeated > 0) {
+              m_enemyTroopsDefeated += defeated;
               emit enemyTroopsDefeatedChanged();
             }
           });
 
   m_unitSpawnedSubscription =
       Engine::Core::ScopedEventSubscription<Engine::Core::UnitSpawnedEvent>(
-          [this](const Engine::Core::UnitSpawnedEvent &e) {
-            onUnitSpawned(e);
+          Engine::Core::kDeferredDispatch,
+          [this](std::span<const Engine::Core::UnitSpawnedEvent> events) {
+            for (const auto &e : events) {
+              onUnitSpawned(e);
+            }
           });
 }
 
 GameEngine::~GameEngine() {
 
+  if (Engine::Core::Profiler::isEnabled()) {
+    auto &profiler = Engine::Core::Profiler::instance();
+    profiler.logSummary();
+    profiler.saveChromeTrace(qEnvironmentVariable("SOI_PROFILE_TRACE"));
+
+    if (auto *pathfinder = Game::Systems::CommandService::getPathfinder()) {
+      auto const stats = pathfinder->pathCacheStats();
+      qInfo() << "Path cache hits" << stats.hits << "misses" << stats.misses
+              << "coalesced" << stats.coalesced << "entries" << stats.entries;
+    }
+  }
+
   if (m_audioEventHandler) {
     m_audioEventHandler->shutdown();
   }
@@ -381,9 +414,13 @@ void GameEngine::onRightClick(qreal sx, qreal sy) {
               (target_unit->owner_id != m_runtime.localOwnerId);
 
           if (is_enemy) {
-
-            Game::Systems::CommandService::attack_target(*m_world, sel,
-                                                         target_id, true);
+            // Orders add and remove components, so they run on the sim
+            // thread at its next sync point.
+            m_world->commands().defer(
+                [units = sel, target_id](Engine::Core::World &world) {
+                  Game::Systems::CommandService::attack_target(
+                      world, units, target_id, true);
+                });
             return;
           }
         }
@@ -401,7 +438,13 @@ void GameEngine::onRightClick(qreal sx, qreal sy) {
           Game::GameConfig::instance().gameplay().formationSpacingDefault);
       Game::Systems::CommandService::MoveOptions opts;
       opts.groupMove = sel.size() > 1;
-      Game::Systems::CommandService::moveUnits(*m_world, sel, targets, opts);
+      opts.priority = Game::Systems::PathPriority::Interactive;
+      m_world->commands().defer(
+          [units = sel, targets = std::move(targets),
+           opts](Engine::Core::World &world) {
+            Game::Systems::CommandService::moveUnits(world, units, targets,
+                                                     opts);
+          });
     }
   }
 }
@@ -657,25 +700,40 @@ void GameEngine::update(float dt) {
 
   if (m_world) {
     m_world->update(dt);
+    Engine::Core::EventManager::instance().dispatchDeferred();
 
     auto &visibility_service = Game::Map::VisibilityService::instance();
     if (visibility_service.isInitialized()) {
 
       m_runtime.visibilityUpdateAccumulator += dt;
+      const auto &gameplay = Game::GameConfig::instance().gameplay();
       const float visibility_update_interval =
-          Game::GameConfig::instance().gameplay().visibility_update_interval;
+          gameplay.visibility_update_interval;
       if (m_runtime.visibilityUpdateAccumulator >= visibility_update_interval) {
         m_runtime.visibilityUpdateAccumulator = 0.0F;
+        visibility_service.setTerrainOcclusion(
+            gameplay.vision_terrain_occlusion);
         visibility_service.update(*m_world, m_runtime.localOwnerId);
       }
 
       const auto new_version = visibility_service.version();
       if (new_version != m_runtime.visibilityVersion) {
         if (m_fog) {
-          m_fog->updateMask(visibility_service.getWidth(),
-                            visibility_service.getHeight(),
-                            visibility_service.getTileSize(),
-                            visibility_service.snapshotCells());
+          const int fog_width = visibility_service.getWidth();
+          const int fog_height = visibility_service.getHeight();
+          const float fog_tile_size = visibility_service.getTileSize();
+          auto regions = visibility_service.takeDirtyRegions();
+          if (m_fog->hasMask(fog_width, fog_height, fog_tile_size)) {
+            std::vector<std::uint8_t> region_cells;
+            for (const auto &region : regions) {
+              visibility_service.copyCells(region, region_cells);
+              m_fog->updateRegion(region.min_x, region.min_z, region.max_x,
+                                  region.max_z, region_cells);
+            }
+          } else {
+            m_fog->updateMask(fog_width, fog_height, fog_tile_size,
+                              visibility_service.snapshotCells());
+          }
         }
         m_runtime.visibilityVersion = new_version;
       }
@@ -1136,6 +1194,8 @@ void GameEngine::startSkirmish(const QString &map_path,
       ai_system->reinitialize();
     }
 
+    Engine::Core::EventManager::instance().discardDeferred();
+    Game::Systems::SpatialIndex::instance().rebuild(*m_world);
     rebuildEntityCache();
     auto &troops = Game::Systems::TroopCountRegistry::instance();
     troops.rebuildFromWorld(*m_world);
@@ -1216,6 +1276,8 @@ auto GameEngine::loadFromSlot(const QString &slot) -> bool {
   Game::Map::MapTransformer::setFactoryRegistry(unit_reg);
   qInfo() << "Factory registry reinitialized after loading saved game";
 
+  Engine::Core::EventManager::instance().discardDeferred();
+  Game::Systems::SpatialIndex::instance().rebuild(*m_world);
   rebuildRegistriesAfterLoad();
   rebuildEntityCache();
 
@@ -1484,6 +1546,10 @@ void GameEngine::rebuildRegistriesAfterLoad() {
     }
   }
 
+  if (auto *pathfinder = Game::Systems::CommandService::getPathfinder()) {
+    pathfinder->markTerrainDirty();
+  }
+  Game::Map::VisibilityService::instance().markTerrainDirty();
   rebuildBuildingCollisions();
 
   m_level.playerUnitId = 0;
@@ -18,6 +18,7 @@ inline void resetMovement(Engine::Core::Entity *entity) {
   auto *transform = entity->getComponent<Engine::Core::TransformComponent>();
   movement->hasTarget = false;
   movement->path.clear();
+  movement->flowField.reset();
   movement->pathPending = false;
   movement->pendingRequestId = 0;
   movement->repathCooldown = 0.0F;
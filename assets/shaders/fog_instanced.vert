@@ -8,8 +8,11 @@ layout(location = 3) in vec3 i_center;
 layout(location = 4) in float i_size;
 layout(location = 5) in vec3 i_color;
 layout(location = 6) in float i_alpha;
+layout(location = 8) in vec2 i_fade;
 
 uniform mat4 u_viewProj;
+uniform float u_time;
+uniform float u_fadeDuration;
 
 out vec3 v_worldPos;
 out vec3 v_normal;
@@ -24,7 +27,9 @@ void main() {
   v_worldPos = worldPos;
   v_normal = vec3(0.0, 1.0, 0.0);
   v_color = i_color;
-  v_alpha = i_alpha;
+  float fade = clamp((u_time - i_fade.y) / max(u_fadeDuration, 0.0001), 0.0,
+                     1.0);
+  v_alpha = mix(i_fade.x, i_alpha, fade);
 
   gl_Position = u_viewProj * vec4(worldPos, 1.0);
 }
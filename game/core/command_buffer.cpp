@@ -0,0 +1,86 @@
+#include "command_buffer.h"
+#include "world.h"
+#include <cstdint>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace Engine::Core {
+
+auto CommandBuffer::createEntity() -> EntityID {
+  auto const lock = recordLock();
+  EntityID const placeholder = kPlaceholderBit | m_recording.creates++;
+  m_recording.commands.push_back({Kind::Create, placeholder, 0, 0});
+  return placeholder;
+}
+
+void CommandBuffer::destroyEntity(EntityID entity_id) {
+  auto const lock = recordLock();
+  m_recording.commands.push_back({Kind::Destroy, entity_id, 0, 0});
+}
+
+void CommandBuffer::defer(std::function<void(World &)> fn) {
+  auto const lock = recordLock();
+  auto const index = static_cast<std::uint32_t>(m_recording.deferred.size());
+  m_recording.deferred.push_back(std::move(fn));
+  m_recording.commands.push_back({Kind::Deferred, NULL_ENTITY, 0, index});
+}
+
+void CommandBuffer::playback() {
+  {
+    const std::lock_guard<std::mutex> lock(m_mutex);
+    std::swap(m_recording, m_playing);
+  }
+
+  m_created.clear();
+  for (const auto &command : m_playing.commands) {
+    switch (command.kind) {
+    case Kind::Create:
+      m_created.push_back(m_world->createEntity()->getId());
+      break;
+    case Kind::Destroy:
+      m_world->destroyEntity(resolve(command.entity_id));
+      break;
+    case Kind::Add:
+      if (auto *entity = m_world->getEntity(resolve(command.entity_id))) {
+        m_playing.components[command.type]->add(*entity, command.index);
+      }
+      break;
+    case Kind::Remove:
+      if (auto *entity = m_world->getEntity(resolve(command.entity_id))) {
+        m_playing.components[command.type]->remove(*entity);
+      }
+      break;
+    case Kind::Deferred:
+      m_playing.deferred[command.index](*m_world);
+      break;
+    }
+  }
+  m_playing.clear();
+}
+
+auto CommandBuffer::resolve(EntityID entity_id) const -> EntityID {
+  if ((entity_id & kPlaceholderBit) == 0) {
+    return entity_id;
+  }
+  std::uint32_t const index = entity_id & ~kPlaceholderBit;
+  return index < m_created.size() ? m_created[index] : NULL_ENTITY;
+}
+
+void CommandBuffer::clear() {
+  const std::lock_guard<std::mutex> lock(m_mutex);
+  m_recording.clear();
+}
+
+void CommandBuffer::Recording::clear() {
+  commands.clear();
+  creates = 0;
+  deferred.clear();
+  for (auto &entry : components) {
+    if (entry) {
+      entry->clear();
+    }
+  }
+}
+
+} // namespace Engine::Core
@@ -0,0 +1,150 @@
+#pragma once
+
+#include "component_type.h"
+#include "entity.h"
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace Engine::Core {
+
+class World;
+
+// Records structural changes (create, destroy, add, remove) so systems can
+// keep iterating while they decide what to change. The scheduler gives every
+// system its own buffer and the World keeps one for each thread recording
+// outside a system update; all of them are played back at sync points
+// between scheduler stages, each in the order its commands were recorded.
+// A system's buffer is only recorded into by one thread at a time and only
+// played back while nothing records into it, so recording takes no lock;
+// playback swaps the recording out under one. Per-thread buffers are shared:
+// their thread may keep recording while the sim thread plays them back, so
+// recording into them takes the lock too.
+class CommandBuffer {
+public:
+  // Placeholders returned by createEntity(): this bit plus the index of the
+  // create within the recording. Real entity ids stay below it.
+  static constexpr EntityID kPlaceholderBit = EntityID{1} << 31;
+
+  explicit CommandBuffer(World *world, bool shared = false)
+      : m_world(world), m_shared(shared) {}
+
+  // Real ids are assigned at playback so they do not depend on which thread
+  // recorded first. Until then the returned placeholder is only meaningful
+  // to later commands recorded into this same buffer; on a shared buffer a
+  // playback may fall in between, so record the create and the commands
+  // using it inside one defer() there.
+  auto createEntity() -> EntityID;
+  void destroyEntity(EntityID entity_id);
+
+  template <typename T, typename... Args>
+  void addComponent(EntityID entity_id, Args &&...args) {
+    static_assert(std::is_base_of_v<Component, T>,
+                  "T must inherit from Component");
+    auto const lock = recordLock();
+    std::uint32_t const index = pending<T>().push(std::forward<Args>(args)...);
+    m_recording.commands.push_back(
+        {Kind::Add, entity_id, componentTypeId<T>, index});
+  }
+
+  template <typename T> void removeComponent(EntityID entity_id) {
+    auto const lock = recordLock();
+    pending<T>();
+    m_recording.commands.push_back(
+        {Kind::Remove, entity_id, componentTypeId<T>, 0});
+  }
+
+  void defer(std::function<void(World &)> fn);
+
+  [[nodiscard]] auto empty() -> bool {
+    auto const lock = recordLock();
+    return m_recording.commands.empty();
+  }
+
+  void playback();
+  void clear();
+
+private:
+  enum class Kind : std::uint8_t { Create, Destroy, Add, Remove, Deferred };
+
+  auto resolve(EntityID entity_id) const -> EntityID;
+
+  [[nodiscard]] auto recordLock() -> std::unique_lock<std::mutex> {
+    return m_shared ? std::unique_lock<std::mutex>(m_mutex)
+                    : std::unique_lock<std::mutex>();
+  }
+
+  // Add and remove commands are typed records: the component values wait in
+  // a vector per type and the command keeps their index, or the index of the
+  // deferred function for Deferred.
+  struct Command {
+    Kind kind;
+    EntityID entity_id;
+    ComponentTypeId type;
+    std::uint32_t index;
+  };
+
+  class PendingBase {
+  public:
+    PendingBase() = default;
+    PendingBase(const PendingBase &) = delete;
+    PendingBase(PendingBase &&) = delete;
+    auto operator=(const PendingBase &) -> PendingBase & = delete;
+    auto operator=(PendingBase &&) -> PendingBase & = delete;
+    virtual ~PendingBase() = default;
+
+    virtual void add(Entity &entity, std::uint32_t index) = 0;
+    virtual void remove(Entity &entity) = 0;
+    virtual void clear() = 0;
+  };
+
+  template <typename T> class Pending final : public PendingBase {
+  public:
+    template <typename... Args> auto push(Args &&...args) -> std::uint32_t {
+      m_values.emplace_back(std::forward<Args>(args)...);
+      return static_cast<std::uint32_t>(m_values.size() - 1);
+    }
+
+    void add(Entity &entity, std::uint32_t index) override {
+      entity.addComponent<T>(std::move(m_values[index]));
+    }
+    void remove(Entity &entity) override { entity.removeComponent<T>(); }
+    void clear() override { m_values.clear(); }
+
+  private:
+    std::vector<T> m_values;
+  };
+
+  struct Recording {
+    std::vector<Command> commands;
+    std::uint32_t creates = 0;
+    std::vector<std::function<void(World &)>> deferred;
+    std::array<std::unique_ptr<PendingBase>, kMaxComponentTypes> components;
+
+    void clear();
+  };
+
+  template <typename T> auto pending() -> Pending<T> & {
+    auto &entry = m_recording.components[componentTypeId<T>];
+    if (!entry) {
+      entry = std::make_unique<Pending<T>>();
+    }
+    return static_cast<Pending<T> &>(*entry);
+  }
+
+  World *m_world;
+  bool m_shared;
+  // Playback swaps the two so both keep their capacity between frames.
+  Recording m_recording;
+  Recording m_playing;
+  // Ids assigned to the playing recording's creates, by placeholder index.
+  std::vector<EntityID> m_created;
+  std::mutex m_mutex;
+};
+
+} // namespace Engine::Core
@@ -3,13 +3,19 @@
 #include "../units/spawn_type.h"
 #include "../units/troop_type.h"
 #include "entity.h"
+#include "type_list.h"
 #include <array>
 #include <cstdint>
+#include <memory>
 #include <optional>
 #include <string>
 #include <utility>
 #include <vector>
 
+namespace Game::Systems {
+class FlowField;
+}
+
 namespace Engine::Core {
 
 namespace Defaults {
@@ -91,9 +97,17 @@ public:
   float goalX{0.0F}, goalY{0.0F};
   float vx{0.0F}, vz{0.0F};
   std::vector<std::pair<float, float>> path;
+  // Shared group field followed instead of `path` while set; cleared along
+  // with the path.
+  std::shared_ptr<const Game::Systems::FlowField> flowField;
   bool pathPending{false};
   std::uint64_t pendingRequestId{0};
   float repathCooldown{0.0F};
+  // Segment target and obstacle change count the current segment was last
+  // found clear for.
+  bool segmentChecked{false};
+  float checkedTargetX{0.0F}, checkedTargetY{0.0F};
+  std::uint64_t checkedObstacleChanges{0};
 
   float lastGoalX{0.0F}, lastGoalY{0.0F};
   float timeSinceLastPathRequest{0.0F};
@@ -227,4 +241,21 @@ public:
   float standUpDuration;
 };
 
+using ComponentTypes =
+    TypeList<TransformComponent, RenderableComponent, UnitComponent,
+             MovementComponent, AttackComponent, AttackTargetComponent,
+             PatrolComponent, BuildingComponent, ProductionComponent,
+             AIControlledComponent, CaptureComponent, PendingRemovalComponent,
+             HoldModeComponent>;
+
+static_assert(ComponentTypes::size <= kMaxComponentTypes,
+              "Too many component types for ComponentMask");
+
+template <typename T> struct ComponentTypeInfo {
+  static constexpr auto id =
+      static_cast<ComponentTypeId>(typeIndexOf<T>(ComponentTypes{}));
+  static_assert(id < ComponentTypes::size,
+                "Component type is not registered in ComponentTypes");
+};
+
 } // namespace Engine::Core
@@ -0,0 +1,187 @@
+#pragma once
+
+#include "component_type.h"
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace Engine::Core {
+
+class Entity;
+
+class ComponentPoolBase {
+public:
+  ComponentPoolBase() = default;
+  ComponentPoolBase(const ComponentPoolBase &) = delete;
+  ComponentPoolBase(ComponentPoolBase &&) = delete;
+  auto operator=(const ComponentPoolBase &) -> ComponentPoolBase & = delete;
+  auto operator=(ComponentPoolBase &&) -> ComponentPoolBase & = delete;
+  virtual ~ComponentPoolBase() = default;
+
+  virtual void release(std::uint32_t slot) = 0;
+  [[nodiscard]] virtual auto size() const -> std::size_t = 0;
+};
+
+// Components of one type live in fixed-size pages so iteration walks
+// contiguous memory while addresses stay stable for the raw pointers that
+// systems keep across structural changes. Freed slots are reused before a new
+// page is allocated.
+template <typename T> class ComponentPool final : public ComponentPoolBase {
+public:
+  static constexpr std::uint32_t kPageSize = 256;
+
+  ComponentPool() = default;
+  ComponentPool(const ComponentPool &) = delete;
+  ComponentPool(ComponentPool &&) = delete;
+  auto operator=(const ComponentPool &) -> ComponentPool & = delete;
+  auto operator=(ComponentPool &&) -> ComponentPool & = delete;
+  ~ComponentPool() override {
+    for (std::uint32_t slot = 0; slot < m_highWater; ++slot) {
+      if (ownerAt(slot) != nullptr) {
+        release(slot);
+      }
+    }
+  }
+
+  template <typename... Args>
+  auto emplace(Entity *owner, Args &&...args) -> std::pair<T *, std::uint32_t> {
+    std::uint32_t slot = 0;
+    if (!m_freeSlots.empty()) {
+      slot = m_freeSlots.back();
+    } else {
+      slot = m_highWater;
+      if (slot / kPageSize >= m_pages.size()) {
+        m_pages.push_back(std::make_unique<Page>());
+      }
+    }
+
+    Page &page = *m_pages[slot / kPageSize];
+    std::uint32_t const offset = slot % kPageSize;
+    auto *ptr = ::new (static_cast<void *>(page.cells[offset].bytes))
+        T(std::forward<Args>(args)...);
+
+    if (!m_freeSlots.empty()) {
+      m_freeSlots.pop_back();
+    } else {
+      ++m_highWater;
+    }
+    page.owners[offset] = owner;
+    ++m_size;
+    return {ptr, slot};
+  }
+
+  void release(std::uint32_t slot) override {
+    Page &page = *m_pages[slot / kPageSize];
+    std::uint32_t const offset = slot % kPageSize;
+    if (page.owners[offset] == nullptr) {
+      return;
+    }
+    page.owners[offset] = nullptr;
+    std::destroy_at(componentAt(slot));
+    m_freeSlots.push_back(slot);
+    --m_size;
+  }
+
+  [[nodiscard]] auto size() const -> std::size_t override { return m_size; }
+
+  [[nodiscard]] auto slotCount() const -> std::size_t { return m_highWater; }
+
+  template <typename Fn> void forEach(Fn &&fn) {
+    forEachInSlots(0, m_highWater, fn);
+  }
+
+  template <typename Fn>
+  void forEachInSlots(std::size_t begin, std::size_t end, Fn &&fn) {
+    for (auto slot = static_cast<std::uint32_t>(begin); slot < end; ++slot) {
+      Entity *owner = ownerAt(slot);
+      if (owner != nullptr) {
+        fn(*owner, *componentAt(slot));
+      }
+    }
+  }
+
+private:
+  struct Cell {
+    alignas(T) std::byte bytes[sizeof(T)];
+  };
+
+  struct Page {
+    std::array<Entity *, kPageSize> owners{};
+    std::array<Cell, kPageSize> cells;
+  };
+
+  [[nodiscard]] auto ownerAt(std::uint32_t slot) const -> Entity * {
+    return m_pages[slot / kPageSize]->owners[slot % kPageSize];
+  }
+
+  auto componentAt(std::uint32_t slot) -> T * {
+    return std::launder(reinterpret_cast<T *>(
+        m_pages[slot / kPageSize]->cells[slot % kPageSize].bytes));
+  }
+
+  std::vector<std::unique_ptr<Page>> m_pages;
+  std::vector<std::uint32_t> m_freeSlots;
+  std::uint32_t m_highWater = 0;
+  std::size_t m_size = 0;
+};
+
+class ComponentStorage {
+public:
+  using ChangeListener =
+      std::function<void(Entity &entity, ComponentTypeId type)>;
+  using ChangeCheck = std::function<bool()>;
+
+  void setChangeListener(ChangeListener listener) {
+    m_changeListener = std::move(listener);
+  }
+
+  // Adding or removing a component locks `mutex`, so the pools, the entity's
+  // own mask and the queries change together. Debug builds also assert that
+  // `check` allows the calling thread to change structure at all.
+  void setChangeGuard(std::recursive_mutex *mutex, ChangeCheck check) {
+    m_mutex = mutex;
+    m_changeCheck = std::move(check);
+  }
+
+  [[nodiscard]] auto lockForChange() const
+      -> std::unique_lock<std::recursive_mutex> {
+    assert(!m_changeCheck || m_changeCheck());
+    if (m_mutex == nullptr) {
+      return {};
+    }
+    return std::unique_lock<std::recursive_mutex>(*m_mutex);
+  }
+
+  void notifyChanged(Entity &entity, ComponentTypeId type) const {
+    if (m_changeListener) {
+      m_changeListener(entity, type);
+    }
+  }
+
+  template <typename T> auto pool() -> ComponentPool<T> & {
+    auto &entry = m_pools[componentTypeId<T>];
+    if (!entry) {
+      entry = std::make_unique<ComponentPool<T>>();
+    }
+    return static_cast<ComponentPool<T> &>(*entry);
+  }
+
+  template <typename T> auto findPool() -> ComponentPool<T> * {
+    return static_cast<ComponentPool<T> *>(m_pools[componentTypeId<T>].get());
+  }
+
+private:
+  std::array<std::unique_ptr<ComponentPoolBase>, kMaxComponentTypes> m_pools;
+  ChangeListener m_changeListener;
+  std::recursive_mutex *m_mutex = nullptr;
+  ChangeCheck m_changeCheck;
+};
+
+} // namespace Engine::Core
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Engine::Core {
+
+using ComponentTypeId = std::uint32_t;
+using ComponentMask = std::uint64_t;
+
+constexpr std::size_t kMaxComponentTypes = 64;
+
+// Defined in component.h over the registered component list, so every
+// component type has a dense compile-time id usable as a mask bit.
+template <typename T> struct ComponentTypeInfo;
+
+template <typename T>
+constexpr ComponentTypeId componentTypeId = ComponentTypeInfo<T>::id;
+
+template <typename... Ts> constexpr auto componentMask() -> ComponentMask {
+  return (ComponentMask{0} | ... | (ComponentMask{1} << componentTypeId<Ts>));
+}
+
+} // namespace Engine::Core
@@ -2,7 +2,14 @@
 
 namespace Engine::Core {
 
-Entity::Entity(EntityID id) : m_id(id) {}
+Entity::Entity(EntityID id, ComponentStorage *storage)
+    : m_id(id), m_storage(storage) {}
+
+Entity::~Entity() {
+  for (auto &entry : m_components) {
+    entry.pool->release(entry.slot);
+  }
+}
 
 auto Entity::getId() const -> EntityID { return m_id; }
 
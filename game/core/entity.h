@@ -1,10 +1,11 @@
 #pragma once
 
+#include "component_pool.h"
+#include "component_type.h"
+#include <bit>
+#include <cstddef>
 #include <cstdint>
-#include <memory>
 #include <type_traits>
-#include <typeindex>
-#include <unordered_map>
 #include <vector>
 
 namespace Engine::Core {
@@ -19,7 +20,13 @@ public:
 
 class Entity {
 public:
-  Entity(EntityID id);
+  Entity(EntityID id, ComponentStorage *storage);
+  ~Entity();
+
+  Entity(const Entity &) = delete;
+  Entity(Entity &&) = delete;
+  auto operator=(const Entity &) -> Entity & = delete;
+  auto operator=(Entity &&) -> Entity & = delete;
 
   auto getId() const -> EntityID;
 
@@ -27,39 +34,80 @@ public:
   auto addComponent(Args &&...args) -> T * {
     static_assert(std::is_base_of_v<Component, T>,
                   "T must inherit from Component");
-    auto component = std::make_unique<T>(std::forward<Args>(args)...);
-    auto ptr = component.get();
-    m_components[std::type_index(typeid(T))] = std::move(component);
+    constexpr ComponentTypeId type = componentTypeId<T>;
+    auto const lock = m_storage->lockForChange();
+    auto &pool = m_storage->pool<T>();
+    auto [ptr, slot] = pool.emplace(this, std::forward<Args>(args)...);
+    ComponentSlot const entry{ptr, &pool, slot};
+    std::size_t const index = slotIndex(type);
+    if (hasType(type)) {
+      m_components[index].pool->release(m_components[index].slot);
+      m_components[index] = entry;
+    } else {
+      m_components.insert(m_components.begin() + index, entry);
+      m_mask |= ComponentMask{1} << type;
+    }
+    m_storage->notifyChanged(*this, type);
     return ptr;
   }
 
   template <typename T> auto getComponent() -> T * {
-    auto it = m_components.find(std::type_index(typeid(T)));
-    if (it != m_components.end()) {
-      return static_cast<T *>(it->second.get());
+    constexpr ComponentTypeId type = componentTypeId<T>;
+    if (!hasType(type)) {
+      return nullptr;
     }
-    return nullptr;
+    return static_cast<T *>(m_components[slotIndex(type)].component);
   }
 
   template <typename T> auto getComponent() const -> const T * {
-    auto it = m_components.find(std::type_index(typeid(T)));
-    if (it != m_components.end()) {
-      return static_cast<const T *>(it->second.get());
+    constexpr ComponentTypeId type = componentTypeId<T>;
+    if (!hasType(type)) {
+      return nullptr;
     }
-    return nullptr;
+    return static_cast<const T *>(m_components[slotIndex(type)].component);
   }
 
   template <typename T> void removeComponent() {
-    m_components.erase(std::type_index(typeid(T)));
+    constexpr ComponentTypeId type = componentTypeId<T>;
+    auto const lock = m_storage->lockForChange();
+    if (!hasType(type)) {
+      return;
+    }
+    auto it = m_components.begin() + slotIndex(type);
+    it->pool->release(it->slot);
+    m_components.erase(it);
+    m_mask &= ~(ComponentMask{1} << type);
+    m_storage->notifyChanged(*this, type);
   }
 
   template <typename T> auto hasComponent() const -> bool {
-    return m_components.find(std::type_index(typeid(T))) != m_components.end();
+    return hasType(componentTypeId<T>);
   }
 
+  [[nodiscard]] auto componentMask() const -> ComponentMask { return m_mask; }
+
 private:
+  struct ComponentSlot {
+    Component *component = nullptr;
+    ComponentPoolBase *pool = nullptr;
+    std::uint32_t slot = 0;
+  };
+
+  [[nodiscard]] auto hasType(ComponentTypeId type) const -> bool {
+    return ((m_mask >> type) & 1U) != 0;
+  }
+
+  // Components are packed in type-id order, so a type's position is the
+  // number of lower ids present in the mask.
+  [[nodiscard]] auto slotIndex(ComponentTypeId type) const -> std::size_t {
+    return static_cast<std::size_t>(
+        std::popcount(m_mask & ((ComponentMask{1} << type) - 1)));
+  }
+
   EntityID m_id;
-  std::unordered_map<std::type_index, std::unique_ptr<Component>> m_components;
+  ComponentStorage *m_storage;
+  ComponentMask m_mask = 0;
+  std::vector<ComponentSlot> m_components;
 };
 
 } // namespace Engine::Core
@@ -0,0 +1,137 @@
+#include "entity_slot_map.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+
+namespace Engine::Core {
+
+EntitySlotMap::EntitySlotMap(ComponentStorage *storage) : m_storage(storage) {}
+
+EntitySlotMap::~EntitySlotMap() { clear(); }
+
+auto EntitySlotMap::create(EntityID entity_id) -> Entity * {
+  if (entity_id == NULL_ENTITY) {
+    return nullptr;
+  }
+
+  if (std::uint32_t const existing = slotOf(entity_id);
+      existing != EntityHandle::kInvalidIndex) {
+    destroySlot(existing);
+  }
+
+  std::uint32_t slot = 0;
+  if (!m_freeSlots.empty()) {
+    slot = m_freeSlots.back();
+    m_freeSlots.pop_back();
+  } else {
+    slot = static_cast<std::uint32_t>(m_slots.size());
+    m_slots.emplace_back();
+    if (slot / kPageSize >= m_pages.size()) {
+      m_pages.push_back(std::make_unique<Page>());
+    }
+  }
+
+  setSlotOf(entity_id, slot);
+
+  Slot &entry = m_slots[slot];
+  entry.entity_id = entity_id;
+  entry.retired = false;
+  ++m_size;
+
+  void *memory = m_pages[slot / kPageSize]->cells[slot % kPageSize].bytes;
+  return ::new (memory) Entity(entity_id, m_storage);
+}
+
+void EntitySlotMap::destroy(EntityID entity_id) {
+  std::uint32_t const slot = slotOf(entity_id);
+  if (slot != EntityHandle::kInvalidIndex) {
+    destroySlot(slot);
+  }
+}
+
+void EntitySlotMap::clear() {
+  for (std::uint32_t slot = 0; slot < m_slots.size(); ++slot) {
+    if (m_slots[slot].entity_id != NULL_ENTITY) {
+      destroySlot(slot);
+    }
+  }
+  m_freeSlots.clear();
+  for (auto slot = static_cast<std::uint32_t>(m_slots.size()); slot > 0;
+       --slot) {
+    m_freeSlots.push_back(slot - 1);
+  }
+  m_idPages.clear();
+  m_sparseSlots.clear();
+}
+
+auto EntitySlotMap::handleOf(EntityID entity_id) const -> EntityHandle {
+  std::uint32_t const slot = slotOf(entity_id);
+  if (slot == EntityHandle::kInvalidIndex) {
+    return {};
+  }
+  return {slot, m_slots[slot].generation};
+}
+
+auto EntitySlotMap::resolve(EntityHandle handle) const -> Entity * {
+  if (handle.index >= m_slots.size()) {
+    return nullptr;
+  }
+  const Slot &entry = m_slots[handle.index];
+  if (entry.entity_id == NULL_ENTITY || entry.retired ||
+      entry.generation != handle.generation) {
+    return nullptr;
+  }
+  return entityAt(handle.index);
+}
+
+void EntitySlotMap::setRetired(EntityID entity_id, bool retired) {
+  std::uint32_t const slot = slotOf(entity_id);
+  if (slot != EntityHandle::kInvalidIndex) {
+    m_slots[slot].retired = retired;
+  }
+}
+
+auto EntitySlotMap::sparseSlotOf(EntityID entity_id) const
+    -> std::uint32_t {
+  auto it = m_sparseSlots.find(entity_id);
+  return it == m_sparseSlots.end() ? EntityHandle::kInvalidIndex : it->second;
+}
+
+void EntitySlotMap::setSlotOf(EntityID entity_id, std::uint32_t slot) {
+  if (entity_id >= kDenseIdLimit) {
+    if (slot == EntityHandle::kInvalidIndex) {
+      m_sparseSlots.erase(entity_id);
+    } else {
+      m_sparseSlots[entity_id] = slot;
+    }
+    return;
+  }
+  std::size_t const page = entity_id >> kIdPageShift;
+  if (page >= m_idPages.size()) {
+    m_idPages.resize(page + 1);
+  }
+  if (!m_idPages[page]) {
+    m_idPages[page] = std::make_unique<IdPage>();
+    m_idPages[page]->fill(EntityHandle::kInvalidIndex);
+  }
+  (*m_idPages[page])[entity_id & (kIdPageSize - 1)] = slot;
+}
+
+auto EntitySlotMap::entityAt(std::uint32_t slot) const -> Entity * {
+  auto *bytes = m_pages[slot / kPageSize]->cells[slot % kPageSize].bytes;
+  return std::launder(reinterpret_cast<Entity *>(bytes));
+}
+
+void EntitySlotMap::destroySlot(std::uint32_t slot) {
+  Slot &entry = m_slots[slot];
+  std::destroy_at(entityAt(slot));
+  setSlotOf(entry.entity_id, EntityHandle::kInvalidIndex);
+  entry.entity_id = NULL_ENTITY;
+  entry.retired = false;
+  ++entry.generation;
+  m_freeSlots.push_back(slot);
+  --m_size;
+}
+
+} // namespace Engine::Core
@@ -0,0 +1,122 @@
+#pragma once
+
+#include "entity.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace Engine::Core {
+
+struct EntityHandle {
+  static constexpr std::uint32_t kInvalidIndex =
+      std::numeric_limits<std::uint32_t>::max();
+
+  std::uint32_t index = kInvalidIndex;
+  std::uint32_t generation = 0;
+
+  [[nodiscard]] auto isValid() const -> bool { return index != kInvalidIndex; }
+  auto operator==(const EntityHandle &other) const -> bool = default;
+};
+
+// Entities live in paged slots that are reused after destruction. Each slot
+// carries a generation that is bumped on destroy, so a handle taken before
+// the entity died no longer resolves. Slots are also marked retired while an
+// entity waits for cleanup, which lets target lookups reject dying entities
+// without inspecting their components. EntityIDs stay the stable external
+// identity and map to slots through a table paged over the dense ID range,
+// with the rare larger IDs (from save files) kept in a hash map, so a single
+// large ID does not allocate a table up to it.
+class EntitySlotMap {
+public:
+  explicit EntitySlotMap(ComponentStorage *storage);
+  ~EntitySlotMap();
+
+  EntitySlotMap(const EntitySlotMap &) = delete;
+  EntitySlotMap(EntitySlotMap &&) = delete;
+  auto operator=(const EntitySlotMap &) -> EntitySlotMap & = delete;
+  auto operator=(EntitySlotMap &&) -> EntitySlotMap & = delete;
+
+  auto create(EntityID entity_id) -> Entity *;
+  void destroy(EntityID entity_id);
+  void clear();
+
+  [[nodiscard]] auto find(EntityID entity_id) const -> Entity * {
+    std::uint32_t const slot = slotOf(entity_id);
+    return slot == EntityHandle::kInvalidIndex ? nullptr : entityAt(slot);
+  }
+
+  [[nodiscard]] auto findLive(EntityID entity_id) const -> Entity * {
+    std::uint32_t const slot = slotOf(entity_id);
+    if (slot == EntityHandle::kInvalidIndex || m_slots[slot].retired) {
+      return nullptr;
+    }
+    return entityAt(slot);
+  }
+
+  [[nodiscard]] auto handleOf(EntityID entity_id) const -> EntityHandle;
+  [[nodiscard]] auto resolve(EntityHandle handle) const -> Entity *;
+  void setRetired(EntityID entity_id, bool retired);
+
+  [[nodiscard]] auto size() const -> std::size_t { return m_size; }
+
+  template <typename Fn> void forEach(Fn &&fn) const {
+    for (std::uint32_t slot = 0; slot < m_slots.size(); ++slot) {
+      if (m_slots[slot].entity_id != NULL_ENTITY) {
+        fn(*entityAt(slot));
+      }
+    }
+  }
+
+private:
+  static constexpr std::uint32_t kPageSize = 256;
+
+  struct Cell {
+    alignas(Entity) std::byte bytes[sizeof(Entity)];
+  };
+
+  struct Page {
+    std::array<Cell, kPageSize> cells;
+  };
+
+  struct Slot {
+    EntityID entity_id = NULL_ENTITY;
+    std::uint32_t generation = 0;
+    bool retired = false;
+  };
+
+  static constexpr std::uint32_t kIdPageShift = 10;
+  static constexpr std::uint32_t kIdPageSize = 1U << kIdPageShift;
+  static constexpr EntityID kDenseIdLimit = EntityID{1} << 22;
+
+  using IdPage = std::array<std::uint32_t, kIdPageSize>;
+
+  [[nodiscard]] auto slotOf(EntityID entity_id) const -> std::uint32_t {
+    if (entity_id >= kDenseIdLimit) {
+      return sparseSlotOf(entity_id);
+    }
+    std::size_t const page = entity_id >> kIdPageShift;
+    if (page >= m_idPages.size() || !m_idPages[page]) {
+      return EntityHandle::kInvalidIndex;
+    }
+    return (*m_idPages[page])[entity_id & (kIdPageSize - 1)];
+  }
+  [[nodiscard]] auto sparseSlotOf(EntityID entity_id) const -> std::uint32_t;
+  void setSlotOf(EntityID entity_id, std::uint32_t slot);
+
+  [[nodiscard]] auto entityAt(std::uint32_t slot) const -> Entity *;
+  void destroySlot(std::uint32_t slot);
+
+  ComponentStorage *m_storage;
+  std::vector<std::unique_ptr<Page>> m_pages;
+  std::vector<Slot> m_slots;
+  std::vector<std::uint32_t> m_freeSlots;
+  std::vector<std::unique_ptr<IdPage>> m_idPages;
+  std::unordered_map<EntityID, std::uint32_t> m_sparseSlots;
+  std::size_t m_size = 0;
+};
+
+} // namespace Engine::Core
@@ -2,12 +2,18 @@
 
 #include "../units/spawn_type.h"
 #include "entity.h"
+#include "event_ring.h"
+#include "type_list.h"
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <functional>
 #include <memory>
 #include <mutex>
-#include <typeindex>
-#include <unordered_map>
+#include <span>
 #include <utility>
 #include <vector>
 
@@ -22,12 +28,232 @@ public:
 };
 
 template <typename T> using EventHandler = std::function<void(const T &)>;
+template <typename T>
+using EventBatchHandler = std::function<void(std::span<const T>)>;
 
 using SubscriptionHandle = std::size_t;
 
+using EventTypeId = std::uint32_t;
+
+constexpr std::size_t kMaxEventTypes = 32;
+
+// Defined after the event classes below over the registered event list.
+template <typename T> struct EventTypeInfo;
+
+template <typename T>
+constexpr EventTypeId eventTypeId = EventTypeInfo<T>::id;
+
 struct EventStats {
   size_t publishCount = 0;
   size_t subscriberCount = 0;
+  size_t queueDepth = 0;
+  size_t peakQueueDepth = 0;
+  size_t overflowCount = 0;
+  std::chrono::nanoseconds dispatchTime{0};
+};
+
+struct DeferredDispatch {};
+inline constexpr DeferredDispatch kDeferredDispatch{};
+
+class EventChannelBase {
+public:
+  EventChannelBase() = default;
+  EventChannelBase(const EventChannelBase &) = delete;
+  EventChannelBase(EventChannelBase &&) = delete;
+  auto operator=(const EventChannelBase &) -> EventChannelBase & = delete;
+  auto operator=(EventChannelBase &&) -> EventChannelBase & = delete;
+  virtual ~EventChannelBase() = default;
+
+  virtual void dispatchDeferred() = 0;
+  virtual void discardDeferred() = 0;
+  virtual void clearSubscribers() = 0;
+  [[nodiscard]] virtual auto queueDepth() const -> std::size_t = 0;
+
+  [[nodiscard]] auto stats() const -> EventStats {
+    EventStats stats;
+    stats.publishCount = m_publishCount.load(std::memory_order_relaxed);
+    stats.subscriberCount = m_subscriberCount.load(std::memory_order_relaxed);
+    stats.queueDepth = queueDepth();
+    stats.peakQueueDepth = m_peakQueueDepth.load(std::memory_order_relaxed);
+    stats.overflowCount = m_overflowCount.load(std::memory_order_relaxed);
+    stats.dispatchTime = std::chrono::nanoseconds(
+        m_dispatchNanos.load(std::memory_order_relaxed));
+    return stats;
+  }
+
+  void resetStats() {
+    m_publishCount.store(0, std::memory_order_relaxed);
+    m_subscriberCount.store(0, std::memory_order_relaxed);
+    m_peakQueueDepth.store(0, std::memory_order_relaxed);
+    m_overflowCount.store(0, std::memory_order_relaxed);
+    m_dispatchNanos.store(0, std::memory_order_relaxed);
+  }
+
+protected:
+  void recordDispatch(std::chrono::steady_clock::time_point start) {
+    auto const elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start);
+    m_dispatchNanos.fetch_add(elapsed.count(), std::memory_order_relaxed);
+  }
+
+  void recordQueueDepth(std::size_t depth) {
+    std::size_t peak = m_peakQueueDepth.load(std::memory_order_relaxed);
+    while (depth > peak && !m_peakQueueDepth.compare_exchange_weak(
+                               peak, depth, std::memory_order_relaxed)) {
+    }
+  }
+
+  std::atomic<std::size_t> m_publishCount{0};
+  std::atomic<std::size_t> m_subscriberCount{0};
+  std::atomic<std::size_t> m_peakQueueDepth{0};
+  std::atomic<std::size_t> m_overflowCount{0};
+  std::atomic<std::int64_t> m_dispatchNanos{0};
+};
+
+// Per-type dispatch state. Publishing reads an immutable snapshot of the
+// subscriber lists, so it never locks or copies handlers; subscribing swaps
+// in a new snapshot. Deferred subscribers receive the events queued since the
+// previous dispatchDeferred() as one batch.
+template <typename T> class EventChannel final : public EventChannelBase {
+public:
+  static constexpr std::size_t kQueueCapacity = 1024;
+
+  EventChannel()
+      : m_subscribers(std::make_shared<const Subscribers>()),
+        m_queue(kQueueCapacity) {}
+
+  void publish(const T &event) {
+    auto subscribers = m_subscribers.load(std::memory_order_acquire);
+    if (subscribers->immediate.empty() && subscribers->deferred.empty()) {
+      return;
+    }
+    m_publishCount.fetch_add(1, std::memory_order_relaxed);
+
+    if (!subscribers->immediate.empty()) {
+      auto const start = std::chrono::steady_clock::now();
+      for (const auto &entry : subscribers->immediate) {
+        entry.handler(event);
+      }
+      recordDispatch(start);
+    }
+
+    if (!subscribers->deferred.empty()) {
+      // Dispatch drains the ring before the overflow, so once an event
+      // overflowed every later one follows it there until the next
+      // dispatch; otherwise a push into space the drain just freed would
+      // overtake it.
+      if (m_overflowing.load(std::memory_order_acquire) ||
+          !m_queue.tryPush(event)) {
+        std::lock_guard<std::mutex> const lock(m_overflowMutex);
+        m_overflow.push_back(event);
+        m_overflowing.store(true, std::memory_order_release);
+        m_overflowCount.fetch_add(1, std::memory_order_relaxed);
+      }
+      recordQueueDepth(m_queue.size());
+    }
+  }
+
+  void dispatchDeferred() override {
+    std::lock_guard<std::mutex> const lock(m_drainMutex);
+    auto collect = [this](T &&event) { m_batch.push_back(std::move(event)); };
+    m_queue.drain(collect);
+    {
+      std::lock_guard<std::mutex> const overflow_lock(m_overflowMutex);
+      if (!m_overflow.empty()) {
+        // Nothing enters the ring while the overflow is in use, so what
+        // reached it since the drain above is older than the overflow.
+        // Pushes already under way are waited out.
+        while (m_queue.size() > 0) {
+          m_queue.drain(collect);
+        }
+        for (auto &event : m_overflow) {
+          m_batch.push_back(std::move(event));
+        }
+        m_overflow.clear();
+        m_overflowing.store(false, std::memory_order_release);
+      }
+    }
+    if (m_batch.empty()) {
+      return;
+    }
+
+    auto subscribers = m_subscribers.load(std::memory_order_acquire);
+    auto const start = std::chrono::steady_clock::now();
+    std::span<const T> const batch(m_batch);
+    for (const auto &entry : subscribers->deferred) {
+      entry.handler(batch);
+    }
+    recordDispatch(start);
+    m_batch.clear();
+  }
+
+  void discardDeferred() override {
+    std::lock_guard<std::mutex> const lock(m_drainMutex);
+    m_queue.drain([](T &&) {});
+    std::lock_guard<std::mutex> const overflow_lock(m_overflowMutex);
+    m_overflow.clear();
+    m_overflowing.store(false, std::memory_order_release);
+  }
+
+  [[nodiscard]] auto queueDepth() const -> std::size_t override {
+    std::lock_guard<std::mutex> const lock(m_overflowMutex);
+    return m_queue.size() + m_overflow.size();
+  }
+
+  void addImmediate(SubscriptionHandle handle, EventHandler<T> handler) {
+    auto next = std::make_shared<Subscribers>(*m_subscribers.load());
+    next->immediate.push_back({handle, std::move(handler)});
+    m_subscribers.store(std::move(next), std::memory_order_release);
+    m_subscriberCount.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  void addDeferred(SubscriptionHandle handle, EventBatchHandler<T> handler) {
+    auto next = std::make_shared<Subscribers>(*m_subscribers.load());
+    next->deferred.push_back({handle, std::move(handler)});
+    m_subscribers.store(std::move(next), std::memory_order_release);
+    m_subscriberCount.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  void remove(SubscriptionHandle handle) {
+    auto next = std::make_shared<Subscribers>(*m_subscribers.load());
+    auto matches = [handle](const auto &e) { return e.handle == handle; };
+    std::size_t const removed = std::erase_if(next->immediate, matches) +
+                                std::erase_if(next->deferred, matches);
+    if (removed > 0) {
+      m_subscribers.store(std::move(next), std::memory_order_release);
+      m_subscriberCount.fetch_sub(removed, std::memory_order_relaxed);
+    }
+  }
+
+  void clearSubscribers() override {
+    m_subscribers.store(std::make_shared<const Subscribers>(),
+                        std::memory_order_release);
+  }
+
+private:
+  struct ImmediateEntry {
+    SubscriptionHandle handle;
+    EventHandler<T> handler;
+  };
+
+  struct DeferredEntry {
+    SubscriptionHandle handle;
+    EventBatchHandler<T> handler;
+  };
+
+  struct Subscribers {
+    std::vector<ImmediateEntry> immediate;
+    std::vector<DeferredEntry> deferred;
+  };
+
+  std::atomic<std::shared_ptr<const Subscribers>> m_subscribers;
+  EventRing<T> m_queue;
+  std::vector<T> m_overflow;
+  // Set while m_overflow holds events, so later publishes queue behind them.
+  std::atomic<bool> m_overflowing{false};
+  mutable std::mutex m_overflowMutex;
+  std::vector<T> m_batch;
+  std::mutex m_drainMutex;
 };
 
 class EventManager {
@@ -41,90 +267,94 @@ public:
   auto subscribe(EventHandler<T> handler) -> SubscriptionHandle {
     static_assert(std::is_base_of_v<Event, T>, "T must inherit from Event");
     std::lock_guard<std::mutex> const lock(m_mutex);
-
     SubscriptionHandle const handle = m_nextHandle++;
-    auto wrapper = [handler, handle](const void *event) {
-      handler(*static_cast<const T *>(event));
-    };
-    HandlerEntry const entry{handle, wrapper};
-    m_handlers[std::type_index(typeid(T))].push_back(entry);
-
-    m_stats[std::type_index(typeid(T))].subscriberCount++;
+    channel<T>().addImmediate(handle, std::move(handler));
+    return handle;
+  }
 
+  // Handlers registered here run from dispatchDeferred() with every event
+  // of type T published since the previous dispatch.
+  template <typename T>
+  auto subscribeDeferred(EventBatchHandler<T> handler) -> SubscriptionHandle {
+    static_assert(std::is_base_of_v<Event, T>, "T must inherit from Event");
+    std::lock_guard<std::mutex> const lock(m_mutex);
+    SubscriptionHandle const handle = m_nextHandle++;
+    channel<T>().addDeferred(handle, std::move(handler));
     return handle;
   }
 
   template <typename T> void unsubscribe(SubscriptionHandle handle) {
     static_assert(std::is_base_of_v<Event, T>, "T must inherit from Event");
     std::lock_guard<std::mutex> const lock(m_mutex);
-
-    auto it = m_handlers.find(std::type_index(typeid(T)));
-    if (it != m_handlers.end()) {
-      auto &handlers = it->second;
-      auto sizeBefore = handlers.size();
-      handlers.erase(std::remove_if(handlers.begin(), handlers.end(),
-                                    [handle](const HandlerEntry &e) {
-                                      return e.handle == handle;
-                                    }),
-                     handlers.end());
-
-      if (handlers.size() < sizeBefore) {
-        m_stats[std::type_index(typeid(T))].subscriberCount--;
-      }
+    if (auto *ch = findChannel<T>()) {
+      ch->remove(handle);
     }
   }
 
   template <typename T> void publish(const T &event) {
     static_assert(std::is_base_of_v<Event, T>, "T must inherit from Event");
-    std::vector<HandlerEntry> handlersCopy;
+    if (auto *ch = findChannel<T>()) {
+      ch->publish(event);
+    }
+  }
 
-    {
-      std::lock_guard<std::mutex> const lock(m_mutex);
-      auto it = m_handlers.find(std::type_index(typeid(T)));
-      if (it != m_handlers.end()) {
-        handlersCopy = it->second;
-        m_stats[std::type_index(typeid(T))].publishCount++;
+  void dispatchDeferred() {
+    for (auto &slot : m_channelPtrs) {
+      if (auto *ch = slot.load(std::memory_order_acquire)) {
+        ch->dispatchDeferred();
       }
     }
+  }
 
-    for (const auto &entry : handlersCopy) {
-      entry.handler(&event);
+  // Drops queued events, e.g. after registries were rebuilt from the world
+  // and the queued events are already accounted for.
+  void discardDeferred() {
+    for (auto &slot : m_channelPtrs) {
+      if (auto *ch = slot.load(std::memory_order_acquire)) {
+        ch->discardDeferred();
+      }
     }
   }
 
-  auto getStats(const std::type_index &eventType) const -> EventStats {
-    std::lock_guard<std::mutex> const lock(m_mutex);
-    auto it = m_stats.find(eventType);
-    if (it != m_stats.end()) {
-      return it->second;
+  template <typename T> auto getStats() const -> EventStats {
+    if (const auto *ch = findChannel<T>()) {
+      return ch->stats();
     }
     return EventStats{};
   }
 
-  auto getSubscriberCount(const std::type_index &eventType) const -> size_t {
-    std::lock_guard<std::mutex> const lock(m_mutex);
-    auto it = m_handlers.find(eventType);
-    if (it != m_handlers.end()) {
-      return it->second.size();
-    }
-    return 0;
+  template <typename T> auto getSubscriberCount() const -> size_t {
+    return getStats<T>().subscriberCount;
   }
 
   void clearAllSubscriptions() {
     std::lock_guard<std::mutex> const lock(m_mutex);
-    m_handlers.clear();
-    m_stats.clear();
+    for (auto &ch : m_channels) {
+      if (ch) {
+        ch->clearSubscribers();
+        ch->resetStats();
+      }
+    }
   }
 
 private:
-  struct HandlerEntry {
-    SubscriptionHandle handle;
-    std::function<void(const void *)> handler;
-  };
+  template <typename T> auto channel() -> EventChannel<T> & {
+    auto &ch = m_channels[eventTypeId<T>];
+    if (!ch) {
+      ch = std::make_unique<EventChannel<T>>();
+      m_channelPtrs[eventTypeId<T>].store(ch.get(), std::memory_order_release);
+    }
+    return static_cast<EventChannel<T> &>(*ch);
+  }
+
+  template <typename T> auto findChannel() const -> EventChannel<T> * {
+    return static_cast<EventChannel<T> *>(
+        m_channelPtrs[eventTypeId<T>].load(std::memory_order_acquire));
+  }
 
   mutable std::mutex m_mutex;
-  std::unordered_map<std::type_index, std::vector<HandlerEntry>> m_handlers;
-  std::unordered_map<std::type_index, EventStats> m_stats;
+  std::array<std::unique_ptr<EventChannelBase>, kMaxEventTypes> m_channels;
+  std::array<std::atomic<EventChannelBase *>, kMaxEventTypes> m_channelPtrs{};
   SubscriptionHandle m_nextHandle = 1;
 };
 
@@ -135,6 +365,11 @@ public:
   ScopedEventSubscription(EventHandler<T> handler)
       : m_handle(EventManager::instance().subscribe<T>(handler)) {}
 
+  ScopedEventSubscription(DeferredDispatch /*mode*/,
+                          EventBatchHandler<T> handler)
+      : m_handle(EventManager::instance().subscribeDeferred<T>(
+            std::move(handler))) {}
+
   ~ScopedEventSubscription() { unsubscribe(); }
 
   ScopedEventSubscription(const ScopedEventSubscription &) = delete;
@@ -271,4 +506,19 @@ public:
   bool crossfade;
 };
 
+using EventTypes =
+    TypeList<UnitSelectedEvent, UnitMovedEvent, UnitDiedEvent,
+             UnitSpawnedEvent, BuildingAttackedEvent, BarrackCapturedEvent,
+             AmbientStateChangedEvent, AudioTriggerEvent, MusicTriggerEvent>;
+
+static_assert(EventTypes::size <= kMaxEventTypes,
+              "Too many event types for EventManager");
+
+template <typename T> struct EventTypeInfo {
+  static constexpr auto id =
+      static_cast<EventTypeId>(typeIndexOf<T>(EventTypes{}));
+  static_assert(id < EventTypes::size,
+                "Event type is not registered in EventTypes");
+};
+
 } // namespace Engine::Core
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+
+namespace Engine::Core {
+
+// Bounded multi-producer ring of events awaiting a deferred dispatch. Slots
+// are allocated once, so pushing never touches the heap; a full ring rejects
+// the push and leaves overflow handling to the caller. Draining must happen
+// from one thread at a time. Slots are indexed with a mask, so the capacity
+// is rounded up to a power of two.
+template <typename T> class EventRing {
+public:
+  explicit EventRing(std::size_t capacity)
+      : m_cells(std::make_unique<Cell[]>(std::bit_ceil(capacity))),
+        m_mask(std::bit_ceil(capacity) - 1) {
+    for (std::size_t i = 0; i <= m_mask; ++i) {
+      m_cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  ~EventRing() {
+    drain([](T &&) {});
+  }
+
+  EventRing(const EventRing &) = delete;
+  EventRing(EventRing &&) = delete;
+  auto operator=(const EventRing &) -> EventRing & = delete;
+  auto operator=(EventRing &&) -> EventRing & = delete;
+
+  auto tryPush(const T &event) -> bool {
+    std::size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+    Cell *cell = nullptr;
+    while (true) {
+      cell = &m_cells[pos & m_mask];
+      std::size_t const seq = cell->sequence.load(std::memory_order_acquire);
+      auto const diff =
+          static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+      if (diff == 0) {
+        if (m_enqueuePos.compare_exchange_weak(pos, pos + 1,
+                                               std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = m_enqueuePos.load(std::memory_order_relaxed);
+      }
+    }
+    ::new (static_cast<void *>(cell->bytes)) T(event);
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  template <typename Fn> auto drain(Fn &&fn) -> std::size_t {
+    std::size_t count = 0;
+    std::size_t pos = m_dequeuePos.load(std::memory_order_relaxed);
+    while (true) {
+      Cell &cell = m_cells[pos & m_mask];
+      if (cell.sequence.load(std::memory_order_acquire) != pos + 1) {
+        break;
+      }
+      T *event = std::launder(reinterpret_cast<T *>(cell.bytes));
+      fn(std::move(*event));
+      std::destroy_at(event);
+      cell.sequence.store(pos + m_mask + 1, std::memory_order_release);
+      m_dequeuePos.store(++pos, std::memory_order_relaxed);
+      ++count;
+    }
+    return count;
+  }
+
+  [[nodiscard]] auto capacity() const -> std::size_t { return m_mask + 1; }
+
+  [[nodiscard]] auto size() const -> std::size_t {
+    std::size_t const head = m_dequeuePos.load(std::memory_order_relaxed);
+    std::size_t const tail = m_enqueuePos.load(std::memory_order_relaxed);
+    return tail >= head ? tail - head : 0;
+  }
+
+private:
+  struct Cell {
+    std::atomic<std::size_t> sequence{0};
+    alignas(T) std::byte bytes[sizeof(T)];
+  };
+
+  std::unique_ptr<Cell[]> m_cells;
+  std::size_t m_mask;
+  alignas(64) std::atomic<std::size_t> m_enqueuePos{0};
+  alignas(64) std::atomic<std::size_t> m_dequeuePos{0};
+};
+
+} // namespace Engine::Core
@@ -0,0 +1,117 @@
+#include "job_system.h"
+#include "profiler.h"
+#include <algorithm>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace Engine::Core {
+
+auto JobSystem::instance() -> JobSystem & {
+  static JobSystem inst(std::max(1U, std::thread::hardware_concurrency()) - 1);
+  return inst;
+}
+
+JobSystem::JobSystem(std::size_t worker_count) {
+  m_workers.reserve(worker_count);
+  for (std::size_t i = 0; i < worker_count; ++i) {
+    m_workers.emplace_back(&JobSystem::workerLoop, this);
+  }
+}
+
+JobSystem::~JobSystem() {
+  {
+    std::lock_guard<std::mutex> const lock(m_mutex);
+    m_shouldStop = true;
+  }
+  m_jobAvailable.notify_all();
+  for (auto &worker : m_workers) {
+    if (worker.joinable()) {
+      worker.join();
+    }
+  }
+}
+
+void JobSystem::run(std::vector<std::function<void()>> &tasks) {
+  if (tasks.empty()) {
+    return;
+  }
+  if (m_workers.empty() || tasks.size() == 1) {
+    for (auto &task : tasks) {
+      task();
+    }
+    return;
+  }
+
+  auto batch = std::make_shared<Batch>();
+  batch->remaining.store(tasks.size(), std::memory_order_relaxed);
+  {
+    std::lock_guard<std::mutex> const lock(m_mutex);
+    for (auto &task : tasks) {
+      m_queue.push_back(Job{&task, batch});
+    }
+  }
+  m_jobAvailable.notify_all();
+
+  while (batch->remaining.load(std::memory_order_acquire) > 0) {
+    if (!tryRunOne()) {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_batchDone.wait(lock, [&]() {
+        return batch->remaining.load(std::memory_order_acquire) == 0 ||
+               !m_queue.empty();
+      });
+    }
+  }
+
+  if (batch->error) {
+    std::rethrow_exception(batch->error);
+  }
+}
+
+auto JobSystem::tryRunOne() -> bool {
+  Job job;
+  {
+    std::lock_guard<std::mutex> const lock(m_mutex);
+    if (m_queue.empty()) {
+      return false;
+    }
+    job = std::move(m_queue.front());
+    m_queue.pop_front();
+  }
+  execute(job);
+  {
+    std::lock_guard<std::mutex> const lock(m_mutex);
+  }
+  m_batchDone.notify_all();
+  return true;
+}
+
+void JobSystem::execute(Job &job) {
+  try {
+    (*job.task)();
+  } catch (...) {
+    std::lock_guard<std::mutex> const lock(job.batch->errorMutex);
+    if (!job.batch->error) {
+      job.batch->error = std::current_exception();
+    }
+  }
+  job.batch->remaining.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+void JobSystem::workerLoop() {
+  Profiler::instance().setThreadName("Job worker");
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_jobAvailable.wait(
+          lock, [this]() { return m_shouldStop || !m_queue.empty(); });
+      if (m_shouldStop && m_queue.empty()) {
+        break;
+      }
+    }
+    tryRunOne();
+  }
+}
+
+} // namespace Engine::Core
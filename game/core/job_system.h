@@ -0,0 +1,78 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Engine::Core {
+
+// Fixed pool of worker threads for short, fork-join style work on the
+// simulation thread. The calling thread helps execute queued jobs while it
+// waits, so nested batches cannot deadlock the pool.
+class JobSystem {
+public:
+  static auto instance() -> JobSystem &;
+
+  explicit JobSystem(std::size_t worker_count);
+  ~JobSystem();
+
+  JobSystem(const JobSystem &) = delete;
+  JobSystem(JobSystem &&) = delete;
+  auto operator=(const JobSystem &) -> JobSystem & = delete;
+  auto operator=(JobSystem &&) -> JobSystem & = delete;
+
+  [[nodiscard]] auto workerCount() const -> std::size_t {
+    return m_workers.size();
+  }
+
+  void run(std::vector<std::function<void()>> &tasks);
+
+  template <typename Fn>
+  void parallelFor(std::size_t count, std::size_t grain, Fn &&fn) {
+    grain = std::max<std::size_t>(grain, 1);
+    if (m_workers.empty() || count <= grain) {
+      fn(std::size_t{0}, count);
+      return;
+    }
+    std::vector<std::function<void()>> tasks;
+    tasks.reserve((count + grain - 1) / grain);
+    for (std::size_t begin = 0; begin < count; begin += grain) {
+      std::size_t const end = std::min(count, begin + grain);
+      tasks.emplace_back([&fn, begin, end]() { fn(begin, end); });
+    }
+    run(tasks);
+  }
+
+private:
+  struct Batch {
+    std::atomic<std::size_t> remaining{0};
+    std::exception_ptr error;
+    std::mutex errorMutex;
+  };
+
+  struct Job {
+    std::function<void()> *task = nullptr;
+    std::shared_ptr<Batch> batch;
+  };
+
+  void workerLoop();
+  auto tryRunOne() -> bool;
+  static void execute(Job &job);
+
+  std::vector<std::thread> m_workers;
+  std::mutex m_mutex;
+  std::condition_variable m_jobAvailable;
+  std::condition_variable m_batchDone;
+  std::deque<Job> m_queue;
+  bool m_shouldStop = false;
+};
+
+} // namespace Engine::Core
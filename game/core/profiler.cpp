@@ -0,0 +1,213 @@
+#include "profiler.h"
+#include <QDebug>
+#include <QFile>
+#include <QIODevice>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if defined(__GNUG__)
+#include <cxxabi.h>
+#endif
+
+namespace Engine::Core {
+
+namespace {
+
+auto percentile(const std::vector<std::uint64_t> &sorted,
+                double fraction) -> double {
+  auto const rank = static_cast<std::size_t>(
+      fraction * static_cast<double>(sorted.size() - 1) + 0.5);
+  return static_cast<double>(sorted[std::min(rank, sorted.size() - 1)]) / 1e6;
+}
+
+} // namespace
+
+auto Profiler::instance() -> Profiler & {
+  static Profiler inst;
+  return inst;
+}
+
+auto Profiler::now() -> std::uint64_t {
+  return static_cast<std::uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now().time_since_epoch())
+          .count());
+}
+
+auto Profiler::typeName(const std::type_info &type) -> std::string {
+#if defined(__GNUG__)
+  int status = 0;
+  char *demangled = abi::__cxa_demangle(type.name(), nullptr, nullptr, &status);
+  if (status == 0 && demangled != nullptr) {
+    std::string result(demangled);
+    std::free(demangled);
+    return result;
+  }
+  std::free(demangled);
+#endif
+  return type.name();
+}
+
+auto Profiler::threadBuffer() -> ThreadBuffer & {
+  thread_local ThreadBuffer *buffer = nullptr;
+  if (buffer == nullptr) {
+    const std::lock_guard<std::mutex> lock(m_mutex);
+    auto &entry = m_threads.emplace_back(std::make_unique<ThreadBuffer>());
+    entry->thread_id = static_cast<std::uint32_t>(m_threads.size());
+    entry->name = "Thread " + std::to_string(entry->thread_id);
+    buffer = entry.get();
+  }
+  return *buffer;
+}
+
+void Profiler::record(const char *name, std::uint64_t start_ns,
+                      std::uint64_t end_ns) {
+  auto &buffer = threadBuffer();
+  const std::lock_guard<std::mutex> lock(buffer.mutex);
+  if (buffer.events.empty()) {
+    buffer.events.resize(kEventsPerThread);
+  }
+  buffer.events[buffer.written % kEventsPerThread] = {name, start_ns, end_ns};
+  ++buffer.written;
+}
+
+void Profiler::setThreadName(const std::string &name) {
+  auto &buffer = threadBuffer();
+  const std::lock_guard<std::mutex> lock(buffer.mutex);
+  buffer.name = name;
+}
+
+auto Profiler::intern(std::string_view name) -> const char * {
+  const std::lock_guard<std::mutex> lock(m_mutex);
+  return m_names.emplace(name).first->c_str();
+}
+
+void Profiler::clear() {
+  const std::lock_guard<std::mutex> lock(m_mutex);
+  for (auto &buffer : m_threads) {
+    const std::lock_guard<std::mutex> buffer_lock(buffer->mutex);
+    buffer->written = 0;
+  }
+}
+
+auto Profiler::collect() const -> std::vector<ThreadEvents> {
+  const std::lock_guard<std::mutex> lock(m_mutex);
+  std::vector<ThreadEvents> result;
+  result.reserve(m_threads.size());
+  for (const auto &buffer : m_threads) {
+    const std::lock_guard<std::mutex> buffer_lock(buffer->mutex);
+    ThreadEvents thread;
+    thread.thread_id = buffer->thread_id;
+    thread.name = buffer->name;
+    std::uint64_t const kept =
+        std::min<std::uint64_t>(buffer->written, kEventsPerThread);
+    thread.events.reserve(kept);
+    for (std::uint64_t i = buffer->written - kept; i < buffer->written; ++i) {
+      thread.events.push_back(buffer->events[i % kEventsPerThread]);
+    }
+    result.push_back(std::move(thread));
+  }
+  return result;
+}
+
+auto Profiler::summarize() const -> std::vector<ZoneSummary> {
+  std::map<std::string, std::vector<std::uint64_t>> durations;
+  for (const auto &thread : collect()) {
+    for (const auto &event : thread.events) {
+      durations[event.name].push_back(event.end_ns - event.start_ns);
+    }
+  }
+
+  std::vector<ZoneSummary> result;
+  result.reserve(durations.size());
+  for (auto &[name, samples] : durations) {
+    std::sort(samples.begin(), samples.end());
+    ZoneSummary summary;
+    summary.name = name;
+    summary.count = samples.size();
+    for (auto const sample : samples) {
+      summary.total_ms += static_cast<double>(sample) / 1e6;
+    }
+    summary.p50_ms = percentile(samples, 0.50);
+    summary.p95_ms = percentile(samples, 0.95);
+    summary.p99_ms = percentile(samples, 0.99);
+    summary.max_ms = static_cast<double>(samples.back()) / 1e6;
+    result.push_back(std::move(summary));
+  }
+
+  std::sort(result.begin(), result.end(),
+            [](const ZoneSummary &a, const ZoneSummary &b) {
+              return a.total_ms > b.total_ms;
+            });
+  return result;
+}
+
+void Profiler::logSummary() const {
+  for (const auto &zone : summarize()) {
+    qInfo().noquote() << QString::fromStdString(zone.name) << "count"
+                      << zone.count << "p50" << zone.p50_ms << "ms p95"
+                      << zone.p95_ms << "ms p99" << zone.p99_ms << "ms max"
+                      << zone.max_ms << "ms";
+  }
+}
+
+auto Profiler::toChromeTrace() const -> QJsonDocument {
+  auto const threads = collect();
+
+  std::uint64_t origin = std::numeric_limits<std::uint64_t>::max();
+  for (const auto &thread : threads) {
+    for (const auto &event : thread.events) {
+      origin = std::min(origin, event.start_ns);
+    }
+  }
+
+  QJsonArray trace_events;
+  for (const auto &thread : threads) {
+    QJsonObject meta;
+    meta["name"] = QStringLiteral("thread_name");
+    meta["ph"] = QStringLiteral("M");
+    meta["pid"] = 1;
+    meta["tid"] = static_cast<int>(thread.thread_id);
+    QJsonObject args;
+    args["name"] = QString::fromStdString(thread.name);
+    meta["args"] = args;
+    trace_events.append(meta);
+
+    for (const auto &event : thread.events) {
+      QJsonObject obj;
+      obj["name"] = QString::fromUtf8(event.name);
+      obj["ph"] = QStringLiteral("X");
+      obj["pid"] = 1;
+      obj["tid"] = static_cast<int>(thread.thread_id);
+      obj["ts"] = static_cast<double>(event.start_ns - origin) / 1e3;
+      obj["dur"] = static_cast<double>(event.end_ns - event.start_ns) / 1e3;
+      trace_events.append(obj);
+    }
+  }
+
+  QJsonObject root;
+  root["traceEvents"] = trace_events;
+  root["displayTimeUnit"] = QStringLiteral("ms");
+  return QJsonDocument(root);
+}
+
+auto Profiler::saveChromeTrace(const QString &filename) const -> bool {
+  QFile file(filename);
+  if (!file.open(QIODevice::WriteOnly)) {
+    qWarning() << "Could not open profile trace for writing:" << filename;
+    return false;
+  }
+  file.write(toChromeTrace().toJson(QJsonDocument::Compact));
+  return true;
+}
+
+} // namespace Engine::Core
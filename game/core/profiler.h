@@ -0,0 +1,116 @@
+#pragma once
+
+#include <QJsonDocument>
+#include <QString>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <typeinfo>
+#include <unordered_set>
+#include <vector>
+
+namespace Engine::Core {
+
+struct ProfileEvent {
+  const char *name = nullptr;
+  std::uint64_t start_ns = 0;
+  std::uint64_t end_ns = 0;
+};
+
+struct ZoneSummary {
+  std::string name;
+  std::size_t count = 0;
+  double total_ms = 0.0;
+  double p50_ms = 0.0;
+  double p95_ms = 0.0;
+  double p99_ms = 0.0;
+  double max_ms = 0.0;
+};
+
+// Records timed zones into a fixed-size ring per thread, so the newest
+// kEventsPerThread zones of every thread are kept. Zone names are stored by
+// pointer and must outlive the profiler: use string literals or intern().
+class Profiler {
+public:
+  static constexpr std::size_t kEventsPerThread = std::size_t{1} << 16;
+
+  static auto instance() -> Profiler &;
+
+  static auto isEnabled() -> bool {
+    return s_enabled.load(std::memory_order_relaxed);
+  }
+  static void setEnabled(bool enabled) {
+    s_enabled.store(enabled, std::memory_order_relaxed);
+  }
+  static auto now() -> std::uint64_t;
+  static auto typeName(const std::type_info &type) -> std::string;
+
+  void record(const char *name, std::uint64_t start_ns, std::uint64_t end_ns);
+  void setThreadName(const std::string &name);
+  auto intern(std::string_view name) -> const char *;
+
+  void clear();
+  auto summarize() const -> std::vector<ZoneSummary>;
+  void logSummary() const;
+  auto toChromeTrace() const -> QJsonDocument;
+  auto saveChromeTrace(const QString &filename) const -> bool;
+
+private:
+  Profiler() = default;
+  ~Profiler() = default;
+  Profiler(const Profiler &) = delete;
+  auto operator=(const Profiler &) -> Profiler & = delete;
+
+  struct ThreadBuffer {
+    std::uint32_t thread_id = 0;
+    std::string name;
+    std::mutex mutex;
+    std::vector<ProfileEvent> events;
+    std::uint64_t written = 0;
+  };
+
+  struct ThreadEvents {
+    std::uint32_t thread_id = 0;
+    std::string name;
+    std::vector<ProfileEvent> events;
+  };
+
+  auto threadBuffer() -> ThreadBuffer &;
+  auto collect() const -> std::vector<ThreadEvents>;
+
+  static inline std::atomic<bool> s_enabled{false};
+
+  mutable std::mutex m_mutex;
+  std::vector<std::unique_ptr<ThreadBuffer>> m_threads;
+  std::unordered_set<std::string> m_names;
+};
+
+// Times its own lifetime. When profiling is off the only cost is one relaxed
+// load in the constructor and a null check in the destructor.
+class ProfileZone {
+public:
+  explicit ProfileZone(const char *name)
+      : m_name(Profiler::isEnabled() ? name : nullptr),
+        m_start(m_name != nullptr ? Profiler::now() : 0) {}
+
+  ~ProfileZone() {
+    if (m_name != nullptr) {
+      Profiler::instance().record(m_name, m_start, Profiler::now());
+    }
+  }
+
+  ProfileZone(const ProfileZone &) = delete;
+  ProfileZone(ProfileZone &&) = delete;
+  auto operator=(const ProfileZone &) -> ProfileZone & = delete;
+  auto operator=(ProfileZone &&) -> ProfileZone & = delete;
+
+private:
+  const char *m_name;
+  std::uint64_t m_start;
+};
+
+} // namespace Engine::Core
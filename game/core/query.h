@@ -0,0 +1,214 @@
+#pragma once
+
+#include "entity.h"
+#include <algorithm>
+#include <cstddef>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace Engine::Core {
+
+template <typename... Ts> struct Without {};
+
+// Persistent set of entities matching a component mask signature. The World
+// keeps every query up to date as components are added or removed, so systems
+// can iterate matches without rescanning the entity map. Removals that happen
+// while a view is open leave a hole which is compacted once the last view
+// closes, keeping indices stable during iteration.
+class Query {
+public:
+  Query(ComponentMask include, ComponentMask exclude)
+      : m_include(include), m_exclude(exclude) {}
+  Query(const Query &) = delete;
+  Query(Query &&) = delete;
+  auto operator=(const Query &) -> Query & = delete;
+  auto operator=(Query &&) -> Query & = delete;
+  ~Query() = default;
+
+  [[nodiscard]] auto include() const -> ComponentMask { return m_include; }
+  [[nodiscard]] auto exclude() const -> ComponentMask { return m_exclude; }
+
+  [[nodiscard]] auto matches(const Entity &entity) const -> bool {
+    ComponentMask const mask = entity.componentMask();
+    return (mask & m_include) == m_include && (mask & m_exclude) == 0;
+  }
+
+  [[nodiscard]] auto watches(ComponentTypeId type) const -> bool {
+    return (((m_include | m_exclude) >> type) & 1U) != 0;
+  }
+
+  void refresh(Entity &entity) {
+    bool const member = m_indices.find(&entity) != m_indices.end();
+    bool const should_be_member = matches(entity);
+    if (should_be_member && !member) {
+      m_indices.emplace(&entity, m_entities.size());
+      m_entities.push_back(&entity);
+    } else if (!should_be_member && member) {
+      erase(&entity);
+    }
+  }
+
+  void erase(Entity *entity) {
+    auto it = m_indices.find(entity);
+    if (it == m_indices.end()) {
+      return;
+    }
+    std::size_t const index = it->second;
+    m_indices.erase(it);
+
+    if (m_openViews > 0) {
+      m_entities[index] = nullptr;
+      ++m_holes;
+      return;
+    }
+
+    Entity *last = m_entities.back();
+    m_entities.pop_back();
+    if (index < m_entities.size()) {
+      m_entities[index] = last;
+      m_indices[last] = index;
+    }
+  }
+
+  void clear() {
+    if (m_openViews > 0) {
+      m_holes += m_indices.size();
+      std::fill(m_entities.begin(), m_entities.end(), nullptr);
+    } else {
+      m_entities.clear();
+      m_holes = 0;
+    }
+    m_indices.clear();
+  }
+
+  [[nodiscard]] auto size() const -> std::size_t { return m_indices.size(); }
+  [[nodiscard]] auto empty() const -> bool { return m_indices.empty(); }
+
+  void copyTo(std::vector<Entity *> &out) const {
+    out.reserve(out.size() + m_indices.size());
+    for (auto *entity : m_entities) {
+      if (entity != nullptr) {
+        out.push_back(entity);
+      }
+    }
+  }
+
+private:
+  friend class QueryView;
+
+  void openView() { ++m_openViews; }
+  void closeView() { --m_openViews; }
+
+  [[nodiscard]] auto needsCompaction() const -> bool {
+    return m_openViews == 0 && m_holes > 0;
+  }
+
+  void compact() {
+    if (!needsCompaction()) {
+      return;
+    }
+    std::size_t write = 0;
+    for (auto *entity : m_entities) {
+      if (entity != nullptr) {
+        m_indices[entity] = write;
+        m_entities[write++] = entity;
+      }
+    }
+    m_entities.resize(write);
+    m_holes = 0;
+  }
+
+  ComponentMask m_include;
+  ComponentMask m_exclude;
+  std::vector<Entity *> m_entities;
+  std::unordered_map<Entity *, std::size_t> m_indices;
+  std::size_t m_holes = 0;
+  int m_openViews = 0;
+};
+
+// Range over a query's current matches. Entities that start matching while
+// the view is open are not visited; entities that stop matching are skipped.
+// Iterating takes no lock, so the match list must not grow while a view is
+// open on another thread: structural changes from outside the sim thread go
+// through World::commands() and land at sync points, and a system changing
+// components directly declares writes that keep it out of the stage of any
+// system watching them.
+class QueryView {
+public:
+  class Iterator {
+  public:
+    Iterator(const std::vector<Entity *> *entities, std::size_t index,
+             std::size_t end)
+        : m_entities(entities), m_index(index), m_end(end) {
+      skipHoles();
+    }
+
+    auto operator*() const -> Entity * { return (*m_entities)[m_index]; }
+
+    auto operator++() -> Iterator & {
+      ++m_index;
+      skipHoles();
+      return *this;
+    }
+
+    auto operator!=(const Iterator &other) const -> bool {
+      return m_index != other.m_index;
+    }
+
+  private:
+    void skipHoles() {
+      while (m_index < m_end && (*m_entities)[m_index] == nullptr) {
+        ++m_index;
+      }
+    }
+
+    const std::vector<Entity *> *m_entities;
+    std::size_t m_index;
+    std::size_t m_end;
+  };
+
+  // Views opened from different threads share the counter, so opening and
+  // closing take the same lock as the structural changes and compaction.
+  QueryView(Query &query, std::recursive_mutex &mutex)
+      : m_query(&query), m_mutex(&mutex) {
+    const std::lock_guard<std::recursive_mutex> lock(*m_mutex);
+    m_end = m_query->m_entities.size();
+    m_query->openView();
+  }
+
+  ~QueryView() {
+    if (m_query == nullptr) {
+      return;
+    }
+    const std::lock_guard<std::recursive_mutex> lock(*m_mutex);
+    m_query->closeView();
+    m_query->compact();
+  }
+
+  QueryView(const QueryView &) = delete;
+  auto operator=(const QueryView &) -> QueryView & = delete;
+  QueryView(QueryView &&other) noexcept
+      : m_query(other.m_query), m_mutex(other.m_mutex), m_end(other.m_end) {
+    other.m_query = nullptr;
+  }
+  auto operator=(QueryView &&) -> QueryView & = delete;
+
+  [[nodiscard]] auto begin() const -> Iterator {
+    return {&m_query->m_entities, 0, m_end};
+  }
+
+  [[nodiscard]] auto end() const -> Iterator {
+    return {&m_query->m_entities, m_end, m_end};
+  }
+
+  [[nodiscard]] auto size() const -> std::size_t { return m_query->size(); }
+  [[nodiscard]] auto empty() const -> bool { return m_query->empty(); }
+
+private:
+  Query *m_query;
+  std::recursive_mutex *m_mutex;
+  std::size_t m_end = 0;
+};
+
+} // namespace Engine::Core
@@ -718,11 +718,10 @@ auto Serialization::serializeWorld(const World *world) -> QJsonDocument {
   QJsonObject world_obj;
   QJsonArray entities_array;
 
-  const auto &entities = world->getEntities();
-  for (const auto &[id, entity] : entities) {
-    QJsonObject const entity_obj = serializeEntity(entity.get());
+  world->forEachEntity([&](const Entity &entity) {
+    QJsonObject const entity_obj = serializeEntity(&entity);
     entities_array.append(entity_obj);
-  }
+  });
 
   world_obj["entities"] = entities_array;
   world_obj["nextEntityId"] = static_cast<qint64>(world->getNextEntityId());
@@ -745,20 +744,29 @@ void Serialization::deserializeWorld(World *world, const QJsonDocument &doc) {
   auto entities_array = world_obj["entities"].toArray();
   for (const auto &value : entities_array) {
     auto entity_obj = value.toObject();
-    const auto entity_id =
-        static_cast<EntityID>(entity_obj["id"].toVariant().toULongLong());
+    const auto raw_id = entity_obj["id"].toVariant().toULongLong();
+    if (raw_id > World::kMaxEntityId) {
+      qWarning() << "Entity id out of range in save file:" << raw_id
+                 << "- skipping entity";
+      continue;
+    }
+    const auto entity_id = static_cast<EntityID>(raw_id);
     auto *entity = entity_id == NULL_ENTITY
                        ? world->createEntity()
                        : world->createEntityWithId(entity_id);
     if (entity != nullptr) {
       deserializeEntity(entity, entity_obj);
+      if (auto *unit = entity->getComponent<UnitComponent>()) {
+        world->setUnitOwner(*entity, unit->owner_id);
+      }
     }
   }
 
   if (world_obj.contains("nextEntityId")) {
-    const auto next_id = static_cast<EntityID>(
-        world_obj["nextEntityId"].toVariant().toULongLong());
-    world->setNextEntityId(next_id);
+    const auto next_id = std::min<qulonglong>(
+        world_obj["nextEntityId"].toVariant().toULongLong(),
+        World::kMaxEntityId);
+    world->setNextEntityId(static_cast<EntityID>(next_id));
   }
 
   if (world_obj.contains("owner_registry")) {
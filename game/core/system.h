@@ -1,11 +1,54 @@
 #pragma once
 
+#include <algorithm>
 #include <memory>
+#include <typeindex>
+#include <vector>
 
 namespace Engine::Core {
 
 class World;
 
+// Declares which components (or other shared resources, keyed by type) a
+// system reads and writes. The scheduler runs systems whose access sets do
+// not conflict in parallel; systems that do not declare anything are
+// treated as exclusive and keep their registration order.
+struct SystemAccess {
+  std::vector<std::type_index> reads;
+  std::vector<std::type_index> writes;
+  bool exclusive = false;
+
+  static auto exclusiveAccess() -> SystemAccess {
+    SystemAccess access;
+    access.exclusive = true;
+    return access;
+  }
+
+  template <typename... Ts> auto read() -> SystemAccess & {
+    (reads.emplace_back(typeid(Ts)), ...);
+    return *this;
+  }
+
+  template <typename... Ts> auto write() -> SystemAccess & {
+    (writes.emplace_back(typeid(Ts)), ...);
+    return *this;
+  }
+
+  [[nodiscard]] auto conflictsWith(const SystemAccess &other) const -> bool {
+    if (exclusive || other.exclusive) {
+      return true;
+    }
+    auto overlaps = [](const std::vector<std::type_index> &lhs,
+                       const std::vector<std::type_index> &rhs) {
+      return std::any_of(lhs.begin(), lhs.end(), [&](const auto &type) {
+        return std::find(rhs.begin(), rhs.end(), type) != rhs.end();
+      });
+    };
+    return overlaps(writes, other.writes) || overlaps(writes, other.reads) ||
+           overlaps(reads, other.writes);
+  }
+};
+
 class System {
 public:
   System() = default;
@@ -15,6 +58,9 @@ public:
   auto operator=(System &&) noexcept -> System & = default;
   virtual ~System() = default;
   virtual void update(World *world, float deltaTime) = 0;
+  [[nodiscard]] virtual auto access() const -> SystemAccess {
+    return SystemAccess::exclusiveAccess();
+  }
 };
 
 } // namespace Engine::Core
@@ -0,0 +1,73 @@
+#include "system_scheduler.h"
+#include "job_system.h"
+#include "profiler.h"
+#include "world.h"
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <typeinfo>
+#include <utility>
+#include <vector>
+
+namespace Engine::Core {
+
+void SystemScheduler::rebuild(
+    World *world, const std::vector<std::unique_ptr<System>> &systems) {
+  m_stages.clear();
+  m_commands.clear();
+
+  auto &profiler = Profiler::instance();
+  std::vector<SystemAccess> stage_access;
+  for (const auto &system : systems) {
+    const System &ref = *system;
+    auto &commands =
+        m_commands.emplace_back(std::make_unique<CommandBuffer>(world));
+    Entry const entry{system.get(),
+                      profiler.intern(Profiler::typeName(typeid(ref))),
+                      commands.get()};
+
+    SystemAccess access = system->access();
+    bool const conflicts =
+        m_stages.empty() ||
+        std::any_of(stage_access.begin(), stage_access.end(),
+                    [&access](const SystemAccess &other) {
+                      return access.conflictsWith(other);
+                    });
+    if (conflicts) {
+      m_stages.emplace_back();
+      stage_access.clear();
+    }
+    m_stages.back().push_back(entry);
+    stage_access.push_back(std::move(access));
+  }
+}
+
+void SystemScheduler::run(World *world, float deltaTime) {
+  auto &jobs = JobSystem::instance();
+  std::vector<std::function<void()>> tasks;
+
+  for (const auto &stage : m_stages) {
+    if (stage.size() == 1) {
+      runSystem(stage.front(), world, deltaTime);
+    } else {
+      tasks.clear();
+      for (const auto &entry : stage) {
+        tasks.emplace_back([&entry, world, deltaTime]() {
+          runSystem(entry, world, deltaTime);
+        });
+      }
+      jobs.run(tasks);
+    }
+    world->flushCommands();
+  }
+}
+
+void SystemScheduler::runSystem(const Entry &entry, World *world,
+                                float deltaTime) {
+  ProfileZone const zone(entry.zone_name);
+  World::CommandScope const scope(*world, *entry.commands);
+  entry.system->update(world, deltaTime);
+}
+
+} // namespace Engine::Core
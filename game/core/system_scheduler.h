@@ -0,0 +1,48 @@
+#pragma once
+
+#include "command_buffer.h"
+#include "system.h"
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace Engine::Core {
+
+class World;
+
+// Groups systems into stages from their declared access sets. A stage is a
+// run of consecutive systems with no conflicts among them, so stages keep
+// registration order and every stage can run concurrently with the same
+// result as a sequential update. Each system records into its own command
+// buffer; the buffers are played back in registration order after every
+// stage, so playback does not depend on which thread ran which system.
+class SystemScheduler {
+public:
+  struct Entry {
+    System *system = nullptr;
+    const char *zone_name = nullptr;
+    CommandBuffer *commands = nullptr;
+  };
+
+  void rebuild(World *world,
+               const std::vector<std::unique_ptr<System>> &systems);
+  void run(World *world, float deltaTime);
+
+  [[nodiscard]] auto stages() const -> const std::vector<std::vector<Entry>> & {
+    return m_stages;
+  }
+
+  // One buffer per system, in registration order.
+  [[nodiscard]] auto commandBuffers() const
+      -> const std::vector<std::unique_ptr<CommandBuffer>> & {
+    return m_commands;
+  }
+
+private:
+  static void runSystem(const Entry &entry, World *world, float deltaTime);
+
+  std::vector<std::vector<Entry>> m_stages;
+  std::vector<std::unique_ptr<CommandBuffer>> m_commands;
+};
+
+} // namespace Engine::Core
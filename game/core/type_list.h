@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+#include <type_traits>
+
+namespace Engine::Core {
+
+template <typename... Ts> struct TypeList {
+  static constexpr std::size_t size = sizeof...(Ts);
+};
+
+template <typename T, typename... Ts>
+constexpr auto typeIndexOf(TypeList<Ts...> /*list*/) -> std::size_t {
+  constexpr bool matches[] = {std::is_same_v<T, Ts>..., false};
+  for (std::size_t i = 0; i < sizeof...(Ts); ++i) {
+    if (matches[i]) {
+      return i;
+    }
+  }
+  return sizeof...(Ts);
+}
+
+} // namespace Engine::Core
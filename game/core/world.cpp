@@ -2,141 +2,374 @@
 #include "../systems/owner_registry.h"
 #include "../systems/troop_count_registry.h"
 #include "component.h"
+#include "profiler.h"
 #include "core/entity.h"
 #include "core/system.h"
 #include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
 #include <memory>
 #include <mutex>
+#include <thread>
 #include <utility>
 #include <vector>
 
 namespace Engine::Core {
 
-World::World() = default;
-World::~World() = default;
+namespace {
+
+std::atomic<std::uint64_t> g_nextWorldSerial{1};
+
+// OwnerRegistry::areAllies with the ally mask of `owner_id` fetched once by
+// the caller; owners past the masked range fall back to the team lookup.
+auto isAllied(const Game::Systems::OwnerRegistry &owner_registry,
+              std::uint64_t allies, int owner_id, int other_id) -> bool {
+  if (owner_id == other_id) {
+    return true;
+  }
+  if (allies != 0) {
+    if (std::uint64_t const bit = owner_registry.getOwnerBit(other_id);
+        bit != 0) {
+      return (allies & bit) != 0;
+    }
+  }
+  return owner_registry.areAllies(owner_id, other_id);
+}
+
+} // namespace
+
+World::World()
+    : m_entities(&m_componentStorage),
+      m_serial(g_nextWorldSerial.fetch_add(1, std::memory_order_relaxed)) {
+  m_componentStorage.setChangeListener(
+      [this](Entity &entity, ComponentTypeId type) {
+        onComponentChanged(entity, type);
+      });
+  m_componentStorage.setChangeGuard(&m_entityMutex,
+                                    [this] { return mayChangeStructure(); });
+}
+
+World::~World() {
+  m_componentStorage.setChangeListener(nullptr);
+  m_componentStorage.setChangeGuard(nullptr, nullptr);
+  m_entities.clear();
+}
 
 auto World::createEntity() -> Entity * {
+  assert(mayChangeStructure());
   const std::lock_guard<std::recursive_mutex> lock(m_entityMutex);
   EntityID const id = m_nextEntityId++;
-  auto entity = std::make_unique<Entity>(id);
-  auto *ptr = entity.get();
-  m_entities[id] = std::move(entity);
-  return ptr;
+  return m_entities.create(id);
 }
 
 auto World::createEntityWithId(EntityID entity_id) -> Entity * {
+  assert(mayChangeStructure());
   const std::lock_guard<std::recursive_mutex> lock(m_entityMutex);
-  if (entity_id == NULL_ENTITY) {
+  if (entity_id == NULL_ENTITY || entity_id > kMaxEntityId) {
     return nullptr;
   }
 
-  auto entity = std::make_unique<Entity>(entity_id);
-  auto *ptr = entity.get();
-  m_entities[entity_id] = std::move(entity);
+  if (auto *existing = m_entities.find(entity_id)) {
+    eraseFromQueries(existing);
+  }
+  auto *entity = m_entities.create(entity_id);
 
   if (entity_id >= m_nextEntityId) {
     m_nextEntityId = entity_id + 1;
   }
 
-  return ptr;
+  return entity;
 }
 
 void World::destroyEntity(EntityID entity_id) {
+  assert(mayChangeStructure());
   const std::lock_guard<std::recursive_mutex> lock(m_entityMutex);
-  m_entities.erase(entity_id);
+  auto *entity = m_entities.find(entity_id);
+  if (entity == nullptr) {
+    return;
+  }
+  eraseFromQueries(entity);
+  m_entities.destroy(entity_id);
 }
 
 void World::clear() {
   const std::lock_guard<std::recursive_mutex> lock(m_entityMutex);
+  for (auto &query : m_queries) {
+    query->clear();
+  }
+  m_ownerBuckets.clear();
+  m_ownerSlots.clear();
   m_entities.clear();
   m_nextEntityId = 1;
+
+  for (const auto &buffer : m_scheduler.commandBuffers()) {
+    buffer->clear();
+  }
+  const std::lock_guard<std::mutex> commands_lock(m_commandMutex);
+  for (auto &entry : m_commandBuffers) {
+    entry.second->clear();
+  }
 }
 
-auto World::getEntity(EntityID entity_id) -> Entity * {
-  const std::lock_guard<std::recursive_mutex> lock(m_entityMutex);
-  auto it = m_entities.find(entity_id);
-  return it != m_entities.end() ? it->second.get() : nullptr;
+namespace {
+
+struct CommandTarget {
+  const World *world = nullptr;
+  CommandBuffer *buffer = nullptr;
+};
+
+thread_local CommandTarget t_commandScope;
+
+// The per-thread buffer this thread last looked up, so that commands()
+// outside system updates only takes the lock the first time.
+struct ThreadBuffer {
+  std::uint64_t world_serial = 0;
+  CommandBuffer *buffer = nullptr;
+};
+
+thread_local ThreadBuffer t_threadBuffer;
+
+} // namespace
+
+World::CommandScope::CommandScope(World &world, CommandBuffer &buffer)
+    : m_previousWorld(t_commandScope.world),
+      m_previousBuffer(t_commandScope.buffer) {
+  t_commandScope = {&world, &buffer};
 }
 
-void World::addSystem(std::unique_ptr<System> system) {
-  m_systems.push_back(std::move(system));
+World::CommandScope::~CommandScope() {
+  t_commandScope = {m_previousWorld, m_previousBuffer};
 }
 
-void World::update(float deltaTime) {
-  for (auto &system : m_systems) {
-    system->update(this, deltaTime);
+auto World::mayChangeStructure() const -> bool {
+  if (t_commandScope.world == this) {
+    return true;
   }
+  auto const updating = m_updateThread.load(std::memory_order_acquire);
+  return updating == std::thread::id{} ||
+         updating == std::this_thread::get_id();
 }
 
-auto World::getUnitsOwnedBy(int owner_id) const -> std::vector<Entity *> {
-  const std::lock_guard<std::recursive_mutex> lock(m_entityMutex);
-  std::vector<Entity *> result;
-  result.reserve(m_entities.size());
-  for (const auto &[entity_id, entity] : m_entities) {
-    auto *unit = entity->getComponent<UnitComponent>();
-    if (unit == nullptr) {
-      continue;
-    }
-    if (unit->owner_id == owner_id) {
-      result.push_back(entity.get());
+auto World::commands() -> CommandBuffer & {
+  if (t_commandScope.world == this) {
+    return *t_commandScope.buffer;
+  }
+  if (t_threadBuffer.world_serial == m_serial) {
+    return *t_threadBuffer.buffer;
+  }
+
+  // Buffers live as long as the world, so the cached pointer stays valid.
+  const std::lock_guard<std::mutex> lock(m_commandMutex);
+  auto const thread_id = std::this_thread::get_id();
+  CommandBuffer *buffer = nullptr;
+  for (auto &entry : m_commandBuffers) {
+    if (entry.first == thread_id) {
+      buffer = entry.second.get();
+      break;
     }
   }
-  return result;
+  if (buffer == nullptr) {
+    m_commandBuffers.emplace_back(
+        thread_id, std::make_unique<CommandBuffer>(this, true));
+    buffer = m_commandBuffers.back().second.get();
+  }
+  t_threadBuffer = {m_serial, buffer};
+  return *buffer;
 }
 
-auto World::getUnitsNotOwnedBy(int owner_id) const -> std::vector<Entity *> {
+void World::flushCommands() {
+  ProfileZone const zone("World::flushCommands");
   const std::lock_guard<std::recursive_mutex> lock(m_entityMutex);
-  std::vector<Entity *> result;
-  result.reserve(m_entities.size());
-  for (const auto &[entity_id, entity] : m_entities) {
-    auto *unit = entity->getComponent<UnitComponent>();
-    if (unit == nullptr) {
-      continue;
-    }
-    if (unit->owner_id != owner_id) {
-      result.push_back(entity.get());
+  if (t_commandScope.world == this) {
+    while (!t_commandScope.buffer->empty()) {
+      t_commandScope.buffer->playback();
     }
+    return;
   }
-  return result;
+
+  // Playback may record more commands, so passes repeat until nothing is
+  // left. Other threads' buffers are only taken in the first pass: a thread
+  // that keeps recording would otherwise hold the flush here forever.
+  auto const thread_id = std::this_thread::get_id();
+  bool first_pass = true;
+  std::vector<CommandBuffer *> pending;
+  do {
+    pending.clear();
+    for (const auto &buffer : m_scheduler.commandBuffers()) {
+      if (!buffer->empty()) {
+        pending.push_back(buffer.get());
+      }
+    }
+    {
+      const std::lock_guard<std::mutex> commands_lock(m_commandMutex);
+      for (auto &entry : m_commandBuffers) {
+        if ((first_pass || entry.first == thread_id) &&
+            !entry.second->empty()) {
+          pending.push_back(entry.second.get());
+        }
+      }
+    }
+    for (auto *buffer : pending) {
+      buffer->playback();
+    }
+    first_pass = false;
+  } while (!pending.empty());
 }
 
-auto World::getAlliedUnits(int owner_id) const -> std::vector<Entity *> {
+auto World::getEntity(EntityID entity_id) -> Entity * {
   const std::lock_guard<std::recursive_mutex> lock(m_entityMutex);
-  std::vector<Entity *> result;
-  result.reserve(m_entities.size());
-  auto &owner_registry = Game::Systems::OwnerRegistry::instance();
+  return m_entities.find(entity_id);
+}
+
+auto World::getLiveEntity(EntityID entity_id) -> Entity * {
+  const std::lock_guard<std::recursive_mutex> lock(m_entityMutex);
+  return m_entities.findLive(entity_id);
+}
+
+auto World::getHandle(EntityID entity_id) const -> EntityHandle {
+  const std::lock_guard<std::recursive_mutex> lock(m_entityMutex);
+  return m_entities.handleOf(entity_id);
+}
 
-  for (const auto &[entity_id, entity] : m_entities) {
-    auto *unit = entity->getComponent<UnitComponent>();
-    if (unit == nullptr) {
-      continue;
+auto World::resolve(EntityHandle handle) const -> Entity * {
+  const std::lock_guard<std::recursive_mutex> lock(m_entityMutex);
+  return m_entities.resolve(handle);
+}
+
+auto World::findOrCreateQuery(ComponentMask include,
+                              ComponentMask exclude) -> Query & {
+  for (auto &query : m_queries) {
+    if (query->include() == include && query->exclude() == exclude) {
+      return *query;
     }
+  }
+  auto &query =
+      m_queries.emplace_back(std::make_unique<Query>(include, exclude));
+  m_entities.forEach([&](Entity &entity) { query->refresh(entity); });
+  return *query;
+}
 
-    if (unit->owner_id == owner_id ||
-        owner_registry.areAllies(owner_id, unit->owner_id)) {
-      result.push_back(entity.get());
+void World::onComponentChanged(Entity &entity, ComponentTypeId type) {
+  const std::lock_guard<std::recursive_mutex> lock(m_entityMutex);
+  if (type == componentTypeId<PendingRemovalComponent>) {
+    m_entities.setRetired(entity.getId(),
+                          entity.hasComponent<PendingRemovalComponent>());
+  }
+  for (auto &query : m_queries) {
+    if (query->watches(type)) {
+      query->refresh(entity);
     }
   }
-  return result;
+  if (type == componentTypeId<UnitComponent>) {
+    refreshUnitOwner(entity);
+  }
 }
 
-auto World::getEnemyUnits(int owner_id) const -> std::vector<Entity *> {
+void World::eraseFromQueries(Entity *entity) {
+  for (auto &query : m_queries) {
+    query->erase(entity);
+  }
+  unindexUnitOwner(entity);
+}
+
+void World::setUnitOwner(Entity &entity, int owner_id) {
   const std::lock_guard<std::recursive_mutex> lock(m_entityMutex);
-  std::vector<Entity *> result;
-  result.reserve(m_entities.size());
-  auto &owner_registry = Game::Systems::OwnerRegistry::instance();
+  if (auto *unit = entity.getComponent<UnitComponent>()) {
+    unit->owner_id = owner_id;
+    indexUnitOwner(entity, owner_id);
+  }
+}
 
-  for (const auto &[entity_id, entity] : m_entities) {
-    auto *unit = entity->getComponent<UnitComponent>();
-    if (unit == nullptr) {
-      continue;
-    }
+void World::refreshUnitOwner(Entity &entity) {
+  const std::lock_guard<std::recursive_mutex> lock(m_entityMutex);
+  if (auto *unit = entity.getComponent<UnitComponent>()) {
+    indexUnitOwner(entity, unit->owner_id);
+  } else {
+    unindexUnitOwner(&entity);
+  }
+}
 
-    if (owner_registry.areEnemies(owner_id, unit->owner_id)) {
-      result.push_back(entity.get());
+void World::indexUnitOwner(Entity &entity, int owner_id) {
+  auto it = m_ownerSlots.find(&entity);
+  if (it != m_ownerSlots.end()) {
+    if (m_ownerBuckets[it->second.bucket].owner_id == owner_id) {
+      return;
     }
+    unindexUnitOwner(&entity);
+  }
+
+  auto bucket_it = std::find_if(
+      m_ownerBuckets.begin(), m_ownerBuckets.end(),
+      [owner_id](const OwnerBucket &b) { return b.owner_id == owner_id; });
+  if (bucket_it == m_ownerBuckets.end()) {
+    bucket_it = m_ownerBuckets.insert(bucket_it, OwnerBucket{owner_id, {}});
+  }
+
+  auto &units = bucket_it->units;
+  m_ownerSlots[&entity] = {
+      static_cast<std::size_t>(bucket_it - m_ownerBuckets.begin()),
+      units.size()};
+  units.push_back(&entity);
+}
+
+void World::unindexUnitOwner(Entity *entity) {
+  auto it = m_ownerSlots.find(entity);
+  if (it == m_ownerSlots.end()) {
+    return;
   }
-  return result;
+  auto &units = m_ownerBuckets[it->second.bucket].units;
+  std::size_t const index = it->second.index;
+  if (index + 1 != units.size()) {
+    units[index] = units.back();
+    m_ownerSlots[units[index]].index = index;
+  }
+  units.pop_back();
+  m_ownerSlots.erase(it);
+}
+
+void World::addSystem(std::unique_ptr<System> system) {
+  m_systems.push_back(std::move(system));
+  m_scheduleDirty = true;
+}
+
+void World::update(float deltaTime) {
+  ProfileZone const zone("World::update");
+  if (m_scheduleDirty) {
+    m_scheduler.rebuild(this, m_systems);
+    m_scheduleDirty = false;
+  }
+  m_updateThread.store(std::this_thread::get_id(), std::memory_order_release);
+  m_scheduler.run(this, deltaTime);
+  m_updateThread.store(std::thread::id{}, std::memory_order_release);
+}
+
+auto World::getUnitsOwnedBy(int owner_id) const -> std::vector<Entity *> {
+  return collectUnits([owner_id](int bucket_owner) {
+    return bucket_owner == owner_id;
+  });
+}
+
+auto World::getUnitsNotOwnedBy(int owner_id) const -> std::vector<Entity *> {
+  return collectUnits([owner_id](int bucket_owner) {
+    return bucket_owner != owner_id;
+  });
+}
+
+auto World::getAlliedUnits(int owner_id) const -> std::vector<Entity *> {
+  auto &owner_registry = Game::Systems::OwnerRegistry::instance();
+  std::uint64_t const allies = owner_registry.getAllyMask(owner_id);
+  return collectUnits([&](int bucket_owner) {
+    return isAllied(owner_registry, allies, owner_id, bucket_owner);
+  });
+}
+
+auto World::getEnemyUnits(int owner_id) const -> std::vector<Entity *> {
+  auto &owner_registry = Game::Systems::OwnerRegistry::instance();
+  std::uint64_t const allies = owner_registry.getAllyMask(owner_id);
+  return collectUnits([&](int bucket_owner) {
+    return !isAllied(owner_registry, allies, owner_id, bucket_owner);
+  });
 }
 
 auto World::countTroopsForPlayer(int owner_id) -> int {
@@ -150,7 +383,7 @@ auto World::getNextEntityId() const -> EntityID {
 
 void World::setNextEntityId(EntityID next_id) {
   const std::lock_guard<std::recursive_mutex> lock(m_entityMutex);
-  m_nextEntityId = std::max(next_id, m_nextEntityId);
+  m_nextEntityId = std::max(std::min(next_id, kMaxEntityId), m_nextEntityId);
 }
 
 } // namespace Engine::Core
@@ -1,10 +1,20 @@
 #pragma once
 
+#include "command_buffer.h"
 #include "entity.h"
+#include "entity_slot_map.h"
+#include "job_system.h"
+#include "query.h"
 #include "system.h"
+#include "system_scheduler.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <mutex>
+#include <thread>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 namespace Engine::Core {
@@ -19,16 +29,57 @@ public:
   auto operator=(const World &) -> World & = delete;
   auto operator=(World &&) -> World & = delete;
 
+  // Largest ID an entity can have; the IDs above it are reserved for
+  // command buffer placeholders.
+  static constexpr EntityID kMaxEntityId = CommandBuffer::kPlaceholderBit - 1;
+
   auto createEntity() -> Entity *;
+  // Returns nullptr for NULL_ENTITY and for IDs above kMaxEntityId.
   auto createEntityWithId(EntityID entity_id) -> Entity *;
   void destroyEntity(EntityID entity_id);
   auto getEntity(EntityID entity_id) -> Entity *;
+  auto getLiveEntity(EntityID entity_id) -> Entity *;
+  auto getHandle(EntityID entity_id) const -> EntityHandle;
+  auto resolve(EntityHandle handle) const -> Entity *;
   void clear();
 
+  // Routes commands() on the current thread to a system's own buffer for as
+  // long as it lives. Scopes nest, since a thread waiting on a stage may
+  // run another system of the same stage inside its own.
+  class CommandScope {
+  public:
+    CommandScope(World &world, CommandBuffer &buffer);
+    ~CommandScope();
+
+    CommandScope(const CommandScope &) = delete;
+    CommandScope(CommandScope &&) = delete;
+    auto operator=(const CommandScope &) -> CommandScope & = delete;
+    auto operator=(CommandScope &&) -> CommandScope & = delete;
+
+  private:
+    const World *m_previousWorld;
+    CommandBuffer *m_previousBuffer;
+  };
+
+  // The buffer of the system running on this thread, or a per-thread buffer
+  // outside system updates. Threads other than the sim thread, such as the
+  // GUI thread handling orders, change the world's structure only through
+  // here, so their changes land at the next sync point instead of under an
+  // open query view.
+  auto commands() -> CommandBuffer &;
+  // Plays back every system's buffer in registration order, then the
+  // per-thread buffers. Other threads' buffers are played back once per
+  // flush; what they record meanwhile waits for the next one. Called from
+  // inside a system update it plays back only that system's own buffer.
+  void flushCommands();
+
   void addSystem(std::unique_ptr<System> system);
   void update(float deltaTime);
 
-  auto systems() -> std::vector<std::unique_ptr<System>> & { return m_systems; }
+  auto systems() -> std::vector<std::unique_ptr<System>> & {
+    m_scheduleDirty = true;
+    return m_systems;
+  }
 
   template <typename T> auto getSystem() -> T * {
     for (auto &system : m_systems) {
@@ -39,15 +90,50 @@ public:
     return nullptr;
   }
 
+  template <typename... Ts, typename... Xs>
+  auto query(Without<Xs...> /*exclude*/ = {}) -> QueryView {
+    static_assert(sizeof...(Ts) > 0, "A query needs at least one component");
+    const std::lock_guard<std::recursive_mutex> lock(m_entityMutex);
+    return QueryView(
+        findOrCreateQuery(componentMask<Ts...>(), componentMask<Xs...>()),
+        m_entityMutex);
+  }
+
   template <typename T> auto getEntitiesWith() -> std::vector<Entity *> {
     const std::lock_guard<std::recursive_mutex> lock(m_entityMutex);
     std::vector<Entity *> result;
-    for (auto &[entity_id, entity] : m_entities) {
-      if (entity->template hasComponent<T>()) {
-        result.push_back(entity.get());
+    findOrCreateQuery(componentMask<T>(), 0).copyTo(result);
+    return result;
+  }
+
+  template <typename T, typename Fn> void forEach(Fn &&fn) {
+    const std::lock_guard<std::recursive_mutex> lock(m_entityMutex);
+    if (auto *pool = m_componentStorage.findPool<T>()) {
+      pool->forEach(std::forward<Fn>(fn));
+    }
+  }
+
+  // Splits the pool across JobSystem workers. Only the slot range is taken
+  // under the entity lock; the callbacks run without it, so other systems
+  // of the stage can open queries meanwhile. That relies on T's pool not
+  // changing during the pass: adds and removes of T wait for command
+  // playback or run in systems whose declared writes to T keep them out of
+  // the caller's stage. The callback must only touch the entity it is given.
+  template <typename T, typename Fn> void parallelForEach(Fn &&fn) {
+    ComponentPool<T> *pool = nullptr;
+    std::size_t slots = 0;
+    {
+      const std::lock_guard<std::recursive_mutex> lock(m_entityMutex);
+      pool = m_componentStorage.findPool<T>();
+      if (pool == nullptr || pool->size() == 0) {
+        return;
       }
+      slots = pool->slotCount();
     }
-    return result;
+    JobSystem::instance().parallelFor(
+        slots, kParallelGrain, [&](std::size_t begin, std::size_t end) {
+          pool->forEachInSlots(begin, end, fn);
+        });
   }
 
   auto getUnitsOwnedBy(int owner_id) const -> std::vector<Entity *>;
@@ -56,9 +142,14 @@ public:
   auto getEnemyUnits(int owner_id) const -> std::vector<Entity *>;
   static auto countTroopsForPlayer(int owner_id) -> int;
 
-  auto getEntities() const
-      -> const std::unordered_map<EntityID, std::unique_ptr<Entity>> & {
-    return m_entities;
+  // Assigns the owner of the entity's UnitComponent and moves it to that
+  // owner's bucket. Owner changes after the component is added (spawns,
+  // captures, loads) go through here so the index never goes stale.
+  void setUnitOwner(Entity &entity, int owner_id);
+
+  template <typename Fn> void forEachEntity(Fn &&fn) const {
+    const std::lock_guard<std::recursive_mutex> lock(m_entityMutex);
+    m_entities.forEach(std::forward<Fn>(fn));
   }
 
   auto getNextEntityId() const -> EntityID;
@@ -67,9 +158,60 @@ public:
   auto getEntityMutex() -> std::recursive_mutex & { return m_entityMutex; }
 
 private:
+  auto findOrCreateQuery(ComponentMask include,
+                         ComponentMask exclude) -> Query &;
+
+  static constexpr std::size_t kParallelGrain = 256;
+
+  void onComponentChanged(Entity &entity, ComponentTypeId type);
+  // Structure may change on the thread running update(), in the systems it
+  // runs on the workers, and on any thread between updates, e.g. loaders.
+  // Other threads record into commands() instead.
+  [[nodiscard]] auto mayChangeStructure() const -> bool;
+  void eraseFromQueries(Entity *entity);
+
+  struct OwnerBucket {
+    int owner_id = 0;
+    std::vector<Entity *> units;
+  };
+
+  struct OwnerSlot {
+    std::size_t bucket = 0;
+    std::size_t index = 0;
+  };
+
+  template <typename Pred>
+  auto collectUnits(Pred &&pred) const -> std::vector<Entity *> {
+    const std::lock_guard<std::recursive_mutex> lock(m_entityMutex);
+    std::vector<Entity *> result;
+    for (const auto &bucket : m_ownerBuckets) {
+      if (pred(bucket.owner_id)) {
+        result.insert(result.end(), bucket.units.begin(), bucket.units.end());
+      }
+    }
+    return result;
+  }
+
+  void refreshUnitOwner(Entity &entity);
+  void indexUnitOwner(Entity &entity, int owner_id);
+  void unindexUnitOwner(Entity *entity);
+
   EntityID m_nextEntityId = 1;
-  std::unordered_map<EntityID, std::unique_ptr<Entity>> m_entities;
+  ComponentStorage m_componentStorage;
+  EntitySlotMap m_entities;
+  std::vector<std::unique_ptr<Query>> m_queries;
   std::vector<std::unique_ptr<System>> m_systems;
+  SystemScheduler m_scheduler;
+  bool m_scheduleDirty = true;
+  std::vector<std::pair<std::thread::id, std::unique_ptr<CommandBuffer>>>
+      m_commandBuffers;
+  std::mutex m_commandMutex;
+  // Distinguishes this world from earlier ones at the same address in the
+  // per-thread buffer cache.
+  const std::uint64_t m_serial;
+  std::atomic<std::thread::id> m_updateThread{};
+  std::vector<OwnerBucket> m_ownerBuckets;
+  std::unordered_map<Entity *, OwnerSlot> m_ownerSlots;
   mutable std::recursive_mutex m_entityMutex;
 };
 
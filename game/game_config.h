@@ -20,6 +20,7 @@ struct ArrowConfig {
 
 struct GameplayConfig {
   float visibility_update_interval = 0.075F;
+  bool vision_terrain_occlusion = false;
   float formationSpacingDefault = 1.0F;
   int max_troops_per_player = 50;
 };
@@ -72,6 +73,10 @@ public:
     return m_gameplay.visibility_update_interval;
   }
 
+  [[nodiscard]] auto getVisionTerrainOcclusion() const noexcept -> bool {
+    return m_gameplay.vision_terrain_occlusion;
+  }
+
   [[nodiscard]] auto getFormationSpacingDefault() const noexcept -> float {
     return m_gameplay.formationSpacingDefault;
   }
@@ -114,6 +119,10 @@ public:
     m_gameplay.visibility_update_interval = value;
   }
 
+  void setVisionTerrainOcclusion(bool enabled) noexcept {
+    m_gameplay.vision_terrain_occlusion = enabled;
+  }
+
   void setFormationSpacingDefault(float value) noexcept {
     m_gameplay.formationSpacingDefault = value;
   }
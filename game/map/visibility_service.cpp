@@ -2,17 +2,25 @@
 
 #include "../core/component.h"
 #include "../core/ownership_constants.h"
+#include "../core/profiler.h"
 #include "../core/world.h"
 #include "../systems/owner_registry.h"
+#include "terrain_service.h"
+#include "vision_raster.h"
 
 #include <algorithm>
 #include <atomic>
+#include <bit>
 #include <chrono>
 #include <cmath>
+#include <cstddef>
 #include <cstdint>
 #include <future>
+#include <limits>
+#include <memory>
 #include <mutex>
 #include <shared_mutex>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -23,20 +31,12 @@ namespace {
 constexpr float k_default_vision_range = 12.0F;
 constexpr float k_half_cell_offset = 0.5F;
 constexpr float k_min_tile_size = 0.0001F;
-
-auto inBoundsStatic(int grid_x, int grid_z, int width, int height) -> bool {
-  return grid_x >= 0 && grid_x < width && grid_z >= 0 && grid_z < height;
-}
+constexpr float k_eye_height = 1.5F;
 
 auto indexStatic(int grid_x, int grid_z, int width) -> int {
   return grid_z * width + grid_x;
 }
 
-auto worldToGridStatic(float world_coord, float half, float tile_size) -> int {
-  const float grid_coord = world_coord / tile_size + half;
-  return static_cast<int>(std::floor(grid_coord + k_half_cell_offset));
-}
-
 } // namespace
 
 auto VisibilityService::instance() -> VisibilityService & {
@@ -56,8 +56,20 @@ void VisibilityService::initialize(int width, int height, float tile_size) {
 
   const int count = m_width * m_height;
   m_cells.assign(count, static_cast<std::uint8_t>(VisibilityState::Unseen));
+  m_visibleMasks.assign(count, 0);
+  m_exploredMasks.assign(count, 0);
+  m_dirtyTilesX = (m_width + kDirtyTileSize - 1) / kDirtyTileSize;
+  m_dirtyTilesZ = (m_height + kDirtyTileSize - 1) / kDirtyTileSize;
+  m_dirtyTiles.assign(
+      static_cast<std::size_t>(m_dirtyTilesX) * m_dirtyTilesZ, 1);
+  m_localMask = 0;
+  for (auto &owner_version : m_ownerVersions) {
+    owner_version.fetch_add(1, std::memory_order_release);
+  }
   m_version.store(1, std::memory_order_release);
   m_generation.store(0, std::memory_order_release);
+  m_terrainDirty = true;
+  resetStampState();
   m_initialized = true;
 }
 
@@ -68,20 +80,75 @@ void VisibilityService::reset() {
   std::unique_lock<std::shared_mutex> const lock(m_cellsMutex);
   std::fill(m_cells.begin(), m_cells.end(),
             static_cast<std::uint8_t>(VisibilityState::Unseen));
+  std::fill(m_visibleMasks.begin(), m_visibleMasks.end(), 0);
+  std::fill(m_exploredMasks.begin(), m_exploredMasks.end(), 0);
+  markAllDirty();
+  resetStampState();
+  for (auto &owner_version : m_ownerVersions) {
+    owner_version.fetch_add(1, std::memory_order_release);
+  }
   m_version.fetch_add(1, std::memory_order_release);
 }
 
+void VisibilityService::resetStampState() {
+  // A job still running against the old counts is dropped when it returns.
+  ++m_epoch;
+  m_stamps.slot_count = 0;
+  m_stamps.observers.clear();
+  m_stamps.visible.assign(m_cells.size(), 0);
+  m_stamps.stamped.clear();
+  m_stamps.occluders.reset();
+  m_stamps.sight_tables.clear();
+}
+
+void VisibilityService::setTerrainOcclusion(bool enabled) {
+  m_terrainOcclusion = enabled;
+}
+
+void VisibilityService::markTerrainDirty() { m_terrainDirty = true; }
+
+auto VisibilityService::currentOccluders()
+    -> std::shared_ptr<const std::vector<float>> {
+  if (!m_terrainOcclusion) {
+    return nullptr;
+  }
+  if (!m_terrainDirty && m_occluders) {
+    return m_occluders;
+  }
+
+  // A new grid also tells the next job to restamp every source against it.
+  const auto &terrain = TerrainService::instance();
+  auto heights = std::make_shared<std::vector<float>>(m_cells.size(), 0.0F);
+  for (int grid_z = 0; grid_z < m_height; ++grid_z) {
+    const float world_z =
+        (static_cast<float>(grid_z) - m_half_height) * m_tile_size;
+    for (int grid_x = 0; grid_x < m_width; ++grid_x) {
+      const float world_x =
+          (static_cast<float>(grid_x) - m_half_width) * m_tile_size;
+      (*heights)[index(grid_x, grid_z)] =
+          terrain.getTerrainHeight(world_x, world_z);
+    }
+  }
+  m_occluders = std::move(heights);
+  m_terrainDirty = false;
+  return m_occluders;
+}
+
 auto VisibilityService::update(Engine::Core::World &world,
                                int player_id) -> bool {
+  Engine::Core::ProfileZone const zone("VisibilityService::update");
   if (!m_initialized) {
     return false;
   }
 
+  refreshLocalView(player_id);
   const bool integrated = integrateCompletedJob();
 
   if (!m_jobActive.load(std::memory_order_acquire)) {
-    const auto sources = gatherVisionSources(world, player_id);
-    auto payload = composeJobPayload(sources);
+    const auto slot_count = std::min(
+        Game::Systems::OwnerRegistry::instance().getAllOwners().size(),
+        kMaxOwnerSlots);
+    auto payload = composeJobPayload(gatherVisionSources(world), slot_count);
     startAsyncJob(std::move(payload));
   }
 
@@ -94,23 +161,55 @@ void VisibilityService::computeImmediate(Engine::Core::World &world,
     return;
   }
 
-  const auto sources = gatherVisionSources(world, player_id);
-  auto payload = composeJobPayload(sources);
-  auto result = executeJob(std::move(payload));
+  // The stamp state travels with the running job, so let it land first.
+  if (m_jobActive.load(std::memory_order_acquire)) {
+    m_pendingJob.wait();
+    integrateCompletedJob();
+  }
 
-  if (result.changed) {
-    std::unique_lock<std::shared_mutex> const lock(m_cellsMutex);
-    m_cells = std::move(result.cells);
-    m_version.fetch_add(1, std::memory_order_release);
+  refreshLocalView(player_id);
+  const auto slot_count = std::min(
+      Game::Systems::OwnerRegistry::instance().getAllOwners().size(),
+      kMaxOwnerSlots);
+  auto payload = composeJobPayload(gatherVisionSources(world), slot_count);
+  applyJobResult(executeJob(std::move(payload)));
+}
+
+auto VisibilityService::viewMask(int player_id) -> std::uint64_t {
+  const auto &owner_registry = Game::Systems::OwnerRegistry::instance();
+  return owner_registry.getAllyMask(player_id) |
+         owner_registry.getOwnerBit(player_id);
+}
+
+auto VisibilityService::localState(int idx) const -> std::uint8_t {
+  if ((m_visibleMasks[idx] & m_localMask) != 0) {
+    return static_cast<std::uint8_t>(VisibilityState::Visible);
+  }
+  if ((m_exploredMasks[idx] & m_localMask) != 0) {
+    return static_cast<std::uint8_t>(VisibilityState::Explored);
+  }
+  return static_cast<std::uint8_t>(VisibilityState::Unseen);
+}
+
+void VisibilityService::refreshLocalView(int player_id) {
+  const auto mask = viewMask(player_id);
+  if (mask == m_localMask) {
+    return;
   }
+  std::unique_lock<std::shared_mutex> const lock(m_cellsMutex);
+  m_localMask = mask;
+  for (int idx = 0; idx < static_cast<int>(m_cells.size()); ++idx) {
+    m_cells[idx] = localState(idx);
+  }
+  markAllDirty();
+  m_version.fetch_add(1, std::memory_order_release);
 }
 
-auto VisibilityService::gatherVisionSources(Engine::Core::World &world,
-                                            int player_id) const
+auto VisibilityService::gatherVisionSources(Engine::Core::World &world) const
     -> std::vector<VisibilityService::VisionSource> {
   std::vector<VisionSource> sources;
-  const auto entities =
-      world.getEntitiesWith<Engine::Core::TransformComponent>();
+  const auto entities = world.query<Engine::Core::TransformComponent,
+                                    Engine::Core::UnitComponent>();
   const float range_padding = m_tile_size * k_half_cell_offset;
 
   auto &owner_registry = Game::Systems::OwnerRegistry::instance();
@@ -126,8 +225,8 @@ auto VisibilityService::gatherVisionSources(Engine::Core::World &world,
       continue;
     }
 
-    if (unit->owner_id != player_id &&
-        !owner_registry.areAllies(player_id, unit->owner_id)) {
+    const std::uint64_t owner_bit = owner_registry.getOwnerBit(unit->owner_id);
+    if (owner_bit == 0) {
       continue;
     }
 
@@ -148,20 +247,27 @@ auto VisibilityService::gatherVisionSources(Engine::Core::World &world,
     const float expanded_range_sq =
         (vision_range + range_padding) * (vision_range + range_padding);
 
-    sources.push_back({center_x, center_z, cell_radius, expanded_range_sq});
+    sources.push_back({entity->getId(), std::countr_zero(owner_bit), center_x,
+                       center_z, cell_radius, expanded_range_sq});
   }
 
   return sources;
 }
 
-auto VisibilityService::composeJobPayload(
-    const std::vector<VisionSource> &sources) const
+auto VisibilityService::composeJobPayload(std::vector<VisionSource> &&sources,
+                                          std::size_t slot_count)
     -> VisibilityService::JobPayload {
-  std::shared_lock<std::shared_mutex> const lock(m_cellsMutex);
   const auto generation_value =
       m_generation.fetch_add(1ULL, std::memory_order_relaxed);
-  return JobPayload{m_width, m_height, m_tile_size,
-                    m_cells, sources,  generation_value};
+  return JobPayload{m_width,
+                    m_height,
+                    m_tile_size,
+                    slot_count,
+                    currentOccluders(),
+                    std::move(m_stamps),
+                    std::move(sources),
+                    generation_value,
+                    m_epoch};
 }
 
 void VisibilityService::startAsyncJob(JobPayload &&payload) {
@@ -181,65 +287,233 @@ auto VisibilityService::integrateCompletedJob() -> bool {
 
   auto result = m_pendingJob.get();
   m_jobActive.store(false, std::memory_order_release);
+  return applyJobResult(std::move(result));
+}
 
-  if (result.changed) {
+auto VisibilityService::applyJobResult(JobResult &&result) -> bool {
+  if (result.epoch != m_epoch) {
+    return false;
+  }
+  m_stamps = std::move(result.state);
+  if (result.changes.empty()) {
+    return false;
+  }
+
+  std::uint64_t touched_owners = 0;
+  bool changed = false;
+  {
     std::unique_lock<std::shared_mutex> const lock(m_cellsMutex);
-    m_cells = std::move(result.cells);
+    for (const auto &change : result.changes) {
+      touched_owners |= m_visibleMasks[change.index] ^ change.visible;
+      m_visibleMasks[change.index] = change.visible;
+      m_exploredMasks[change.index] |= change.visible;
+      const auto state = localState(change.index);
+      if (m_cells[change.index] != state) {
+        m_cells[change.index] = state;
+        markDirty(change.index);
+        changed = true;
+      }
+    }
+  }
+
+  for (; touched_owners != 0; touched_owners &= touched_owners - 1) {
+    m_ownerVersions[std::countr_zero(touched_owners)].fetch_add(
+        1, std::memory_order_release);
+  }
+  if (changed) {
     m_version.fetch_add(1, std::memory_order_release);
-    return true;
   }
+  return changed;
+}
 
-  return false;
+auto VisibilityService::buildSightTable(const VisionSource &source,
+                                        float tile_size)
+    -> VisibilityService::SightTable {
+  struct Entry {
+    int ring;
+    int dx;
+    int dz;
+  };
+  const int radius = source.cell_radius;
+  const int side = 2 * radius + 1;
+  std::vector<Entry> entries;
+  forEachSpanInRange(radius, radius, radius, source.expanded_range_sq, side,
+                     side, tile_size, [&](int first_idx, int length) {
+                       for (int idx = first_idx; idx < first_idx + length;
+                            ++idx) {
+                         const int dx = idx % side - radius;
+                         const int dz = idx / side - radius;
+                         entries.push_back(
+                             {std::max(std::abs(dx), std::abs(dz)), dx, dz});
+                       }
+                     });
+  std::stable_sort(
+      entries.begin(), entries.end(),
+      [](const Entry &a, const Entry &b) { return a.ring < b.ring; });
+
+  SightTable table{radius, source.expanded_range_sq, {}, {}, {}, {}};
+  std::vector<int> slot_of(static_cast<std::size_t>(side * side), -1);
+  for (const auto &entry : entries) {
+    slot_of[(entry.dz + radius) * side + entry.dx + radius] =
+        static_cast<int>(table.dx.size());
+    table.dx.push_back(entry.dx);
+    table.dz.push_back(entry.dz);
+  }
+  // The parent scales the offset back by one ring, which keeps it on the
+  // ray and inside the circle, so it is always earlier in the table.
+  for (const auto &entry : entries) {
+    if (entry.ring == 0) {
+      table.parent.push_back(-1);
+      table.inv_distance.push_back(0.0F);
+      continue;
+    }
+    const float scale =
+        static_cast<float>(entry.ring - 1) / static_cast<float>(entry.ring);
+    const int parent_x =
+        static_cast<int>(std::lround(static_cast<float>(entry.dx) * scale));
+    const int parent_z =
+        static_cast<int>(std::lround(static_cast<float>(entry.dz) * scale));
+    table.parent.push_back(slot_of[(parent_z + radius) * side + parent_x +
+                                   radius]);
+    const float distance =
+        std::sqrt(
+            static_cast<float>(entry.dx * entry.dx + entry.dz * entry.dz)) *
+        tile_size;
+    table.inv_distance.push_back(1.0F / distance);
+  }
+  return table;
 }
 
 auto VisibilityService::executeJob(JobPayload payload)
     -> VisibilityService::JobResult {
-  const int cell_count = payload.width * payload.height;
-  std::vector<std::uint8_t> current_visible(cell_count, 0U);
+  auto &state = payload.state;
+  const std::size_t slot_count = payload.slot_count;
+  const std::size_t cell_count = state.visible.size();
+  std::vector<int> candidates;
+
+  // A new owner reshapes the counts and new terrain heights change every
+  // footprint; either way every source is stamped again and each cell
+  // someone saw is rechecked against the fresh counts.
+  if (state.slot_count != slot_count || state.occluders != payload.occluders) {
+    state.slot_count = slot_count;
+    state.occluders = payload.occluders;
+    state.observers.assign(cell_count * slot_count, 0);
+    state.stamped.clear();
+    for (int idx = 0; idx < static_cast<int>(cell_count); ++idx) {
+      if (state.visible[idx] != 0) {
+        candidates.push_back(idx);
+      }
+    }
+  }
 
+  std::unordered_map<std::uint32_t, VisionSource> next;
+  next.reserve(payload.sources.size());
   for (const auto &source : payload.sources) {
-    for (int dz = -source.cell_radius; dz <= source.cell_radius; ++dz) {
-      const int grid_z = source.center_z + dz;
-      if (!inBoundsStatic(source.center_x, grid_z, payload.width,
-                          payload.height)) {
+    if (static_cast<std::size_t>(source.owner_slot) < slot_count) {
+      next.emplace(source.entity_id, source);
+    }
+  }
+
+  // Rings only read the ring before them, so each one is a flat pass over
+  // the table's arrays. Cells off the map block the rest of their ray.
+  auto stampInSight = [&](const VisionSource &source, std::uint16_t *plane,
+                          int delta) {
+    auto table = std::find_if(
+        state.sight_tables.begin(), state.sight_tables.end(),
+        [&](const SightTable &entry) {
+          return entry.cell_radius == source.cell_radius &&
+                 entry.range_sq == source.expanded_range_sq;
+        });
+    if (table == state.sight_tables.end()) {
+      state.sight_tables.push_back(
+          buildSightTable(source, payload.tile_size));
+      table = std::prev(state.sight_tables.end());
+    }
+
+    const auto &heights = *state.occluders;
+    const std::size_t count = table->dx.size();
+    state.slopes.resize(count);
+    state.horizons.resize(count);
+    auto *slopes = state.slopes.data();
+    auto *horizons = state.horizons.data();
+    const float eye =
+        heights[indexStatic(source.center_x, source.center_z, payload.width)] +
+        k_eye_height;
+    for (std::size_t i = 0; i < count; ++i) {
+      const int grid_x = source.center_x + table->dx[i];
+      const int grid_z = source.center_z + table->dz[i];
+      if (grid_x < 0 || grid_x >= payload.width || grid_z < 0 ||
+          grid_z >= payload.height) {
+        slopes[i] = std::numeric_limits<float>::max();
+        horizons[i] = std::numeric_limits<float>::max();
         continue;
       }
-      const float world_dz = static_cast<float>(dz) * payload.tile_size;
-      for (int dx = -source.cell_radius; dx <= source.cell_radius; ++dx) {
-        const int grid_x = source.center_x + dx;
-        if (!inBoundsStatic(grid_x, grid_z, payload.width, payload.height)) {
-          continue;
-        }
-        const float world_dx = static_cast<float>(dx) * payload.tile_size;
-        const float dist_sq = world_dx * world_dx + world_dz * world_dz;
-        if (dist_sq <= source.expanded_range_sq) {
-          const int idx = indexStatic(grid_x, grid_z, payload.width);
-          current_visible[idx] = 1U;
-        }
+      const int idx = indexStatic(grid_x, grid_z, payload.width);
+      const int parent = table->parent[i];
+      if (parent < 0) {
+        slopes[i] = std::numeric_limits<float>::lowest();
+        horizons[i] = std::numeric_limits<float>::lowest();
+      } else {
+        slopes[i] = (heights[idx] - eye) * table->inv_distance[i];
+        horizons[i] = std::max(horizons[parent], slopes[parent]);
+      }
+      if (slopes[i] >= horizons[i]) {
+        addToSpan(plane + idx, idx, 1, delta, candidates);
       }
     }
+  };
+
+  // Each owner's counts form one plane in grid order, so a row of a circle
+  // is a contiguous run of counts.
+  auto stamp = [&](const VisionSource &source, int delta) {
+    auto *plane = state.observers.data() +
+                  static_cast<std::size_t>(source.owner_slot) * cell_count;
+    if (state.occluders) {
+      stampInSight(source, plane, delta);
+      return;
+    }
+    forEachSpanInRange(source.center_x, source.center_z, source.cell_radius,
+                       source.expanded_range_sq, payload.width,
+                       payload.height, payload.tile_size,
+                       [&](int first_idx, int length) {
+                         addToSpan(plane + first_idx, first_idx, length, delta,
+                                   candidates);
+                       });
+  };
+
+  for (const auto &[entity_id, source] : state.stamped) {
+    auto const it = next.find(entity_id);
+    if (it == next.end() || !(it->second == source)) {
+      stamp(source, -1);
+    }
+  }
+  for (const auto &[entity_id, source] : next) {
+    auto const it = state.stamped.find(entity_id);
+    if (it == state.stamped.end() || !(it->second == source)) {
+      stamp(source, 1);
+    }
   }
 
-  bool changed = false;
-  for (int idx = 0; idx < cell_count; ++idx) {
-    const std::uint8_t now_visible = current_visible[idx];
-    const auto visible_val =
-        static_cast<std::uint8_t>(VisibilityState::Visible);
-    const auto explored_val =
-        static_cast<std::uint8_t>(VisibilityState::Explored);
-
-    if (now_visible != 0U) {
-      if (payload.cells[idx] != visible_val) {
-        payload.cells[idx] = visible_val;
-        changed = true;
+  // A cell crossing zero for some owner may have crossed back within the
+  // same job, so the mask is rebuilt from the counts before reporting it.
+  JobResult result{{}, {}, payload.generation, payload.epoch};
+  for (const int idx : candidates) {
+    std::uint64_t mask = 0;
+    for (std::size_t slot = 0; slot < slot_count; ++slot) {
+      if (state.observers[slot * cell_count + static_cast<std::size_t>(idx)] !=
+          0) {
+        mask |= std::uint64_t{1} << slot;
       }
-    } else if (payload.cells[idx] == visible_val) {
-      payload.cells[idx] = explored_val;
-      changed = true;
+    }
+    if (mask != state.visible[idx]) {
+      state.visible[idx] = mask;
+      result.changes.push_back({idx, mask});
     }
   }
 
-  return JobResult{std::move(payload.cells), payload.generation, changed};
+  state.stamped = std::move(next);
+  result.state = std::move(state);
+  return result;
 }
 
 auto VisibilityService::stateAt(int grid_x,
@@ -282,11 +556,97 @@ auto VisibilityService::isExploredWorld(float world_x,
          state == static_cast<std::uint8_t>(VisibilityState::Explored);
 }
 
+auto VisibilityService::isVisibleWorld(int player_id, float world_x,
+                                       float world_z) const -> bool {
+  if (!m_initialized) {
+    return true;
+  }
+  const int idx = worldToIndex(world_x, world_z);
+  if (idx < 0) {
+    return false;
+  }
+  const auto mask = viewMask(player_id);
+  std::shared_lock<std::shared_mutex> const lock(m_cellsMutex);
+  return (m_visibleMasks[idx] & mask) != 0;
+}
+
+auto VisibilityService::isExploredWorld(int player_id, float world_x,
+                                        float world_z) const -> bool {
+  if (!m_initialized) {
+    return true;
+  }
+  const int idx = worldToIndex(world_x, world_z);
+  if (idx < 0) {
+    return false;
+  }
+  const auto mask = viewMask(player_id);
+  std::shared_lock<std::shared_mutex> const lock(m_cellsMutex);
+  return (m_exploredMasks[idx] & mask) != 0;
+}
+
+auto VisibilityService::playerVersion(int player_id) const -> std::uint64_t {
+  // The counters only grow, so their sum over the player's alliance changes
+  // exactly when one of them does.
+  std::uint64_t version = 0;
+  for (auto mask = viewMask(player_id); mask != 0; mask &= mask - 1) {
+    version += m_ownerVersions[std::countr_zero(mask)].load(
+        std::memory_order_acquire);
+  }
+  return version;
+}
+
 auto VisibilityService::snapshotCells() const -> std::vector<std::uint8_t> {
   std::shared_lock<std::shared_mutex> const lock(m_cellsMutex);
   return m_cells;
 }
 
+void VisibilityService::markDirty(int idx) {
+  const int tile_x = (idx % m_width) / kDirtyTileSize;
+  const int tile_z = (idx / m_width) / kDirtyTileSize;
+  m_dirtyTiles[tile_z * m_dirtyTilesX + tile_x] = 1;
+}
+
+void VisibilityService::markAllDirty() {
+  std::fill(m_dirtyTiles.begin(), m_dirtyTiles.end(), 1);
+}
+
+auto VisibilityService::takeDirtyRegions() -> std::vector<VisibilityRegion> {
+  std::vector<VisibilityRegion> regions;
+  std::unique_lock<std::shared_mutex> const lock(m_cellsMutex);
+  // Dirty tiles next to each other on a row come out as one region.
+  for (int tile_z = 0; tile_z < m_dirtyTilesZ; ++tile_z) {
+    auto *row = m_dirtyTiles.data() + tile_z * m_dirtyTilesX;
+    for (int tile_x = 0; tile_x < m_dirtyTilesX; ++tile_x) {
+      if (row[tile_x] == 0) {
+        continue;
+      }
+      const int first = tile_x;
+      while (tile_x + 1 < m_dirtyTilesX && row[tile_x + 1] != 0) {
+        ++tile_x;
+      }
+      std::fill(row + first, row + tile_x + 1, 0);
+      regions.push_back(
+          {first * kDirtyTileSize, tile_z * kDirtyTileSize,
+           std::min((tile_x + 1) * kDirtyTileSize, m_width) - 1,
+           std::min((tile_z + 1) * kDirtyTileSize, m_height) - 1});
+    }
+  }
+  return regions;
+}
+
+void VisibilityService::copyCells(const VisibilityRegion &region,
+                                  std::vector<std::uint8_t> &out) const {
+  const int row_length = region.max_x - region.min_x + 1;
+  out.resize(static_cast<std::size_t>(row_length) *
+             (region.max_z - region.min_z + 1));
+  std::shared_lock<std::shared_mutex> const lock(m_cellsMutex);
+  auto dest = out.begin();
+  for (int grid_z = region.min_z; grid_z <= region.max_z; ++grid_z) {
+    const auto source = m_cells.begin() + index(region.min_x, grid_z);
+    dest = std::copy(source, source + row_length, dest);
+  }
+}
+
 auto VisibilityService::inBounds(int grid_x, int grid_z) const -> bool {
   return grid_x >= 0 && grid_x < m_width && grid_z >= 0 && grid_z < m_height;
 }
@@ -295,6 +655,13 @@ auto VisibilityService::index(int grid_x, int grid_z) const -> int {
   return grid_z * m_width + grid_x;
 }
 
+auto VisibilityService::worldToIndex(float world_x, float world_z) const
+    -> int {
+  const int grid_x = worldToGrid(world_x, m_half_width);
+  const int grid_z = worldToGrid(world_z, m_half_height);
+  return inBounds(grid_x, grid_z) ? index(grid_x, grid_z) : -1;
+}
+
 auto VisibilityService::worldToGrid(float world_coord,
                                     float half) const -> int {
   const float grid_coord = world_coord / m_tile_size + half;
@@ -1,10 +1,14 @@
 #pragma once
 
+#include <array>
 #include <atomic>
+#include <cstddef>
 #include <cstdint>
 #include <future>
+#include <memory>
 #include <mutex>
 #include <shared_mutex>
+#include <unordered_map>
 #include <vector>
 
 namespace Engine::Core {
@@ -19,6 +23,14 @@ enum class VisibilityState : std::uint8_t {
   Visible = 2
 };
 
+// Inclusive cell rectangle of the visibility grid.
+struct VisibilityRegion {
+  int min_x;
+  int min_z;
+  int max_x;
+  int max_z;
+};
+
 class VisibilityService {
 public:
   static auto instance() -> VisibilityService &;
@@ -28,6 +40,11 @@ public:
   auto update(Engine::Core::World &world, int player_id) -> bool;
   void computeImmediate(Engine::Core::World &world, int player_id);
 
+  // Lets hills and mountains block sight. Cell heights are sampled from the
+  // terrain once per terrain change rather than on every job.
+  void setTerrainOcclusion(bool enabled);
+  void markTerrainDirty();
+
   auto isInitialized() const -> bool { return m_initialized; }
 
   auto getWidth() const -> int { return m_width; }
@@ -38,7 +55,21 @@ public:
   auto isVisibleWorld(float world_x, float world_z) const -> bool;
   auto isExploredWorld(float world_x, float world_z) const -> bool;
 
+  // Fog of any player, allies' vision included, from the same pass over the
+  // vision sources that serves the local view. The version only advances
+  // when a cell changes for that player or one of their allies.
+  auto isVisibleWorld(int player_id, float world_x,
+                      float world_z) const -> bool;
+  auto isExploredWorld(int player_id, float world_x,
+                       float world_z) const -> bool;
+  auto playerVersion(int player_id) const -> std::uint64_t;
+
   auto snapshotCells() const -> std::vector<std::uint8_t>;
+  // Regions whose local cells changed since the last call, so a consumer
+  // can copy just those instead of the whole grid.
+  auto takeDirtyRegions() -> std::vector<VisibilityRegion>;
+  void copyCells(const VisibilityRegion &region,
+                 std::vector<std::uint8_t> &out) const;
   auto version() const -> std::uint64_t {
     return m_version.load(std::memory_order_relaxed);
   }
@@ -47,35 +78,91 @@ private:
   auto inBounds(int x, int z) const -> bool;
   auto index(int x, int z) const -> int;
   auto worldToGrid(float world_coord, float half) const -> int;
+  auto worldToIndex(float world_x, float world_z) const -> int;
+  static auto viewMask(int player_id) -> std::uint64_t;
+  auto localState(int idx) const -> std::uint8_t;
+  void refreshLocalView(int player_id);
+  void markDirty(int idx);
+  void markAllDirty();
+
+  // One bit per owner, indexed like the owner registry's alliance masks.
+  static constexpr std::size_t kMaxOwnerSlots = 64;
+  static constexpr int kDirtyTileSize = 16;
 
   struct VisionSource {
+    std::uint32_t entity_id;
+    int owner_slot;
     int center_x;
     int center_z;
     int cell_radius;
     float expanded_range_sq;
+
+    auto operator==(const VisionSource &) const -> bool = default;
+  };
+
+  // The cells of one vision circle ordered ring by ring outwards, each
+  // pointing at its neighbour one ring closer along the ray from the centre.
+  // A cell is in sight when it rises above every cell its ray crossed.
+  struct SightTable {
+    int cell_radius;
+    float range_sq;
+    std::vector<int> dx;
+    std::vector<int> dz;
+    std::vector<int> parent;
+    std::vector<float> inv_distance;
+  };
+
+  // How many sources of each owner see each cell, the owner bits that
+  // leaves visible, and the sources stamped into those counts. A job only
+  // restamps the sources that moved, appeared or left, so its cost follows
+  // the moving units rather than every unit's vision area. The running job
+  // owns the state while one is active.
+  struct StampState {
+    std::size_t slot_count = 0;
+    std::vector<std::uint16_t> observers;
+    std::vector<std::uint64_t> visible;
+    std::unordered_map<std::uint32_t, VisionSource> stamped;
+    std::shared_ptr<const std::vector<float>> occluders;
+    std::vector<SightTable> sight_tables;
+    std::vector<float> slopes;
+    std::vector<float> horizons;
+  };
+
+  struct CellMask {
+    int index;
+    std::uint64_t visible;
   };
 
   struct JobPayload {
     int width;
     int height;
     float tile_size;
-    std::vector<std::uint8_t> cells;
+    std::size_t slot_count;
+    std::shared_ptr<const std::vector<float>> occluders;
+    StampState state;
     std::vector<VisionSource> sources;
     std::uint64_t generation;
+    std::uint64_t epoch;
   };
 
   struct JobResult {
-    std::vector<std::uint8_t> cells;
+    StampState state;
+    std::vector<CellMask> changes;
     std::uint64_t generation;
-    bool changed;
+    std::uint64_t epoch;
   };
 
-  auto gatherVisionSources(Engine::Core::World &world,
-                           int player_id) const -> std::vector<VisionSource>;
-  auto composeJobPayload(const std::vector<VisionSource> &sources) const
-      -> JobPayload;
+  auto gatherVisionSources(Engine::Core::World &world) const
+      -> std::vector<VisionSource>;
+  auto composeJobPayload(std::vector<VisionSource> &&sources,
+                         std::size_t slot_count) -> JobPayload;
   void startAsyncJob(JobPayload &&payload);
   auto integrateCompletedJob() -> bool;
+  auto applyJobResult(JobResult &&result) -> bool;
+  void resetStampState();
+  auto currentOccluders() -> std::shared_ptr<const std::vector<float>>;
+  static auto buildSightTable(const VisionSource &source,
+                              float tile_size) -> SightTable;
   static auto executeJob(JobPayload payload) -> JobResult;
 
   VisibilityService() = default;
@@ -89,8 +176,20 @@ private:
 
   mutable std::shared_mutex m_cellsMutex;
   std::vector<std::uint8_t> m_cells;
+  std::vector<std::uint64_t> m_visibleMasks;
+  std::vector<std::uint64_t> m_exploredMasks;
+  std::vector<std::uint8_t> m_dirtyTiles;
+  int m_dirtyTilesX = 0;
+  int m_dirtyTilesZ = 0;
+  std::uint64_t m_localMask = 0;
+  std::array<std::atomic<std::uint64_t>, kMaxOwnerSlots> m_ownerVersions{};
   std::atomic<std::uint64_t> m_version{0};
   mutable std::atomic<std::uint64_t> m_generation{0};
+  StampState m_stamps;
+  std::uint64_t m_epoch = 0;
+  bool m_terrainOcclusion = false;
+  bool m_terrainDirty = true;
+  std::shared_ptr<const std::vector<float>> m_occluders;
   std::future<JobResult> m_pendingJob;
   std::atomic<bool> m_jobActive{false};
 };
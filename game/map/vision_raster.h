@@ -0,0 +1,90 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define VISIBILITY_USE_SSE2 1
+#endif
+
+namespace Game::Map {
+
+// Visits each row of a source's circle as one run of cells. The square root
+// only estimates the row's half-width; the per-cell distance test settles
+// the edge cells, so the runs cover exactly the cells that test accepts.
+template <typename VisitSpan>
+void forEachSpanInRange(int center_x, int center_z, int cell_radius,
+                        float range_sq, int width, int height, float tile_size,
+                        VisitSpan &&visit) {
+  const int min_z = std::max(center_z - cell_radius, 0);
+  const int max_z = std::min(center_z + cell_radius, height - 1);
+  for (int grid_z = min_z; grid_z <= max_z; ++grid_z) {
+    const float world_dz = static_cast<float>(grid_z - center_z) * tile_size;
+    const float dz_sq = world_dz * world_dz;
+    if (dz_sq > range_sq) {
+      continue;
+    }
+    auto inside = [&](int dx) {
+      const float world_dx = static_cast<float>(dx) * tile_size;
+      return world_dx * world_dx + dz_sq <= range_sq;
+    };
+    int reach = std::min(
+        cell_radius, static_cast<int>(std::sqrt(range_sq - dz_sq) / tile_size));
+    while (reach < cell_radius && inside(reach + 1)) {
+      ++reach;
+    }
+    while (reach >= 0 && !inside(reach)) {
+      --reach;
+    }
+    const int first_x = std::max(center_x - reach, 0);
+    const int last_x = std::min(center_x + reach, width - 1);
+    if (reach >= 0 && first_x <= last_x) {
+      visit(grid_z * width + first_x, last_x - first_x + 1);
+    }
+  }
+}
+
+// Adds `delta` to a run of observer counts one cell at a time and reports
+// the cells whose count left or reached zero.
+inline void addToSpanScalar(std::uint16_t *counts, int first_idx, int length,
+                            int delta, std::vector<int> &crossings) {
+  for (int offset = 0; offset < length; ++offset) {
+    const std::uint16_t before = counts[offset];
+    counts[offset] = static_cast<std::uint16_t>(before + delta);
+    if (before == 0 || counts[offset] == 0) {
+      crossings.push_back(first_idx + offset);
+    }
+  }
+}
+
+// Same as addToSpanScalar, eight counts at a time where SSE2 is available.
+inline void addToSpan(std::uint16_t *counts, int first_idx, int length,
+                      int delta, std::vector<int> &crossings) {
+  int offset = 0;
+#ifdef VISIBILITY_USE_SSE2
+  const __m128i step = _mm_set1_epi16(static_cast<short>(delta));
+  const __m128i zero = _mm_setzero_si128();
+  for (; offset + 8 <= length; offset += 8) {
+    auto *lanes = reinterpret_cast<__m128i *>(counts + offset);
+    const __m128i before = _mm_loadu_si128(lanes);
+    const __m128i after = _mm_add_epi16(before, step);
+    _mm_storeu_si128(lanes, after);
+    // Each 16-bit lane sets two mask bits; only the low one is kept.
+    auto crossed = static_cast<unsigned>(_mm_movemask_epi8(_mm_or_si128(
+                       _mm_cmpeq_epi16(before, zero),
+                       _mm_cmpeq_epi16(after, zero)))) &
+                   0x5555U;
+    for (; crossed != 0; crossed &= crossed - 1) {
+      crossings.push_back(first_idx + offset + std::countr_zero(crossed) / 2);
+    }
+  }
+#endif
+  addToSpanScalar(counts + offset, first_idx + offset, length - offset, delta,
+                  crossings);
+}
+
+} // namespace Game::Map
@@ -85,6 +85,18 @@ auto TacticalUtils::selectFocusFireTarget(
     return best_target;
   }
 
+  SpatialHashGrid enemy_grid;
+  enemy_grid.reserve(enemies.size());
+  for (const auto *enemy : enemies) {
+    SpatialEntry entry;
+    entry.id = enemy->id;
+    entry.x = enemy->posX;
+    entry.z = enemy->posZ;
+    entry.is_building = enemy->isBuilding;
+    enemy_grid.insert(entry);
+  }
+  enemy_grid.build();
+
   for (const auto *enemy : enemies) {
     float score = 0.0F;
 
@@ -117,7 +129,7 @@ auto TacticalUtils::selectFocusFireTarget(
       score += 10.0F;
     }
 
-    bool const isolated = isTargetIsolated(*enemy, enemies, 8.0F);
+    bool const isolated = isTargetIsolated(*enemy, enemy_grid, 8.0F);
     if (isolated) {
       score += 6.0F;
     }
@@ -181,28 +193,18 @@ auto TacticalUtils::calculateForceStrength(
   return strength;
 }
 
-auto TacticalUtils::isTargetIsolated(
-    const ContactSnapshot &target,
-    const std::vector<const ContactSnapshot *> &allEnemies,
-    float isolationRadius) -> bool {
+auto TacticalUtils::isTargetIsolated(const ContactSnapshot &target,
+                                     const SpatialHashGrid &enemyGrid,
+                                     float isolationRadius) -> bool {
 
-  const float isolation_radius_sq = isolationRadius * isolationRadius;
   int nearby_allies = 0;
 
-  for (const auto *enemy : allEnemies) {
-
-    if (enemy->id == target.id) {
-      continue;
-    }
-
-    float const dist_sq =
-        distance_squared(target.posX, target.posY, target.posZ, enemy->posX,
-                         enemy->posY, enemy->posZ);
-
-    if (dist_sq <= isolation_radius_sq) {
-      ++nearby_allies;
-    }
-  }
+  enemyGrid.forEachInRadius(target.posX, target.posZ, isolationRadius,
+                            [&](const SpatialEntry &entry) {
+                              if (entry.id != target.id) {
+                                ++nearby_allies;
+                              }
+                            });
 
   return (nearby_allies <= 1);
 }
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "../spatial_index.h"
 #include "ai_types.h"
 #include <vector>
 
@@ -42,10 +43,9 @@ public:
   static auto calculateForceStrength(
       const std::vector<const ContactSnapshot *> &units) -> float;
 
-  static auto
-  isTargetIsolated(const ContactSnapshot &target,
-                   const std::vector<const ContactSnapshot *> &allEnemies,
-                   float isolationRadius = 8.0F) -> bool;
+  static auto isTargetIsolated(const ContactSnapshot &target,
+                               const SpatialHashGrid &enemyGrid,
+                               float isolationRadius = 8.0F) -> bool;
 
   static auto
   getUnitTypePriority(const std::string &unit_type,
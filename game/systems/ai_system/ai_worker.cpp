@@ -1,4 +1,5 @@
 #include "ai_worker.h"
+#include "../../core/profiler.h"
 #include "systems/ai_system/ai_behavior_registry.h"
 #include "systems/ai_system/ai_executor.h"
 #include "systems/ai_system/ai_reasoner.h"
@@ -58,6 +59,7 @@ void AIWorker::drainResults(std::queue<AIResult> &out) {
 void AIWorker::stop() { m_shouldStop.store(true, std::memory_order_release); }
 
 void AIWorker::workerLoop() {
+  Engine::Core::Profiler::instance().setThreadName("AI worker");
   while (true) {
     AIJob job;
 
@@ -76,6 +78,7 @@ void AIWorker::workerLoop() {
     }
 
     try {
+      Engine::Core::ProfileZone const zone("AIWorker::job");
       AIResult result;
       result.context = job.context;
 
@@ -22,6 +22,9 @@ class ArrowSystem : public Engine::Core::System {
 public:
   ArrowSystem();
   void update(Engine::Core::World *world, float deltaTime) override;
+  [[nodiscard]] auto access() const -> Engine::Core::SystemAccess override {
+    return Engine::Core::SystemAccess{}.write<ArrowSystem>();
+  }
   void spawnArrow(const QVector3D &start, const QVector3D &end,
                   const QVector3D &color, float speed = 8.0F);
   [[nodiscard]] auto arrows() const -> const std::vector<ArrowInstance> & {
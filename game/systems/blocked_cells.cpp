@@ -0,0 +1,79 @@
+#include "blocked_cells.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace Game::Systems {
+
+BlockedCells::BlockedCells(int width, int height)
+    : m_width(width), m_height(height),
+      m_chunksX((width + kChunkSize - 1) >> kChunkShift),
+      m_chunksY((height + kChunkSize - 1) >> kChunkShift),
+      m_chunks(static_cast<std::size_t>(m_chunksX) *
+                   static_cast<std::size_t>(m_chunksY),
+               emptyChunk()) {}
+
+BlockedCells::BlockedCells(const ObstacleGrid &source)
+    : BlockedCells(source.width(), source.height()) {
+  for (int chunk_y = 0; chunk_y < m_chunksY; ++chunk_y) {
+    for (int chunk_x = 0; chunk_x < m_chunksX; ++chunk_x) {
+      loadChunk(source, chunk_x, chunk_y);
+    }
+  }
+}
+
+BlockedCells::BlockedCells(const BlockedCells &previous,
+                           const ObstacleGrid &source,
+                           const std::vector<ClusterBounds> &regions)
+    : BlockedCells(previous) {
+  std::vector<std::uint8_t> loaded(m_chunks.size(), 0);
+  for (const auto &region : regions) {
+    if (region.empty()) {
+      continue;
+    }
+    int const first_x = std::max(region.min_x, 0) >> kChunkShift;
+    int const first_y = std::max(region.min_y, 0) >> kChunkShift;
+    int const last_x = std::min(region.max_x, m_width - 1) >> kChunkShift;
+    int const last_y = std::min(region.max_y, m_height - 1) >> kChunkShift;
+    for (int chunk_y = first_y; chunk_y <= last_y; ++chunk_y) {
+      for (int chunk_x = first_x; chunk_x <= last_x; ++chunk_x) {
+        auto &done = loaded[static_cast<std::size_t>(chunk_y * m_chunksX +
+                                                     chunk_x)];
+        if (done == 0) {
+          done = 1;
+          loadChunk(source, chunk_x, chunk_y);
+        }
+      }
+    }
+  }
+}
+
+auto BlockedCells::emptyChunk() -> const std::shared_ptr<const Chunk> & {
+  static const std::shared_ptr<const Chunk> empty =
+      std::make_shared<const Chunk>();
+  return empty;
+}
+
+void BlockedCells::loadChunk(const ObstacleGrid &source, int chunk_x,
+                             int chunk_y) {
+  auto chunk = std::make_shared<Chunk>();
+  std::uint64_t any = 0;
+  int const first_y = chunk_y << kChunkShift;
+  int const last_y = std::min(first_y + kChunkSize, m_height);
+  for (int y = first_y; y < last_y; ++y) {
+    std::uint64_t const row = source.combinedWord(chunk_x, y);
+    chunk->rows[static_cast<std::size_t>(y - first_y)] = row;
+    any |= row;
+  }
+  auto &slot =
+      m_chunks[static_cast<std::size_t>(chunk_y * m_chunksX + chunk_x)];
+  if (any == 0) {
+    slot = emptyChunk();
+  } else {
+    slot = std::move(chunk);
+  }
+}
+
+} // namespace Game::Systems
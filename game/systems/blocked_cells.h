@@ -0,0 +1,62 @@
+#pragma once
+
+#include "obstacle_grid.h"
+#include "path_clusters.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace Game::Systems {
+
+// Read-only, bit-packed copy of the obstacle grid that searches run on. The
+// cells are cut into square chunks held by shared pointer, so a snapshot
+// derived from the previous one shares every chunk the dirty regions miss
+// and only re-reads the chunks they touch from the obstacle grid.
+class BlockedCells {
+public:
+  static constexpr int kChunkShift = 6;
+  static constexpr int kChunkSize = 1 << kChunkShift;
+  static_assert(kChunkSize == ObstacleGrid::kWordBits,
+                "a chunk row is one obstacle grid word");
+
+  // Every cell open.
+  BlockedCells(int width, int height);
+  // Every chunk read from `source`.
+  explicit BlockedCells(const ObstacleGrid &source);
+  // `previous` with the chunks overlapping `regions` read again from
+  // `source`.
+  BlockedCells(const BlockedCells &previous, const ObstacleGrid &source,
+               const std::vector<ClusterBounds> &regions);
+
+  [[nodiscard]] auto width() const -> int { return m_width; }
+  [[nodiscard]] auto height() const -> int { return m_height; }
+
+  [[nodiscard]] auto walkable(int x, int y) const -> bool {
+    if (x < 0 || x >= m_width || y < 0 || y >= m_height) {
+      return false;
+    }
+    const Chunk &chunk = *m_chunks[static_cast<std::size_t>(
+        (y >> kChunkShift) * m_chunksX + (x >> kChunkShift))];
+    return ((chunk.rows[static_cast<std::size_t>(y & (kChunkSize - 1))] >>
+             (x & (kChunkSize - 1))) &
+            1U) == 0;
+  }
+
+private:
+  struct Chunk {
+    std::array<std::uint64_t, kChunkSize> rows{};
+  };
+
+  static auto emptyChunk() -> const std::shared_ptr<const Chunk> &;
+  void loadChunk(const ObstacleGrid &source, int chunk_x, int chunk_y);
+
+  int m_width;
+  int m_height;
+  int m_chunksX;
+  int m_chunksY;
+  std::vector<std::shared_ptr<const Chunk>> m_chunks;
+};
+
+} // namespace Game::Systems
@@ -86,7 +86,7 @@ void CameraService::resetCamera(Render::GL::Camera &camera,
                                 Engine::Core::World &world, int localOwnerId,
                                 unsigned int playerUnitId) {
   Engine::Core::Entity *focus_entity = nullptr;
-  for (auto *e : world.getEntitiesWith<Engine::Core::UnitComponent>()) {
+  for (auto *e : world.query<Engine::Core::UnitComponent>()) {
     if (e == nullptr) {
       continue;
     }
@@ -6,6 +6,7 @@
 #include "../units/troop_config.h"
 #include "../visuals/team_colors.h"
 #include "building_collision_registry.h"
+#include "spatial_index.h"
 #include "units/spawn_type.h"
 #include "units/troop_type.h"
 #include <algorithm>
@@ -19,39 +20,27 @@ void CaptureSystem::update(Engine::Core::World *world, float deltaTime) {
   processBarrackCapture(world, deltaTime);
 }
 
-auto CaptureSystem::countNearbyTroops(Engine::Core::World *world,
+auto CaptureSystem::countNearbyTroops(Engine::Core::World * /*world*/,
                                       float barrack_x, float barrack_z,
                                       int owner_id, float radius) -> int {
   int total_troops = 0;
-  auto entities = world->getEntitiesWith<Engine::Core::UnitComponent>();
 
-  for (auto *e : entities) {
-    auto *unit = e->getComponent<Engine::Core::UnitComponent>();
-    auto *transform = e->getComponent<Engine::Core::TransformComponent>();
-
-    if ((unit == nullptr) || (transform == nullptr) || unit->health <= 0) {
-      continue;
-    }
-
-    if (unit->owner_id != owner_id) {
-      continue;
-    }
-
-    if (unit->spawn_type == Game::Units::SpawnType::Barracks) {
-      continue;
-    }
+  SpatialIndex::instance().units().forEachInRadius(
+      barrack_x, barrack_z, radius, [&](const SpatialEntry &entry) {
+        if (entry.owner_id != owner_id) {
+          return;
+        }
 
-    float const dx = transform->position.x - barrack_x;
-    float const dz = transform->position.z - barrack_z;
-    float const dist_sq = dx * dx + dz * dz;
+        auto *unit = entry.entity->getComponent<Engine::Core::UnitComponent>();
+        if ((unit == nullptr) || unit->health <= 0 ||
+            unit->spawn_type == Game::Units::SpawnType::Barracks) {
+          return;
+        }
 
-    if (dist_sq <= radius * radius) {
-      int const individuals_per_unit =
-          Game::Units::TroopConfig::instance().getIndividualsPerUnit(
-              unit->spawn_type);
-      total_troops += individuals_per_unit;
-    }
-  }
+        total_troops +=
+            Game::Units::TroopConfig::instance().getIndividualsPerUnit(
+                unit->spawn_type);
+      });
 
   return total_troops;
 }
@@ -69,7 +58,7 @@ void CaptureSystem::transferBarrackOwnership(Engine::Core::World *world,
   }
 
   int const previous_owner_id = unit->owner_id;
-  unit->owner_id = newOwnerId;
+  world->setUnitOwner(*barrack, newOwnerId);
 
   QVector3D const tc = Game::Visuals::team_colorForOwner(newOwnerId);
   renderable->color[0] = tc.x();
@@ -109,7 +98,7 @@ void CaptureSystem::processBarrackCapture(Engine::Core::World *world,
   constexpr float capture_radius = 8.0F;
   constexpr int troop_advantage_multiplier = 3;
 
-  auto barracks = world->getEntitiesWith<Engine::Core::BuildingComponent>();
+  auto barracks = world->query<Engine::Core::BuildingComponent>();
 
   for (auto *barrack : barracks) {
     auto *unit = barrack->getComponent<Engine::Core::UnitComponent>();
@@ -123,9 +112,14 @@ void CaptureSystem::processBarrackCapture(Engine::Core::World *world,
       continue;
     }
 
+    // Other systems may be reading this barrack from another thread, so a
+    // missing capture component and the ownership transfer are recorded
+    // rather than applied in place.
+    Engine::Core::CaptureComponent new_capture;
     auto *capture = barrack->getComponent<Engine::Core::CaptureComponent>();
-    if (capture == nullptr) {
-      capture = barrack->addComponent<Engine::Core::CaptureComponent>();
+    bool const has_capture = capture != nullptr;
+    if (!has_capture) {
+      capture = &new_capture;
     }
 
     float const barrack_x = transform->position.x;
@@ -135,7 +129,7 @@ void CaptureSystem::processBarrackCapture(Engine::Core::World *world,
     int max_enemy_troops = 0;
     int capturing_player_id = -1;
 
-    auto entities = world->getEntitiesWith<Engine::Core::UnitComponent>();
+    auto entities = world->query<Engine::Core::UnitComponent>();
     std::vector<int> player_ids;
     for (auto *e : entities) {
       auto *u = e->getComponent<Engine::Core::UnitComponent>();
@@ -176,7 +170,13 @@ void CaptureSystem::processBarrackCapture(Engine::Core::World *world,
       capture->captureProgress += deltaTime;
 
       if (capture->captureProgress >= capture->requiredTime) {
-        transferBarrackOwnership(world, barrack, capturing_player_id);
+        Engine::Core::EntityID const barrack_id = barrack->getId();
+        world->commands().defer(
+            [barrack_id, capturing_player_id](Engine::Core::World &target) {
+              if (auto *entity = target.getEntity(barrack_id)) {
+                transferBarrackOwnership(&target, entity, capturing_player_id);
+              }
+            });
         capture->captureProgress = 0.0F;
         capture->isBeingCaptured = false;
         capture->capturing_player_id = -1;
@@ -191,7 +191,19 @@ void CaptureSystem::processBarrackCapture(Engine::Core::World *world,
         }
       }
     }
+
+    if (!has_capture) {
+      world->commands().addComponent<Engine::Core::CaptureComponent>(
+          barrack->getId(), new_capture);
+    }
   }
 }
 
+auto CaptureSystem::access() const -> Engine::Core::SystemAccess {
+  return Engine::Core::SystemAccess{}
+      .read<Engine::Core::UnitComponent, Engine::Core::TransformComponent,
+            Engine::Core::BuildingComponent, SpatialIndex>()
+      .write<Engine::Core::CaptureComponent>();
+}
+
 } // namespace Game::Systems
@@ -12,6 +12,7 @@ namespace Game::Systems {
 class CaptureSystem : public Engine::Core::System {
 public:
   void update(Engine::Core::World *world, float deltaTime) override;
+  [[nodiscard]] auto access() const -> Engine::Core::SystemAccess override;
 
 private:
   static void processBarrackCapture(Engine::Core::World *world,
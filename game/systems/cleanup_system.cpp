@@ -2,7 +2,6 @@
 #include "../core/component.h"
 #include "../core/world.h"
 #include "core/entity.h"
-#include <vector>
 
 namespace Game::Systems {
 
@@ -10,19 +9,14 @@ void CleanupSystem::update(Engine::Core::World *world, float deltaTime) {
   removeDeadEntities(world);
 }
 
-void CleanupSystem::removeDeadEntities(Engine::Core::World *world) {
-  std::vector<Engine::Core::EntityID> entities_to_remove;
-
-  auto entities =
-      world->getEntitiesWith<Engine::Core::PendingRemovalComponent>();
-
-  entities_to_remove.reserve(entities.size());
-  for (auto *entity : entities) {
-    entities_to_remove.push_back(entity->getId());
-  }
+auto CleanupSystem::access() const -> Engine::Core::SystemAccess {
+  return Engine::Core::SystemAccess{}
+      .read<Engine::Core::PendingRemovalComponent>();
+}
 
-  for (auto entity_id : entities_to_remove) {
-    world->destroyEntity(entity_id);
+void CleanupSystem::removeDeadEntities(Engine::Core::World *world) {
+  for (auto *entity : world->query<Engine::Core::PendingRemovalComponent>()) {
+    world->commands().destroyEntity(entity->getId());
   }
 }
 
@@ -8,6 +8,7 @@ namespace Game::Systems {
 class CleanupSystem : public Engine::Core::System {
 public:
   void update(Engine::Core::World *world, float deltaTime) override;
+  [[nodiscard]] auto access() const -> Engine::Core::SystemAccess override;
 
 private:
   static void removeDeadEntities(Engine::Core::World *world);
@@ -8,6 +8,9 @@
 #include "building_collision_registry.h"
 #include "command_service.h"
 #include "owner_registry.h"
+#include "pathfinding.h"
+#include "spatial_index.h"
+#include "troop_count_registry.h"
 #include "units/spawn_type.h"
 #include <algorithm>
 #include <cmath>
@@ -21,20 +24,35 @@ namespace Game::Systems {
 
 void CombatSystem::update(Engine::Core::World *world, float deltaTime) {
   processAttacks(world, deltaTime);
+  world->flushCommands();
   processAutoEngagement(world, deltaTime);
 }
 
+// Combat flushes its command buffer mid-update and publishes unit deaths,
+// whose subscribers update the troop counts on this thread, so its writes
+// cover those as well as the components it changes in place.
+auto CombatSystem::access() const -> Engine::Core::SystemAccess {
+  return Engine::Core::SystemAccess{}
+      .read<Engine::Core::PatrolComponent, Engine::Core::BuildingComponent,
+            OwnerRegistry, SpatialIndex>()
+      .write<Engine::Core::UnitComponent, Engine::Core::TransformComponent,
+             Engine::Core::MovementComponent, Engine::Core::AttackComponent,
+             Engine::Core::AttackTargetComponent,
+             Engine::Core::HoldModeComponent,
+             Engine::Core::RenderableComponent,
+             Engine::Core::PendingRemovalComponent, ArrowSystem,
+             BuildingCollisionRegistry, Pathfinding, TroopCountRegistry,
+             Engine::Core::EventManager>();
+}
+
 void CombatSystem::processAttacks(Engine::Core::World *world, float deltaTime) {
-  auto units = world->getEntitiesWith<Engine::Core::UnitComponent>();
+  auto units = world->query<Engine::Core::UnitComponent>(
+      Engine::Core::Without<Engine::Core::PendingRemovalComponent>{});
 
   auto *arrow_sys = world->getSystem<ArrowSystem>();
 
   for (auto *attacker : units) {
 
-    if (attacker->hasComponent<Engine::Core::PendingRemovalComponent>()) {
-      continue;
-    }
-
     auto *attacker_unit = attacker->getComponent<Engine::Core::UnitComponent>();
     auto *attacker_transform =
         attacker->getComponent<Engine::Core::TransformComponent>();
@@ -49,10 +67,13 @@ void CombatSystem::processAttacks(Engine::Core::World *world, float deltaTime) {
       continue;
     }
 
+    Engine::Core::AttackTargetComponent pending_lock_target;
+    bool has_pending_lock_target = false;
+
     if ((attacker_atk != nullptr) && attacker_atk->inMeleeLock) {
-      auto *lock_target = world->getEntity(attacker_atk->meleeLockTargetId);
-      if ((lock_target == nullptr) ||
-          lock_target->hasComponent<Engine::Core::PendingRemovalComponent>()) {
+      auto *lock_target =
+          world->getLiveEntity(attacker_atk->meleeLockTargetId);
+      if (lock_target == nullptr) {
 
         attacker_atk->inMeleeLock = false;
         attacker_atk->meleeLockTargetId = 0;
@@ -94,17 +115,18 @@ void CombatSystem::processAttacks(Engine::Core::World *world, float deltaTime) {
 
     if ((attacker_atk != nullptr) && attacker_atk->inMeleeLock &&
         attacker_atk->meleeLockTargetId != 0) {
-      auto *lock_target = world->getEntity(attacker_atk->meleeLockTargetId);
-      if ((lock_target != nullptr) &&
-          !lock_target->hasComponent<Engine::Core::PendingRemovalComponent>()) {
+      auto *lock_target =
+          world->getLiveEntity(attacker_atk->meleeLockTargetId);
+      if (lock_target != nullptr) {
 
         auto *attack_target =
             attacker->getComponent<Engine::Core::AttackTargetComponent>();
         if (attack_target == nullptr) {
-          attack_target =
-              attacker->addComponent<Engine::Core::AttackTargetComponent>();
-        }
-        if (attack_target != nullptr) {
+          pending_lock_target.target_id = attacker_atk->meleeLockTargetId;
+          world->commands().addComponent<Engine::Core::AttackTargetComponent>(
+              attacker->getId(), pending_lock_target);
+          has_pending_lock_target = true;
+        } else {
           attack_target->target_id = attacker_atk->meleeLockTargetId;
           attack_target->shouldChase = false;
         }
@@ -152,13 +174,15 @@ void CombatSystem::processAttacks(Engine::Core::World *world, float deltaTime) {
 
     auto *attack_target =
         attacker->getComponent<Engine::Core::AttackTargetComponent>();
+    if ((attack_target == nullptr) && has_pending_lock_target) {
+      attack_target = &pending_lock_target;
+    }
     Engine::Core::Entity *best_target = nullptr;
 
     if ((attack_target != nullptr) && attack_target->target_id != 0) {
 
-      auto *target = world->getEntity(attack_target->target_id);
-      if ((target != nullptr) &&
-          !target->hasComponent<Engine::Core::PendingRemovalComponent>()) {
+      auto *target = world->getLiveEntity(attack_target->target_id);
+      if (target != nullptr) {
         auto *target_unit = target->getComponent<Engine::Core::UnitComponent>();
 
         auto &owner_registry = Game::Systems::OwnerRegistry::instance();
@@ -186,6 +210,7 @@ void CombatSystem::processAttacks(Engine::Core::World *world, float deltaTime) {
                 movement->vx = 0.0F;
                 movement->vz = 0.0F;
                 movement->path.clear();
+                movement->flowField.reset();
                 if (attacker_transform != nullptr) {
                   movement->target_x = attacker_transform->position.x;
                   movement->target_y = attacker_transform->position.z;
@@ -215,8 +240,9 @@ void CombatSystem::processAttacks(Engine::Core::World *world, float deltaTime) {
                 attacker->getComponent<Engine::Core::HoldModeComponent>();
             if ((hold_mode != nullptr) && hold_mode->active) {
               if (!isInRange(attacker, target, range)) {
-                attacker
-                    ->removeComponent<Engine::Core::AttackTargetComponent>();
+                world->commands()
+                    .removeComponent<Engine::Core::AttackTargetComponent>(
+                        attacker->getId());
               }
               continue;
             }
@@ -238,6 +264,7 @@ void CombatSystem::processAttacks(Engine::Core::World *world, float deltaTime) {
                 movement->vx = 0.0F;
                 movement->vz = 0.0F;
                 movement->path.clear();
+                movement->flowField.reset();
                 auto *attacker_transformComponent =
                     attacker->getComponent<Engine::Core::TransformComponent>();
                 if (attacker_transformComponent != nullptr) {
@@ -311,6 +338,7 @@ void CombatSystem::processAttacks(Engine::Core::World *world, float deltaTime) {
                     movement->vx = 0.0F;
                     movement->vz = 0.0F;
                     movement->path.clear();
+                    movement->flowField.reset();
                     if (attacker_transformComponent != nullptr) {
                       movement->target_x =
                           attacker_transformComponent->position.x;
@@ -356,50 +384,56 @@ void CombatSystem::processAttacks(Engine::Core::World *world, float deltaTime) {
             }
           } else {
 
-            attacker->removeComponent<Engine::Core::AttackTargetComponent>();
+            world->commands()
+                .removeComponent<Engine::Core::AttackTargetComponent>(
+                    attacker->getId());
           }
         } else {
 
-          attacker->removeComponent<Engine::Core::AttackTargetComponent>();
+          world->commands()
+              .removeComponent<Engine::Core::AttackTargetComponent>(
+                  attacker->getId());
         }
       } else {
 
-        attacker->removeComponent<Engine::Core::AttackTargetComponent>();
+        world->commands().removeComponent<Engine::Core::AttackTargetComponent>(
+            attacker->getId());
       }
     }
 
     if ((best_target == nullptr) && (attack_target == nullptr)) {
 
       auto &owner_registry = Game::Systems::OwnerRegistry::instance();
+      auto &spatial_index = SpatialIndex::instance();
+
+      spatial_index.units().forEachInRadius(
+          attacker_transform->position.x, attacker_transform->position.z,
+          range + spatial_index.maxUnitRadius(),
+          [&](const SpatialEntry &entry) {
+            if ((best_target != nullptr) || entry.entity == attacker ||
+                entry.is_building) {
+              return;
+            }
 
-      for (auto *target : units) {
-        if (target == attacker) {
-          continue;
-        }
-
-        auto *target_unit = target->getComponent<Engine::Core::UnitComponent>();
-        if ((target_unit == nullptr) || target_unit->health <= 0) {
-          continue;
-        }
-
-        if (target_unit->owner_id == attacker_unit->owner_id) {
-          continue;
-        }
+            auto *target_unit =
+                entry.entity->getComponent<Engine::Core::UnitComponent>();
+            if ((target_unit == nullptr) || target_unit->health <= 0) {
+              return;
+            }
 
-        if (owner_registry.areAllies(attacker_unit->owner_id,
-                                     target_unit->owner_id)) {
-          continue;
-        }
+            if (target_unit->owner_id == attacker_unit->owner_id) {
+              return;
+            }
 
-        if (target->hasComponent<Engine::Core::BuildingComponent>()) {
-          continue;
-        }
+            if (owner_registry.areAllies(attacker_unit->owner_id,
+                                         target_unit->owner_id)) {
+              return;
+            }
 
-        if (isInRange(attacker, target, range)) {
-          best_target = target;
-          break;
-        }
-      }
+            if (isInRange(attacker, entry.entity, range)) {
+              best_target = entry.entity;
+            }
+          });
     }
 
     if (best_target != nullptr) {
@@ -407,10 +441,10 @@ void CombatSystem::processAttacks(Engine::Core::World *world, float deltaTime) {
           best_target->getComponent<Engine::Core::UnitComponent>();
 
       if (!attacker->hasComponent<Engine::Core::AttackTargetComponent>()) {
-        auto *new_target =
-            attacker->addComponent<Engine::Core::AttackTargetComponent>();
-        new_target->target_id = best_target->getId();
-        new_target->shouldChase = false;
+        Engine::Core::AttackTargetComponent new_target;
+        new_target.target_id = best_target->getId();
+        world->commands().addComponent<Engine::Core::AttackTargetComponent>(
+            attacker->getId(), new_target);
       } else {
         auto *existing_target =
             attacker->getComponent<Engine::Core::AttackTargetComponent>();
@@ -435,6 +469,7 @@ void CombatSystem::processAttacks(Engine::Core::World *world, float deltaTime) {
           movement->vx = 0.0F;
           movement->vz = 0.0F;
           movement->path.clear();
+          movement->flowField.reset();
           if (attacker_transform != nullptr) {
             movement->target_x = attacker_transform->position.x;
             movement->target_y = attacker_transform->position.z;
@@ -562,7 +597,8 @@ void CombatSystem::processAttacks(Engine::Core::World *world, float deltaTime) {
 
       if ((attack_target == nullptr) &&
           attacker->hasComponent<Engine::Core::AttackTargetComponent>()) {
-        attacker->removeComponent<Engine::Core::AttackTargetComponent>();
+        world->commands().removeComponent<Engine::Core::AttackTargetComponent>(
+            attacker->getId());
       }
     }
   }
@@ -661,10 +697,9 @@ void CombatSystem::dealDamage(Engine::Core::World *world,
           target_atk->meleeLockTargetId != 0) {
 
         if (world != nullptr) {
-          auto *lock_partner = world->getEntity(target_atk->meleeLockTargetId);
-          if ((lock_partner != nullptr) &&
-              !lock_partner
-                   ->hasComponent<Engine::Core::PendingRemovalComponent>()) {
+          auto *lock_partner =
+              world->getLiveEntity(target_atk->meleeLockTargetId);
+          if (lock_partner != nullptr) {
             auto *partner_atk =
                 lock_partner->getComponent<Engine::Core::AttackComponent>();
             if ((partner_atk != nullptr) &&
@@ -691,6 +726,7 @@ void CombatSystem::dealDamage(Engine::Core::World *world,
         movement->vx = 0.0F;
         movement->vz = 0.0F;
         movement->path.clear();
+        movement->flowField.reset();
         movement->pathPending = false;
       }
 
@@ -724,7 +760,7 @@ void CombatSystem::updateCombatMode(
   }
 
   auto &owner_registry = Game::Systems::OwnerRegistry::instance();
-  auto units = world->getEntitiesWith<Engine::Core::UnitComponent>();
+  auto units = world->query<Engine::Core::UnitComponent>();
 
   float closest_enemy_dist_sq = std::numeric_limits<float>::max();
   float closest_height_diff = 0.0F;
@@ -796,7 +832,9 @@ void CombatSystem::updateCombatMode(
 
 void CombatSystem::processAutoEngagement(Engine::Core::World *world,
                                          float deltaTime) {
-  auto units = world->getEntitiesWith<Engine::Core::UnitComponent>();
+  auto units = world->query<Engine::Core::UnitComponent>(
+      Engine::Core::Without<Engine::Core::PendingRemovalComponent,
+                            Engine::Core::BuildingComponent>{});
 
   for (auto it = m_engagementCooldowns.begin();
        it != m_engagementCooldowns.end();) {
@@ -810,19 +848,11 @@ void CombatSystem::processAutoEngagement(Engine::Core::World *world,
 
   for (auto *unit : units) {
 
-    if (unit->hasComponent<Engine::Core::PendingRemovalComponent>()) {
-      continue;
-    }
-
     auto *unit_comp = unit->getComponent<Engine::Core::UnitComponent>();
     if ((unit_comp == nullptr) || unit_comp->health <= 0) {
       continue;
     }
 
-    if (unit->hasComponent<Engine::Core::BuildingComponent>()) {
-      continue;
-    }
-
     auto *attack_comp = unit->getComponent<Engine::Core::AttackComponent>();
     if ((attack_comp == nullptr) || !attack_comp->canMelee) {
       continue;
@@ -851,15 +881,16 @@ void CombatSystem::processAutoEngagement(Engine::Core::World *world,
       auto *attack_target =
           unit->getComponent<Engine::Core::AttackTargetComponent>();
       if (attack_target == nullptr) {
-        attack_target =
-            unit->addComponent<Engine::Core::AttackTargetComponent>();
-      }
-      if (attack_target != nullptr) {
+        Engine::Core::AttackTargetComponent new_target;
+        new_target.target_id = nearest_enemy->getId();
+        new_target.shouldChase = true;
+        world->commands().addComponent<Engine::Core::AttackTargetComponent>(
+            unit->getId(), new_target);
+      } else {
         attack_target->target_id = nearest_enemy->getId();
         attack_target->shouldChase = true;
-
-        m_engagementCooldowns[unit->getId()] = ENGAGEMENT_COOLDOWN;
       }
+      m_engagementCooldowns[unit->getId()] = ENGAGEMENT_COOLDOWN;
     }
   }
 }
@@ -900,54 +931,9 @@ auto CombatSystem::findNearestEnemy(Engine::Core::Entity *unit,
     return nullptr;
   }
 
-  auto &owner_registry = Game::Systems::OwnerRegistry::instance();
-  auto units = world->getEntitiesWith<Engine::Core::UnitComponent>();
-
-  Engine::Core::Entity *nearest_enemy = nullptr;
-  float nearest_dist_sq = maxRange * maxRange;
-
-  for (auto *target : units) {
-    if (target == unit) {
-      continue;
-    }
-
-    if (target->hasComponent<Engine::Core::PendingRemovalComponent>()) {
-      continue;
-    }
-
-    auto *target_unit = target->getComponent<Engine::Core::UnitComponent>();
-    if ((target_unit == nullptr) || target_unit->health <= 0) {
-      continue;
-    }
-
-    if (target_unit->owner_id == unit_comp->owner_id) {
-      continue;
-    }
-    if (owner_registry.areAllies(unit_comp->owner_id, target_unit->owner_id)) {
-      continue;
-    }
-
-    if (target->hasComponent<Engine::Core::BuildingComponent>()) {
-      continue;
-    }
-
-    auto *target_transform =
-        target->getComponent<Engine::Core::TransformComponent>();
-    if (target_transform == nullptr) {
-      continue;
-    }
-
-    float const dx = target_transform->position.x - unit_transform->position.x;
-    float const dz = target_transform->position.z - unit_transform->position.z;
-    float const dist_sq = dx * dx + dz * dz;
-
-    if (dist_sq < nearest_dist_sq) {
-      nearest_dist_sq = dist_sq;
-      nearest_enemy = target;
-    }
-  }
-
-  return nearest_enemy;
+  return SpatialIndex::instance().findNearestEnemy(
+      unit_comp->owner_id, unit_transform->position.x,
+      unit_transform->position.z, maxRange, unit->getId());
 }
 
 } // namespace Game::Systems
\ No newline at end of file
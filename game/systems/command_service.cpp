@@ -1,5 +1,6 @@
 #include "command_service.h"
 #include "../core/component.h"
+#include "../core/profiler.h"
 #include "../core/world.h"
 #include "pathfinding.h"
 #include "units/spawn_type.h"
@@ -48,6 +49,7 @@ void CommandService::initialize(int worldWidth, int worldHeight) {
   float const offset_x = -(worldWidth * 0.5F - 0.5F);
   float const offset_z = -(worldHeight * 0.5F - 0.5F);
   s_pathfinder->setGridOffset(offset_x, offset_z);
+  s_pathfinder->setGoalRedirectRadius(GOAL_REDIRECT_RADIUS);
 }
 
 auto CommandService::getPathfinder() -> Pathfinding * {
@@ -233,6 +235,7 @@ void CommandService::moveUnits(Engine::Core::World &world,
         mv->target_y = target_z;
         mv->hasTarget = true;
         mv->path.clear();
+        mv->flowField.reset();
         mv->pathPending = false;
         mv->pendingRequestId = 0;
         mv->vx = 0.0F;
@@ -254,6 +257,7 @@ void CommandService::moveUnits(Engine::Core::World &world,
         mv->target_y = target_z;
         mv->hasTarget = true;
         mv->path.clear();
+        mv->flowField.reset();
         mv->pathPending = false;
         mv->pendingRequestId = 0;
         mv->vx = 0.0F;
@@ -292,6 +296,8 @@ void CommandService::moveUnits(Engine::Core::World &world,
         }
 
         mv->path.clear();
+
+        mv->flowField.reset();
         mv->hasTarget = false;
         mv->vx = 0.0F;
         mv->vz = 0.0F;
@@ -308,7 +314,8 @@ void CommandService::moveUnits(Engine::Core::World &world,
           s_entityToRequest[units[i]] = request_id;
         }
 
-        s_pathfinder->submitPathRequest(request_id, start, end);
+        s_pathfinder->submitPathRequest(request_id, start, end,
+                                        options.priority);
 
         mv->timeSinceLastPathRequest = 0.0F;
         mv->lastGoalX = target_x;
@@ -320,6 +327,7 @@ void CommandService::moveUnits(Engine::Core::World &world,
       mv->target_y = target_z;
       mv->hasTarget = true;
       mv->path.clear();
+      mv->flowField.reset();
       mv->pathPending = false;
       mv->pendingRequestId = 0;
       mv->vx = 0.0F;
@@ -609,6 +617,7 @@ void CommandService::moveGroup(Engine::Core::World &world,
     mv->vx = 0.0F;
     mv->vz = 0.0F;
     mv->path.clear();
+    mv->flowField.reset();
     mv->pathPending = false;
     mv->pendingRequestId = 0;
     units_needing_new_path.push_back(&member);
@@ -660,6 +669,19 @@ void CommandService::moveGroup(Engine::Core::World &world,
     return;
   }
 
+  // The whole group shares one flow field towards the leader's goal, so
+  // repeated orders to the same rally point reuse the cached field.
+  if (auto field = s_pathfinder->findFlowField(end)) {
+    for (auto *member : units_needing_new_path) {
+      assignFlowField(*member->movement, field, member->target);
+
+      member->movement->timeSinceLastPathRequest = 0.0F;
+      member->movement->lastGoalX = member->target.x();
+      member->movement->lastGoalY = member->target.z();
+    }
+    return;
+  }
+
   std::uint64_t const request_id =
       s_nextRequestId.fetch_add(1, std::memory_order_relaxed);
 
@@ -691,10 +713,27 @@ void CommandService::moveGroup(Engine::Core::World &world,
     }
   }
 
-  s_pathfinder->submitPathRequest(request_id, start, end);
+  s_pathfinder->submitFlowFieldRequest(request_id, end, options.priority);
+}
+
+void CommandService::assignFlowField(Engine::Core::MovementComponent &movement,
+                                     std::shared_ptr<const FlowField> field,
+                                     const QVector3D &target) {
+  movement.path.clear();
+  movement.flowField = std::move(field);
+  movement.goalX = target.x();
+  movement.goalY = target.z();
+  movement.target_x = target.x();
+  movement.target_y = target.z();
+  movement.hasTarget = true;
+  movement.pathPending = false;
+  movement.pendingRequestId = 0;
+  movement.vx = 0.0F;
+  movement.vz = 0.0F;
 }
 
 void CommandService::processPathResults(Engine::Core::World &world) {
+  Engine::Core::ProfileZone const zone("CommandService::processPathResults");
   if (!s_pathfinder) {
     return;
   }
@@ -713,7 +752,11 @@ void CommandService::processPathResults(Engine::Core::World &world) {
       auto pending_it = s_pendingRequests.find(result.request_id);
       if (pending_it != s_pendingRequests.end()) {
         request_info = pending_it->second;
-        s_pendingRequests.erase(pending_it);
+        if (result.partial) {
+          pending_it->second.partialPath = result.path;
+        } else {
+          s_pendingRequests.erase(pending_it);
+        }
 
         found = true;
       }
@@ -728,6 +771,18 @@ void CommandService::processPathResults(Engine::Core::World &world) {
     const float skip_threshold_sq = CommandService::WAYPOINT_SKIP_THRESHOLD_SQ;
     const bool has_path = path_points.size() > 1;
 
+    // Units already walking the partial path pick the complete one up from
+    // the nearest waypoint both paths share.
+    std::size_t shared_waypoints = 0;
+    if (!result.partial) {
+      const auto &partial = request_info.partialPath;
+      while (shared_waypoints < partial.size() &&
+             shared_waypoints < path_points.size() &&
+             partial[shared_waypoints] == path_points[shared_waypoints]) {
+        ++shared_waypoints;
+      }
+    }
+
     auto apply_to_member = [&](Engine::Core::EntityID member_id,
                                const QVector3D &target,
                                const QVector3D &offset) {
@@ -750,14 +805,27 @@ void CommandService::processPathResults(Engine::Core::World &world) {
 
       if (!movement_component->pathPending ||
           movement_component->pendingRequestId != result.request_id) {
-        movement_component->pathPending = false;
-        movement_component->pendingRequestId = 0;
+        if (!result.partial) {
+          movement_component->pathPending = false;
+          movement_component->pendingRequestId = 0;
+        }
+        return;
+      }
+
+      if (result.flow_field) {
+        assignFlowField(*movement_component, result.flow_field, target);
         return;
       }
 
-      movement_component->pathPending = false;
-      movement_component->pendingRequestId = 0;
+      if (result.partial && !has_path) {
+        return;
+      }
+
+      movement_component->pathPending = result.partial;
+      movement_component->pendingRequestId =
+          result.partial ? result.request_id : 0;
       movement_component->path.clear();
+      movement_component->flowField.reset();
       movement_component->goalX = target.x();
       movement_component->goalY = target.z();
       movement_component->vx = 0.0F;
@@ -771,6 +839,21 @@ void CommandService::processPathResults(Engine::Core::World &world) {
                                                 world_pos.z() + offset.z());
         }
 
+        if (shared_waypoints > 2) {
+          auto &path = movement_component->path;
+          auto const shared_end =
+              path.begin() + static_cast<std::ptrdiff_t>(shared_waypoints - 1);
+          auto const nearest = std::min_element(
+              path.begin(), shared_end, [&](const auto &a, const auto &b) {
+                float const adx = a.first - member_transform->position.x;
+                float const adz = a.second - member_transform->position.z;
+                float const bdx = b.first - member_transform->position.x;
+                float const bdz = b.second - member_transform->position.z;
+                return adx * adx + adz * adz < bdx * bdx + bdz * bdz;
+              });
+          path.erase(path.begin(), nearest);
+        }
+
         while (!movement_component->path.empty()) {
           float const dx = movement_component->path.front().first -
                            member_transform->position.x;
@@ -809,7 +892,7 @@ void CommandService::processPathResults(Engine::Core::World &world) {
       }
     };
 
-    {
+    if (!result.partial) {
       std::lock_guard<std::mutex> const lock(s_pendingMutex);
       remove_entry(request_info.entity_id);
       for (auto member_id : request_info.groupMembers) {
@@ -952,6 +1035,7 @@ void CommandService::attack_target(
       mv->goalY = desired_pos.z();
       mv->hasTarget = true;
       mv->path.clear();
+      mv->flowField.reset();
     }
   }
 }
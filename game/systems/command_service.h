@@ -1,5 +1,6 @@
 #pragma once
 
+#include "pathfinding.h"
 #include <QVector3D>
 #include <atomic>
 #include <cstdint>
@@ -16,21 +17,21 @@ struct MovementComponent;
 
 namespace Game::Systems {
 
-class Pathfinding;
-struct Point;
-
 class CommandService {
 public:
   struct MoveOptions {
     bool allowDirectFallback = true;
     bool clearAttackIntent = true;
     bool groupMove = false;
+    PathPriority priority = PathPriority::Background;
   };
 
   static constexpr int DIRECT_PATH_THRESHOLD = 8;
 
   static constexpr float WAYPOINT_SKIP_THRESHOLD_SQ = 0.16F;
 
+  static constexpr int GOAL_REDIRECT_RADIUS = 6;
+
   static void initialize(int worldWidth, int worldHeight);
 
   static auto getPathfinder() -> Pathfinding *;
@@ -58,6 +59,7 @@ private:
     MoveOptions options;
     std::vector<Engine::Core::EntityID> groupMembers;
     std::vector<QVector3D> groupTargets;
+    std::vector<Point> partialPath;
   };
 
   static std::unique_ptr<Pathfinding> s_pathfinder;
@@ -70,6 +72,9 @@ private:
   static auto worldToGrid(float world_x, float world_z) -> Point;
   static auto gridToWorld(const Point &gridPos) -> QVector3D;
   static void clearPendingRequest(Engine::Core::EntityID entity_id);
+  static void assignFlowField(Engine::Core::MovementComponent &movement,
+                              std::shared_ptr<const FlowField> field,
+                              const QVector3D &target);
   static void moveGroup(Engine::Core::World &world,
                         const std::vector<Engine::Core::EntityID> &units,
                         const std::vector<QVector3D> &targets,
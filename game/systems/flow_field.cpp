@@ -0,0 +1,142 @@
+#include "flow_field.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace Game::Systems {
+
+namespace {
+
+constexpr std::array<Point, 8> k_neighbor_offsets{
+    Point{1, 0},  Point{-1, 0}, Point{0, 1},  Point{0, -1},
+    Point{1, 1},  Point{1, -1}, Point{-1, 1}, Point{-1, -1}};
+
+} // namespace
+
+FlowField::FlowField(const Point &goal, int width, int height,
+                     std::uint64_t obstacle_version)
+    : m_goal(goal), m_width(width), m_height(height),
+      m_obstacleVersion(obstacle_version) {}
+
+void FlowField::build(const BlockedCells &blocked) {
+  std::size_t const total =
+      static_cast<std::size_t>(m_width) * static_cast<std::size_t>(m_height);
+  m_integration.assign(total, kUnreachable);
+  m_directions.assign(total, kNoDirection);
+
+  auto walkable = [&](int x, int y) { return blocked.walkable(x, y); };
+  // Moves are symmetric, so stepping from `from` by `offset` is legal in
+  // both directions under the same no-corner-cutting rule.
+  auto can_step = [&](const Point &from, const Point &offset) {
+    if (!walkable(from.x + offset.x, from.y + offset.y)) {
+      return false;
+    }
+    if (offset.x != 0 && offset.y != 0) {
+      return walkable(from.x + offset.x, from.y) &&
+             walkable(from.x, from.y + offset.y);
+    }
+    return true;
+  };
+
+  if (!walkable(m_goal.x, m_goal.y)) {
+    return;
+  }
+
+  // Uniform step costs make the integration pass a breadth-first flood.
+  std::vector<Point> frontier;
+  frontier.reserve(total);
+  frontier.push_back(m_goal);
+  m_integration[toIndex(m_goal)] = 0;
+  for (std::size_t head = 0; head < frontier.size(); ++head) {
+    Point const cell = frontier[head];
+    std::uint32_t const next_cost = m_integration[toIndex(cell)] + 1;
+    for (const Point &offset : k_neighbor_offsets) {
+      if (!can_step(cell, offset)) {
+        continue;
+      }
+      Point const neighbor{cell.x + offset.x, cell.y + offset.y};
+      auto &cost = m_integration[toIndex(neighbor)];
+      if (cost == kUnreachable) {
+        cost = next_cost;
+        frontier.push_back(neighbor);
+      }
+    }
+  }
+
+  for (const Point &cell : frontier) {
+    std::uint32_t best = m_integration[toIndex(cell)];
+    for (std::size_t i = 0; i < k_neighbor_offsets.size(); ++i) {
+      const Point &offset = k_neighbor_offsets[i];
+      if (!can_step(cell, offset)) {
+        continue;
+      }
+      std::uint32_t const cost =
+          m_integration[toIndex({cell.x + offset.x, cell.y + offset.y})];
+      if (cost < best) {
+        best = cost;
+        m_directions[toIndex(cell)] = static_cast<std::uint8_t>(i);
+      }
+    }
+  }
+}
+
+auto FlowField::cost(const Point &cell) const -> std::uint32_t {
+  if (!inBounds(cell) || m_integration.empty()) {
+    return kUnreachable;
+  }
+  return m_integration[toIndex(cell)];
+}
+
+auto FlowField::hasDirection(const Point &cell) const -> bool {
+  return inBounds(cell) && !m_directions.empty() &&
+         m_directions[toIndex(cell)] != kNoDirection;
+}
+
+auto FlowField::next(const Point &cell) const -> Point {
+  if (!hasDirection(cell)) {
+    return cell;
+  }
+  const Point &offset = k_neighbor_offsets[m_directions[toIndex(cell)]];
+  return {cell.x + offset.x, cell.y + offset.y};
+}
+
+auto FlowFieldCache::find(int goal_cell, std::uint64_t obstacle_version)
+    -> std::shared_ptr<const FlowField> {
+  std::lock_guard<std::mutex> const lock(m_mutex);
+  auto it = m_lookup.find(makeKey(goal_cell, obstacle_version));
+  if (it == m_lookup.end()) {
+    return nullptr;
+  }
+  m_entries.splice(m_entries.begin(), m_entries, it->second);
+  return it->second->field;
+}
+
+void FlowFieldCache::insert(int goal_cell,
+                            std::shared_ptr<const FlowField> field) {
+  std::uint64_t const key = makeKey(goal_cell, field->obstacleVersion());
+  std::lock_guard<std::mutex> const lock(m_mutex);
+  auto it = m_lookup.find(key);
+  if (it != m_lookup.end()) {
+    m_entries.splice(m_entries.begin(), m_entries, it->second);
+    return;
+  }
+
+  m_entries.push_front({key, std::move(field)});
+  m_lookup[key] = m_entries.begin();
+  while (m_entries.size() > m_capacity) {
+    m_lookup.erase(m_entries.back().key);
+    m_entries.pop_back();
+  }
+}
+
+void FlowFieldCache::clear() {
+  std::lock_guard<std::mutex> const lock(m_mutex);
+  m_entries.clear();
+  m_lookup.clear();
+}
+
+} // namespace Game::Systems
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "blocked_cells.h"
+#include "pathfinding.h"
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace Game::Systems {
+
+// Integration and direction field towards a single goal cell. Every
+// reachable cell points at the neighbour with the lowest step count to the
+// goal, using the same 8-way moves (no corner cutting) as the A* search, so
+// any number of units can share one field by reference.
+class FlowField {
+public:
+  static constexpr std::uint32_t kUnreachable =
+      std::numeric_limits<std::uint32_t>::max();
+
+  FlowField(const Point &goal, int width, int height,
+            std::uint64_t obstacle_version);
+
+  void build(const BlockedCells &blocked);
+
+  [[nodiscard]] auto goal() const -> const Point & { return m_goal; }
+  [[nodiscard]] auto obstacleVersion() const -> std::uint64_t {
+    return m_obstacleVersion;
+  }
+
+  [[nodiscard]] auto cost(const Point &cell) const -> std::uint32_t;
+  [[nodiscard]] auto hasDirection(const Point &cell) const -> bool;
+  // The neighbour to step to from `cell`, or `cell` itself at the goal and
+  // on cells that cannot reach it.
+  [[nodiscard]] auto next(const Point &cell) const -> Point;
+
+private:
+  static constexpr std::uint8_t kNoDirection = 0xFF;
+
+  [[nodiscard]] auto inBounds(const Point &cell) const -> bool {
+    return cell.x >= 0 && cell.x < m_width && cell.y >= 0 && cell.y < m_height;
+  }
+  [[nodiscard]] auto toIndex(const Point &cell) const -> std::size_t {
+    return static_cast<std::size_t>(cell.y * m_width + cell.x);
+  }
+
+  Point m_goal;
+  int m_width;
+  int m_height;
+  std::uint64_t m_obstacleVersion;
+  std::vector<std::uint32_t> m_integration;
+  std::vector<std::uint8_t> m_directions;
+};
+
+// Least-recently-used set of flow fields keyed by goal cell and obstacle
+// version; fields built against an older grid simply age out.
+class FlowFieldCache {
+public:
+  static constexpr std::size_t kDefaultCapacity = 16;
+
+  explicit FlowFieldCache(std::size_t capacity = kDefaultCapacity)
+      : m_capacity(capacity) {}
+
+  auto find(int goal_cell, std::uint64_t obstacle_version)
+      -> std::shared_ptr<const FlowField>;
+  void insert(int goal_cell, std::shared_ptr<const FlowField> field);
+  void clear();
+
+private:
+  struct Entry {
+    std::uint64_t key;
+    std::shared_ptr<const FlowField> field;
+  };
+
+  static auto makeKey(int goal_cell,
+                      std::uint64_t obstacle_version) -> std::uint64_t {
+    return (obstacle_version << 32) | static_cast<std::uint32_t>(goal_cell);
+  }
+
+  std::size_t m_capacity;
+  std::mutex m_mutex;
+  std::list<Entry> m_entries;
+  std::unordered_map<std::uint64_t, std::list<Entry>::iterator> m_lookup;
+};
+
+} // namespace Game::Systems
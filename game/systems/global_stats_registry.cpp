@@ -6,6 +6,7 @@
 #include "owner_registry.h"
 #include "units/spawn_type.h"
 #include <chrono>
+#include <span>
 #include <unordered_map>
 
 namespace Game::Systems {
@@ -18,18 +19,29 @@ auto GlobalStatsRegistry::instance() -> GlobalStatsRegistry & {
 void GlobalStatsRegistry::initialize() {
   m_unitSpawnedSubscription =
       Engine::Core::ScopedEventSubscription<Engine::Core::UnitSpawnedEvent>(
-          [this](const Engine::Core::UnitSpawnedEvent &e) {
-            onUnitSpawned(e);
+          Engine::Core::kDeferredDispatch,
+          [this](std::span<const Engine::Core::UnitSpawnedEvent> events) {
+            for (const auto &e : events) {
+              onUnitSpawned(e);
+            }
           });
 
   m_unitDiedSubscription =
       Engine::Core::ScopedEventSubscription<Engine::Core::UnitDiedEvent>(
-          [this](const Engine::Core::UnitDiedEvent &e) { onUnitDied(e); });
+          Engine::Core::kDeferredDispatch,
+          [this](std::span<const Engine::Core::UnitDiedEvent> events) {
+            for (const auto &e : events) {
+              onUnitDied(e);
+            }
+          });
 
   m_barrackCapturedSubscription =
       Engine::Core::ScopedEventSubscription<Engine::Core::BarrackCapturedEvent>(
-          [this](const Engine::Core::BarrackCapturedEvent &e) {
-            onBarrackCaptured(e);
+          Engine::Core::kDeferredDispatch,
+          [this](std::span<const Engine::Core::BarrackCapturedEvent> events) {
+            for (const auto &e : events) {
+              onBarrackCaptured(e);
+            }
           });
 }
 
@@ -143,7 +155,7 @@ void GlobalStatsRegistry::rebuildFromWorld(Engine::Core::World &world) {
     m_playerStats[owner_id].gameStartTime = startTime;
   }
 
-  auto entities = world.getEntitiesWith<Engine::Core::UnitComponent>();
+  auto entities = world.query<Engine::Core::UnitComponent>();
   for (auto *e : entities) {
     auto *unit = e->getComponent<Engine::Core::UnitComponent>();
     if ((unit == nullptr) || unit->health <= 0) {
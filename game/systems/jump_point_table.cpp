@@ -0,0 +1,216 @@
+#include "jump_point_table.h"
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+
+namespace Game::Systems {
+
+JumpPointTable::JumpPointTable(int width, int height)
+    : m_width(width), m_height(height),
+      m_tilesX((width + kTileSize - 1) >> kTileShift),
+      m_tilesY((height + kTileSize - 1) >> kTileShift) {}
+
+auto JumpPointTable::directionIndex(int dx, int dy) -> int {
+  for (std::size_t i = 0; i < kDirections.size(); ++i) {
+    if (kDirections[i].x == dx && kDirections[i].y == dy) {
+      return static_cast<int>(i);
+    }
+  }
+  return -1;
+}
+
+void JumpPointTable::build(const BlockedCells &blocked) {
+  std::size_t const tiles = static_cast<std::size_t>(m_tilesX) *
+                            static_cast<std::size_t>(m_tilesY);
+  m_tiles.resize(tiles);
+  for (auto &tile : m_tiles) {
+    tile = std::make_shared<Tile>();
+  }
+  m_ownedTiles.assign(tiles, 1);
+  // Diagonal jumps stop where a straight jump finds something, so the
+  // straight directions (0-3) have to be complete first.
+  for (int direction = 0; direction < 8; ++direction) {
+    buildDirection(blocked, direction);
+  }
+}
+
+void JumpPointTable::update(const BlockedCells &blocked,
+                            const std::vector<ClusterBounds> &regions) {
+  m_ownedTiles.assign(m_tiles.size(), 0);
+
+  // An entry reads the cells within one step of itself and of the cell it
+  // steps to, so every entry whose inputs changed lies within a cell of a
+  // changed region.
+  std::vector<Point> seeds;
+  for (const auto &region : regions) {
+    if (region.empty()) {
+      continue;
+    }
+    int const min_x = std::max(region.min_x - 1, 0);
+    int const min_y = std::max(region.min_y - 1, 0);
+    int const max_x = std::min(region.max_x + 1, m_width - 1);
+    int const max_y = std::min(region.max_y + 1, m_height - 1);
+    for (int y = min_y; y <= max_y; ++y) {
+      for (int x = min_x; x <= max_x; ++x) {
+        seeds.push_back({x, y});
+      }
+    }
+  }
+  if (seeds.empty()) {
+    return;
+  }
+
+  std::array<std::vector<Point>, 4> changed_straight;
+  for (int direction = 0; direction < 4; ++direction) {
+    repairDirection(blocked, direction, seeds,
+                    &changed_straight[static_cast<std::size_t>(direction)]);
+  }
+  // Diagonal entries also read the straight entries of the cell they step
+  // to, so a changed straight entry seeds the diagonal cell behind it.
+  for (int direction = 4; direction < 8; ++direction) {
+    const Point &step = kDirections[static_cast<std::size_t>(direction)];
+    std::vector<Point> diagonal_seeds = seeds;
+    for (int const straight :
+         {directionIndex(step.x, 0), directionIndex(0, step.y)}) {
+      for (const Point &cell :
+           changed_straight[static_cast<std::size_t>(straight)]) {
+        diagonal_seeds.push_back({cell.x - step.x, cell.y - step.y});
+      }
+    }
+    repairDirection(blocked, direction, diagonal_seeds, nullptr);
+  }
+}
+
+auto JumpPointTable::writableEntry(int x, int y) -> Entry & {
+  std::size_t const tile = static_cast<std::size_t>(
+      (y >> kTileShift) * m_tilesX + (x >> kTileShift));
+  if (m_ownedTiles[tile] == 0) {
+    m_tiles[tile] = std::make_shared<Tile>(*m_tiles[tile]);
+    m_ownedTiles[tile] = 1;
+  }
+  return m_tiles[tile]->entries[static_cast<std::size_t>(
+      ((y & (kTileSize - 1)) << kTileShift) | (x & (kTileSize - 1)))];
+}
+
+auto JumpPointTable::hasForcedNeighbor(const BlockedCells &blocked,
+                                       int x, int y, int dx,
+                                       int dy) const -> bool {
+  if (dx != 0) {
+    return (blocked.walkable(x, y - 1) && !blocked.walkable(x - dx, y - 1)) ||
+           (blocked.walkable(x, y + 1) && !blocked.walkable(x - dx, y + 1));
+  }
+  return (blocked.walkable(x - 1, y) && !blocked.walkable(x - 1, y - dy)) ||
+         (blocked.walkable(x + 1, y) && !blocked.walkable(x + 1, y - dy));
+}
+
+auto JumpPointTable::computeEntry(const BlockedCells &blocked, int x, int y,
+                                  int direction) const -> std::int16_t {
+  const Point &step = kDirections[static_cast<std::size_t>(direction)];
+  bool const diagonal = step.x != 0 && step.y != 0;
+  int const nx = x + step.x;
+  int const ny = y + step.y;
+  if (!blocked.walkable(x, y) || !blocked.walkable(nx, ny) ||
+      (diagonal && (!blocked.walkable(nx, y) || !blocked.walkable(x, ny)))) {
+    return 0;
+  }
+
+  bool jump_point = false;
+  if (diagonal) {
+    jump_point = distance(nx, ny, directionIndex(step.x, 0)) > 0 ||
+                 distance(nx, ny, directionIndex(0, step.y)) > 0;
+  } else {
+    jump_point = hasForcedNeighbor(blocked, nx, ny, step.x, step.y);
+  }
+  if (jump_point) {
+    return 1;
+  }
+  int const next = distance(nx, ny, direction);
+  return static_cast<std::int16_t>(next > 0 ? next + 1 : next - 1);
+}
+
+void JumpPointTable::buildDirection(const BlockedCells &blocked,
+                                    int direction) {
+  const Point &step = kDirections[static_cast<std::size_t>(direction)];
+
+  // Visit cells so that the one a step further along is always done.
+  int const y_begin = step.y > 0 ? m_height - 1 : 0;
+  int const y_end = step.y > 0 ? -1 : m_height;
+  int const y_step = step.y > 0 ? -1 : 1;
+  int const x_begin = step.x > 0 ? m_width - 1 : 0;
+  int const x_end = step.x > 0 ? -1 : m_width;
+  int const x_step = step.x > 0 ? -1 : 1;
+
+  for (int y = y_begin; y != y_end; y += y_step) {
+    for (int x = x_begin; x != x_end; x += x_step) {
+      writableEntry(x, y)[static_cast<std::size_t>(direction)] =
+          computeEntry(blocked, x, y, direction);
+    }
+  }
+}
+
+void JumpPointTable::repairDirection(const BlockedCells &blocked,
+                                     int direction,
+                                     const std::vector<Point> &seeds,
+                                     std::vector<Point> *changed) {
+  const Point &step = kDirections[static_cast<std::size_t>(direction)];
+  // Cells on one line along `step` share `line`, and `along` grows by the
+  // same amount with every step.
+  auto line_of = [&](const Point &cell) {
+    return cell.x * step.y - cell.y * step.x + m_width + m_height;
+  };
+  auto along = [&](const Point &cell) {
+    return cell.x * step.x + cell.y * step.y;
+  };
+
+  struct LineSeeds {
+    int first = std::numeric_limits<int>::max();
+    int last = std::numeric_limits<int>::min();
+    Point last_cell;
+  };
+  std::vector<LineSeeds> lines(
+      static_cast<std::size_t>(2 * (m_width + m_height) + 1));
+  for (const Point &seed : seeds) {
+    if (seed.x < 0 || seed.x >= m_width || seed.y < 0 || seed.y >= m_height) {
+      continue;
+    }
+    auto &line = lines[static_cast<std::size_t>(line_of(seed))];
+    int const position = along(seed);
+    line.first = std::min(line.first, position);
+    if (position > line.last) {
+      line.last = position;
+      line.last_cell = seed;
+    }
+  }
+
+  // Entries only depend on the one ahead of them, so each line is walked
+  // back from its furthest seed and stops once it is behind every seed and
+  // an entry comes out as before.
+  for (const auto &line : lines) {
+    if (line.first > line.last) {
+      continue;
+    }
+    Point cell = line.last_cell;
+    while (cell.x >= 0 && cell.x < m_width && cell.y >= 0 &&
+           cell.y < m_height) {
+      std::int16_t const value = computeEntry(blocked, cell.x, cell.y,
+                                              direction);
+      if (value != distance(cell.x, cell.y, direction)) {
+        writableEntry(cell.x, cell.y)[static_cast<std::size_t>(direction)] =
+            value;
+        if (changed != nullptr) {
+          changed->push_back(cell);
+        }
+      } else if (along(cell) <= line.first) {
+        break;
+      }
+      cell.x -= step.x;
+      cell.y -= step.y;
+    }
+  }
+}
+
+} // namespace Game::Systems
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "blocked_cells.h"
+#include "pathfinding.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace Game::Systems {
+
+// Precomputed jump distances for Jump Point Search (JPS+) over the obstacle
+// grid, using the same 8-way moves without corner cutting as the A* search.
+// For every cell and direction the table holds the steps to the next jump
+// point when positive, or the number of open steps before a wall otherwise.
+// Entries are stored in square tiles so that copies share unchanged ones.
+class JumpPointTable {
+public:
+  static constexpr std::array<Point, 8> kDirections{
+      Point{1, 0},  Point{-1, 0}, Point{0, 1},  Point{0, -1},
+      Point{1, 1},  Point{1, -1}, Point{-1, 1}, Point{-1, -1}};
+
+  JumpPointTable(int width, int height);
+
+  void build(const BlockedCells &blocked);
+  // Recomputes the entries that can differ once the cells in `regions`
+  // have changed: every jump line crossing them, back from the change until
+  // the old distances hold again. Tiles are shared with the table this one
+  // was copied from until an entry in them changes.
+  void update(const BlockedCells &blocked,
+              const std::vector<ClusterBounds> &regions);
+
+  [[nodiscard]] auto distance(int x, int y, int direction) const -> int {
+    return entry(x, y)[static_cast<std::size_t>(direction)];
+  }
+
+  static auto directionIndex(int dx, int dy) -> int;
+
+private:
+  static constexpr int kTileShift = 5;
+  static constexpr int kTileSize = 1 << kTileShift;
+
+  using Entry = std::array<std::int16_t, 8>;
+  struct Tile {
+    std::array<Entry, static_cast<std::size_t>(kTileSize * kTileSize)>
+        entries{};
+  };
+
+  [[nodiscard]] auto entry(int x, int y) const -> const Entry & {
+    return m_tiles[static_cast<std::size_t>((y >> kTileShift) * m_tilesX +
+                                            (x >> kTileShift))]
+        ->entries[static_cast<std::size_t>(
+            ((y & (kTileSize - 1)) << kTileShift) | (x & (kTileSize - 1)))];
+  }
+  auto writableEntry(int x, int y) -> Entry &;
+
+  [[nodiscard]] auto hasForcedNeighbor(const BlockedCells &blocked,
+                                       int x, int y, int dx,
+                                       int dy) const -> bool;
+  // The entry of (x, y) for `direction`, given the entry one step further
+  // along is already final.
+  [[nodiscard]] auto computeEntry(const BlockedCells &blocked, int x, int y,
+                                  int direction) const -> std::int16_t;
+
+  void buildDirection(const BlockedCells &blocked, int direction);
+  void repairDirection(const BlockedCells &blocked, int direction,
+                       const std::vector<Point> &seeds,
+                       std::vector<Point> *changed);
+
+  int m_width;
+  int m_height;
+  int m_tilesX;
+  int m_tilesY;
+  std::vector<std::shared_ptr<Tile>> m_tiles;
+  // Tiles this table may write to; the others are still shared.
+  std::vector<std::uint8_t> m_ownedTiles;
+};
+
+} // namespace Game::Systems
@@ -3,11 +3,13 @@
 #include "building_collision_registry.h"
 #include "command_service.h"
 #include "core/component.h"
+#include "flow_field.h"
 #include "map/terrain.h"
 #include "pathfinding.h"
 #include <QVector3D>
 #include <algorithm>
 #include <cmath>
+#include <cstdint>
 #include <numbers>
 #include <qvectornd.h>
 #include <vector>
@@ -16,6 +18,7 @@ namespace Game::Systems {
 
 static constexpr int max_waypoint_skip_count = 4;
 static constexpr float repath_cooldown_seconds = 0.4F;
+static constexpr float flow_field_handoff_distance_sq = 16.0F;
 
 namespace {
 
@@ -84,15 +87,61 @@ auto isSegmentWalkable(const QVector3D &from, const QVector3D &to,
   return end_allowed && exited_blocked_zone;
 }
 
+// Points the unit at the next cell of its group's flow field. Near its own
+// goal, or once the field has nowhere left to send it, the unit drops the
+// field and heads straight for its formation spot.
+void steerAlongFlowField(Engine::Core::MovementComponent &movement,
+                         const Engine::Core::TransformComponent &transform,
+                         Engine::Core::EntityID entity_id) {
+  Pathfinding *pathfinder = CommandService::getPathfinder();
+  QVector3D const current_pos(transform.position.x, 0.0F,
+                              transform.position.z);
+  QVector3D const goal(movement.goalX, 0.0F, movement.goalY);
+
+  bool hand_off = pathfinder == nullptr;
+  Point cell;
+  if (!hand_off) {
+    cell = {static_cast<int>(
+                std::round(current_pos.x() - pathfinder->getGridOffsetX())),
+            static_cast<int>(
+                std::round(current_pos.z() - pathfinder->getGridOffsetZ()))};
+    hand_off = !movement.flowField->hasDirection(cell);
+  }
+  if (!hand_off &&
+      (goal - current_pos).lengthSquared() <= flow_field_handoff_distance_sq) {
+    hand_off = isSegmentWalkable(current_pos, goal, entity_id);
+  }
+
+  if (hand_off) {
+    movement.flowField.reset();
+    movement.target_x = goal.x();
+    movement.target_y = goal.z();
+    return;
+  }
+
+  Point const next = movement.flowField->next(cell);
+  movement.target_x = static_cast<float>(next.x) + pathfinder->getGridOffsetX();
+  movement.target_y = static_cast<float>(next.y) + pathfinder->getGridOffsetZ();
+}
+
 } // namespace
 
 void MovementSystem::update(Engine::Core::World *world, float deltaTime) {
   CommandService::processPathResults(*world);
-  auto entities = world->getEntitiesWith<Engine::Core::MovementComponent>();
+  world->forEach<Engine::Core::MovementComponent>(
+      [&](Engine::Core::Entity &entity, Engine::Core::MovementComponent &) {
+        moveUnit(&entity, world, deltaTime);
+      });
+}
 
-  for (auto *entity : entities) {
-    moveUnit(entity, world, deltaTime);
-  }
+auto MovementSystem::access() const -> Engine::Core::SystemAccess {
+  return Engine::Core::SystemAccess{}
+      .read<Engine::Core::UnitComponent, Engine::Core::AttackComponent,
+            Engine::Core::BuildingComponent, BuildingCollisionRegistry,
+            Game::Map::TerrainService>()
+      .write<Engine::Core::TransformComponent,
+             Engine::Core::MovementComponent,
+             Engine::Core::HoldModeComponent, Pathfinding>();
 }
 
 void MovementSystem::moveUnit(Engine::Core::Entity *entity,
@@ -123,6 +172,7 @@ void MovementSystem::moveUnit(Engine::Core::Entity *entity,
       movement->vx = 0.0F;
       movement->vz = 0.0F;
       movement->path.clear();
+      movement->flowField.reset();
       movement->pathPending = false;
       in_hold_mode = true;
     }
@@ -162,6 +212,7 @@ void MovementSystem::moveUnit(Engine::Core::Entity *entity,
     movement->vx = 0.0F;
     movement->vz = 0.0F;
     movement->path.clear();
+    movement->flowField.reset();
     movement->pathPending = false;
     return;
   }
@@ -171,6 +222,7 @@ void MovementSystem::moveUnit(Engine::Core::Entity *entity,
 
   if (movement->hasTarget && !destination_allowed) {
     movement->path.clear();
+    movement->flowField.reset();
     movement->hasTarget = false;
     movement->pathPending = false;
     movement->pendingRequestId = 0;
@@ -193,6 +245,7 @@ void MovementSystem::moveUnit(Engine::Core::Entity *entity,
   const float damping = 6.0F;
 
   if (!movement->hasTarget) {
+    movement->segmentChecked = false;
     QVector3D const current_pos(transform->position.x, 0.0F,
                                 transform->position.z);
     float const goal_dist_sq = (final_goal - current_pos).lengthSquared();
@@ -217,79 +270,66 @@ void MovementSystem::moveUnit(Engine::Core::Entity *entity,
       movement->vz *= std::max(0.0F, 1.0F - damping * deltaTime);
     }
   } else {
-    QVector3D current_pos(transform->position.x, 0.0F, transform->position.z);
+    if (movement->flowField) {
+      steerAlongFlowField(*movement, *transform, entity->getId());
+    }
+
+    QVector3D const current_pos(transform->position.x, 0.0F,
+                                transform->position.z);
     QVector3D segment_target(movement->target_x, 0.0F, movement->target_y);
     if (!movement->path.empty()) {
       segment_target = QVector3D(movement->path.front().first, 0.0F,
                                  movement->path.front().second);
     }
-    auto refresh_segment_target = [&]() {
-      if (!movement->path.empty()) {
-        movement->target_x = movement->path.front().first;
-        movement->target_y = movement->path.front().second;
-        segment_target =
-            QVector3D(movement->target_x, 0.0F, movement->target_y);
-      } else {
-        segment_target =
-            QVector3D(movement->target_x, 0.0F, movement->target_y);
-      }
-    };
 
-    auto try_advance_past_blocked_segment = [&]() {
-      bool recovered = false;
-      int skips_remaining = max_waypoint_skip_count;
-      while (!movement->path.empty() && skips_remaining-- > 0) {
-        movement->path.erase(movement->path.begin());
-        refresh_segment_target();
-        if (isSegmentWalkable(current_pos, segment_target, entity->getId())) {
-          recovered = true;
-          break;
+    // Worker paths arrive string-pulled with clear segments, so a segment
+    // is only walked again once it or the obstacles have changed.
+    Pathfinding *pathfinder = CommandService::getPathfinder();
+    std::uint64_t const obstacle_changes =
+        (pathfinder != nullptr) ? pathfinder->obstacleChangeCount() : 0;
+    bool const segment_checked =
+        movement->segmentChecked &&
+        movement->checkedTargetX == segment_target.x() &&
+        movement->checkedTargetY == segment_target.z() &&
+        movement->checkedObstacleChanges == obstacle_changes;
+
+    if (!segment_checked &&
+        !isSegmentWalkable(current_pos, segment_target, entity->getId())) {
+      bool issued_path_request = false;
+      if (!movement->pathPending && movement->repathCooldown <= 0.0F) {
+        float const goal_dist_sq = (final_goal - current_pos).lengthSquared();
+        if (goal_dist_sq > 0.01F && destination_allowed) {
+          CommandService::MoveOptions opts;
+          opts.clearAttackIntent = false;
+          opts.allowDirectFallback = false;
+          std::vector<Engine::Core::EntityID> const ids = {entity->getId()};
+          std::vector<QVector3D> const targets = {
+              QVector3D(movement->goalX, 0.0F, movement->goalY)};
+          CommandService::moveUnits(*world, ids, targets, opts);
+          movement->repathCooldown = repath_cooldown_seconds;
+          issued_path_request = true;
         }
       }
 
-      if (!recovered && movement->path.empty()) {
-        refresh_segment_target();
-        if (isSegmentWalkable(current_pos, segment_target, entity->getId())) {
-          recovered = true;
-        }
+      if (!issued_path_request) {
+        movement->pathPending = false;
+        movement->pendingRequestId = 0;
       }
 
-      return recovered;
-    };
-
-    if (!isSegmentWalkable(current_pos, segment_target, entity->getId())) {
-      if (try_advance_past_blocked_segment()) {
-
-      } else {
-        bool issued_path_request = false;
-        if (!movement->pathPending && movement->repathCooldown <= 0.0F) {
-          float const goal_dist_sq = (final_goal - current_pos).lengthSquared();
-          if (goal_dist_sq > 0.01F && destination_allowed) {
-            CommandService::MoveOptions opts;
-            opts.clearAttackIntent = false;
-            opts.allowDirectFallback = false;
-            std::vector<Engine::Core::EntityID> const ids = {entity->getId()};
-            std::vector<QVector3D> const targets = {
-                QVector3D(movement->goalX, 0.0F, movement->goalY)};
-            CommandService::moveUnits(*world, ids, targets, opts);
-            movement->repathCooldown = repath_cooldown_seconds;
-            issued_path_request = true;
-          }
-        }
-
-        if (!issued_path_request) {
-          movement->pathPending = false;
-          movement->pendingRequestId = 0;
-        }
+      movement->path.clear();
 
-        movement->path.clear();
-        movement->hasTarget = false;
-        movement->vx = 0.0F;
-        movement->vz = 0.0F;
-        return;
-      }
+      movement->flowField.reset();
+      movement->hasTarget = false;
+      movement->vx = 0.0F;
+      movement->vz = 0.0F;
+      return;
     }
 
+    movement->segmentChecked = true;
+    movement->checkedTargetX = segment_target.x();
+    movement->checkedTargetY = segment_target.z();
+    movement->checkedObstacleChanges = obstacle_changes;
+
     float const arrive_radius =
         std::clamp(max_speed * deltaTime * 2.0F, 0.05F, 0.25F);
     float const arrive_radiusSq = arrive_radius * arrive_radius;
@@ -329,7 +369,7 @@ void MovementSystem::moveUnit(Engine::Core::Entity *entity,
       float const nz = dz / std::max(0.0001F, distance);
       float desired_speed = max_speed;
       float const slow_radius = arrive_radius * 4.0F;
-      if (distance < slow_radius) {
+      if (distance < slow_radius && !movement->flowField) {
         desired_speed = max_speed * (distance / slow_radius);
       }
       float const desired_vx = nx * desired_speed;
@@ -13,6 +13,7 @@ namespace Game::Systems {
 class MovementSystem : public Engine::Core::System {
 public:
   void update(Engine::Core::World *world, float deltaTime) override;
+  [[nodiscard]] auto access() const -> Engine::Core::SystemAccess override;
 
 private:
   static void moveUnit(Engine::Core::Entity *entity, Engine::Core::World *world,
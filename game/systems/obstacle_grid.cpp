@@ -0,0 +1,172 @@
+#include "obstacle_grid.h"
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace Game::Systems {
+
+namespace {
+
+auto bitRange(int first, int last) -> std::uint64_t {
+  std::uint64_t const upper = ~std::uint64_t{0} >> (63 - last);
+  return upper & (~std::uint64_t{0} << first);
+}
+
+auto unite(const ClusterBounds &a, const ClusterBounds &b) -> ClusterBounds {
+  if (a.empty()) {
+    return b;
+  }
+  if (b.empty()) {
+    return a;
+  }
+  return {std::min(a.min_x, b.min_x), std::min(a.min_y, b.min_y),
+          std::max(a.max_x, b.max_x), std::max(a.max_y, b.max_y)};
+}
+
+} // namespace
+
+ObstacleGrid::ObstacleGrid(int width, int height)
+    : m_width(width), m_height(height),
+      m_stride(static_cast<std::size_t>((width + kWordBits - 1) / kWordBits)) {
+  for (auto &layer : m_layers) {
+    layer.assign(m_stride * static_cast<std::size_t>(height), 0);
+  }
+}
+
+auto ObstacleGrid::isBlocked(int x, int y) const -> bool {
+  if (x < 0 || x >= m_width || y < 0 || y >= m_height) {
+    return true;
+  }
+  return ((combined(wordIndex(x, y)) >> (x % kWordBits)) & 1U) != 0;
+}
+
+auto ObstacleGrid::combined(std::size_t word) const -> std::uint64_t {
+  return m_layers[0][word] | m_layers[1][word] | m_layers[2][word];
+}
+
+auto ObstacleGrid::clip(const ClusterBounds &area) const -> ClusterBounds {
+  return {std::max(area.min_x, 0), std::max(area.min_y, 0),
+          std::min(area.max_x, m_width - 1),
+          std::min(area.max_y, m_height - 1)};
+}
+
+void ObstacleGrid::writeBits(Layer layer, int y, int word_x,
+                             std::uint64_t mask, std::uint64_t bits,
+                             ClusterBounds &changed) {
+  std::size_t const word =
+      static_cast<std::size_t>(y) * m_stride + static_cast<std::size_t>(word_x);
+  auto &target = m_layers[static_cast<std::size_t>(layer)][word];
+  std::uint64_t const before = combined(word);
+  target = (target & ~mask) | (bits & mask);
+  std::uint64_t const flipped = before ^ combined(word);
+  if (flipped == 0) {
+    return;
+  }
+  int const base = word_x * kWordBits;
+  int const first = base + static_cast<int>(std::countr_zero(flipped));
+  int const last = base + static_cast<int>(std::bit_width(flipped)) - 1;
+  ClusterBounds const cells{first, y, last, y};
+  changed = unite(changed, cells);
+}
+
+void ObstacleGrid::commit(const ClusterBounds &changed) {
+  if (changed.empty()) {
+    return;
+  }
+  ++m_version;
+  if (m_dirty.size() < kMaxDirtyRegions) {
+    m_dirty.push_back(changed);
+    return;
+  }
+  // Past the limit the regions collapse into their bounding box, which is
+  // still far cheaper to republish than tracking every scattered cell.
+  ClusterBounds merged = changed;
+  for (const auto &region : m_dirty) {
+    merged = unite(merged, region);
+  }
+  m_dirty.assign(1, merged);
+}
+
+void ObstacleGrid::setCell(Layer layer, int x, int y, bool blocked) {
+  if (x < 0 || x >= m_width || y < 0 || y >= m_height) {
+    return;
+  }
+  ClusterBounds changed = ClusterBounds::none();
+  std::uint64_t const mask = std::uint64_t{1} << (x % kWordBits);
+  writeBits(layer, y, x / kWordBits, mask, blocked ? mask : 0, changed);
+  commit(changed);
+}
+
+void ObstacleGrid::assignRect(Layer layer, const ClusterBounds &area,
+                              const std::vector<ClusterBounds> &filled) {
+  ClusterBounds const bounds = clip(area);
+  if (bounds.empty()) {
+    return;
+  }
+
+  std::vector<ClusterBounds> covering;
+  covering.reserve(filled.size());
+  for (const auto &rect : filled) {
+    ClusterBounds const part{std::max(rect.min_x, bounds.min_x),
+                             std::max(rect.min_y, bounds.min_y),
+                             std::min(rect.max_x, bounds.max_x),
+                             std::min(rect.max_y, bounds.max_y)};
+    if (!part.empty()) {
+      covering.push_back(part);
+    }
+  }
+
+  ClusterBounds changed = ClusterBounds::none();
+  int const first_word = bounds.min_x / kWordBits;
+  int const last_word = bounds.max_x / kWordBits;
+  for (int y = bounds.min_y; y <= bounds.max_y; ++y) {
+    for (int word_x = first_word; word_x <= last_word; ++word_x) {
+      int const base = word_x * kWordBits;
+      auto span = [base](int from, int to) {
+        return bitRange(std::max(from - base, 0),
+                        std::min(to - base, kWordBits - 1));
+      };
+      std::uint64_t const mask = span(bounds.min_x, bounds.max_x);
+      std::uint64_t bits = 0;
+      for (const auto &rect : covering) {
+        if (y >= rect.min_y && y <= rect.max_y && rect.max_x >= base &&
+            rect.min_x < base + kWordBits) {
+          bits |= span(rect.min_x, rect.max_x);
+        }
+      }
+      writeBits(layer, y, word_x, mask, bits, changed);
+    }
+  }
+  commit(changed);
+}
+
+void ObstacleGrid::assignLayer(Layer layer,
+                               const std::vector<std::uint8_t> &blocked) {
+  ClusterBounds changed = ClusterBounds::none();
+  for (int y = 0; y < m_height; ++y) {
+    std::size_t const row =
+        static_cast<std::size_t>(y) * static_cast<std::size_t>(m_width);
+    for (std::size_t word_x = 0; word_x < m_stride; ++word_x) {
+      int const base = static_cast<int>(word_x) * kWordBits;
+      int const count = std::min(kWordBits, m_width - base);
+      std::uint64_t bits = 0;
+      for (int bit = 0; bit < count; ++bit) {
+        if (blocked[row + static_cast<std::size_t>(base + bit)] != 0) {
+          bits |= std::uint64_t{1} << bit;
+        }
+      }
+      writeBits(layer, y, static_cast<int>(word_x), bitRange(0, count - 1),
+                bits, changed);
+    }
+  }
+  commit(changed);
+}
+
+auto ObstacleGrid::takeDirtyRegions() -> std::vector<ClusterBounds> {
+  return std::exchange(m_dirty, {});
+}
+
+} // namespace Game::Systems
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "path_clusters.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Game::Systems {
+
+// Bit-packed blocked cells, one bit per cell and one row of 64-bit words per
+// grid line, kept as separate layers so terrain is loaded once while
+// buildings only rewrite the rectangles their footprints touch. The version
+// advances whenever the combined state of any cell changes, and the changed
+// regions are collected until the snapshot that publishes them takes them.
+class ObstacleGrid {
+public:
+  enum class Layer : std::uint8_t { Terrain, Buildings, Overrides };
+
+  static constexpr int kWordBits = 64;
+
+  ObstacleGrid(int width, int height);
+
+  [[nodiscard]] auto width() const -> int { return m_width; }
+  [[nodiscard]] auto height() const -> int { return m_height; }
+  [[nodiscard]] auto version() const -> std::uint64_t { return m_version; }
+
+  [[nodiscard]] auto isBlocked(int x, int y) const -> bool;
+
+  void setCell(Layer layer, int x, int y, bool blocked);
+  // Blocks the cells of `area` covered by one of `filled` and clears the
+  // rest of it; cells outside `area` keep their state.
+  void assignRect(Layer layer, const ClusterBounds &area,
+                  const std::vector<ClusterBounds> &filled);
+  // Replaces a whole layer from one byte per cell, row-major.
+  void assignLayer(Layer layer, const std::vector<std::uint8_t> &blocked);
+
+  auto takeDirtyRegions() -> std::vector<ClusterBounds>;
+  // The combined blocked bits of cells [word_x * kWordBits, +kWordBits) of
+  // row `y`; bits past the grid's width are clear.
+  [[nodiscard]] auto combinedWord(int word_x, int y) const -> std::uint64_t {
+    return combined(wordIndex(word_x * kWordBits, y));
+  }
+
+private:
+  static constexpr std::size_t kMaxDirtyRegions = 64;
+
+  [[nodiscard]] auto wordIndex(int x, int y) const -> std::size_t {
+    return static_cast<std::size_t>(y) * m_stride +
+           static_cast<std::size_t>(x / kWordBits);
+  }
+  [[nodiscard]] auto combined(std::size_t word) const -> std::uint64_t;
+  [[nodiscard]] auto clip(const ClusterBounds &area) const -> ClusterBounds;
+
+  void writeBits(Layer layer, int y, int word_x, std::uint64_t mask,
+                 std::uint64_t bits, ClusterBounds &changed);
+  void commit(const ClusterBounds &changed);
+
+  int m_width;
+  int m_height;
+  std::size_t m_stride;
+  std::array<std::vector<std::uint64_t>, 3> m_layers;
+  std::vector<ClusterBounds> m_dirty;
+  std::uint64_t m_version{0};
+};
+
+} // namespace Game::Systems
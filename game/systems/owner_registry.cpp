@@ -1,7 +1,9 @@
 #include "owner_registry.h"
 #include <QDebug>
+#include <algorithm>
 #include <array>
 #include <cstddef>
+#include <cstdint>
 #include <qjsonarray.h>
 #include <qjsonobject.h>
 #include <qjsonvalue.h>
@@ -66,6 +68,7 @@ auto OwnerRegistry::instance() -> OwnerRegistry & {
 void OwnerRegistry::clear() {
   m_owners.clear();
   m_owner_idToIndex.clear();
+  m_allyMasks.clear();
   m_nextOwnerId = 1;
   m_localPlayerId = 1;
 }
@@ -99,6 +102,7 @@ auto OwnerRegistry::registerOwner(OwnerType type,
   size_t const index = m_owners.size();
   m_owners.push_back(info);
   m_owner_idToIndex[owner_id] = index;
+  rebuildAllianceMasks();
 
   return owner_id;
 }
@@ -135,6 +139,7 @@ void OwnerRegistry::registerOwnerWithId(int owner_id, OwnerType type,
   size_t const index = m_owners.size();
   m_owners.push_back(info);
   m_owner_idToIndex[owner_id] = index;
+  rebuildAllianceMasks();
 
   if (owner_id >= m_nextOwnerId) {
     m_nextOwnerId = owner_id + 1;
@@ -207,6 +212,7 @@ void OwnerRegistry::setOwnerTeam(int owner_id, int team_id) {
   auto it = m_owner_idToIndex.find(owner_id);
   if (it != m_owner_idToIndex.end()) {
     m_owners[it->second].team_id = team_id;
+    rebuildAllianceMasks();
   }
 }
 
@@ -224,6 +230,14 @@ auto OwnerRegistry::areAllies(int owner_id1, int owner_id2) const -> bool {
     return true;
   }
 
+  std::uint64_t const bit = getOwnerBit(owner_id2);
+  if (bit != 0) {
+    std::uint64_t const allies = getAllyMask(owner_id1);
+    if (allies != 0) {
+      return (allies & bit) != 0;
+    }
+  }
+
   int const team1 = getOwnerTeam(owner_id1);
   int const team2 = getOwnerTeam(owner_id2);
 
@@ -245,6 +259,34 @@ auto OwnerRegistry::areEnemies(int owner_id1, int owner_id2) const -> bool {
   return true;
 }
 
+auto OwnerRegistry::getAllyMask(int owner_id) const -> std::uint64_t {
+  auto it = m_owner_idToIndex.find(owner_id);
+  if (it == m_owner_idToIndex.end() || it->second >= m_allyMasks.size()) {
+    return 0;
+  }
+  return m_allyMasks[it->second];
+}
+
+auto OwnerRegistry::getOwnerBit(int owner_id) const -> std::uint64_t {
+  auto it = m_owner_idToIndex.find(owner_id);
+  if (it == m_owner_idToIndex.end() || it->second >= kMaxMaskedOwners) {
+    return 0;
+  }
+  return std::uint64_t{1} << it->second;
+}
+
+void OwnerRegistry::rebuildAllianceMasks() {
+  std::size_t const count = std::min(m_owners.size(), kMaxMaskedOwners);
+  m_allyMasks.assign(count, 0);
+  for (std::size_t i = 0; i < count; ++i) {
+    for (std::size_t j = 0; j < count; ++j) {
+      if (i == j || m_owners[i].team_id == m_owners[j].team_id) {
+        m_allyMasks[i] |= std::uint64_t{1} << j;
+      }
+    }
+  }
+}
+
 auto OwnerRegistry::getAlliesOf(int owner_id) const -> std::vector<int> {
   std::vector<int> result;
   int const my_team = getOwnerTeam(owner_id);
@@ -337,6 +379,8 @@ void OwnerRegistry::fromJson(const QJsonObject &json) {
       m_nextOwnerId = owner.owner_id + 1;
     }
   }
+
+  rebuildAllianceMasks();
 }
 
 } // namespace Game::Systems
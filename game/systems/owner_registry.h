@@ -3,6 +3,7 @@
 #include <QJsonArray>
 #include <QJsonObject>
 #include <array>
+#include <cstdint>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -56,6 +57,8 @@ public:
   auto getOwnerTeam(int owner_id) const -> int;
   auto areAllies(int owner_id1, int owner_id2) const -> bool;
   auto areEnemies(int owner_id1, int owner_id2) const -> bool;
+  auto getAllyMask(int owner_id) const -> std::uint64_t;
+  auto getOwnerBit(int owner_id) const -> std::uint64_t;
   auto getAlliesOf(int owner_id) const -> std::vector<int>;
   auto getEnemiesOf(int owner_id) const -> std::vector<int>;
 
@@ -71,10 +74,16 @@ private:
   OwnerRegistry(const OwnerRegistry &) = delete;
   auto operator=(const OwnerRegistry &) -> OwnerRegistry & = delete;
 
+  static constexpr std::size_t kMaxMaskedOwners = 64;
+
+  void rebuildAllianceMasks();
+
   int m_nextOwnerId = 1;
   int m_localPlayerId = 1;
   std::vector<OwnerInfo> m_owners;
   std::unordered_map<int, size_t> m_owner_idToIndex;
+  // Row i holds the owner indices allied with owner i, itself included.
+  std::vector<std::uint64_t> m_allyMasks;
 };
 
 } // namespace Game::Systems
@@ -0,0 +1,54 @@
+#include "path_cache.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace Game::Systems {
+
+auto PathCache::find(int start_cell, int goal_cell,
+                     std::uint64_t obstacle_version)
+    -> std::shared_ptr<const std::vector<Point>> {
+  std::lock_guard<std::mutex> const lock(m_mutex);
+  auto it = m_lookup.find({start_cell, goal_cell, obstacle_version});
+  if (it == m_lookup.end()) {
+    return nullptr;
+  }
+  m_entries.splice(m_entries.begin(), m_entries, it->second);
+  return it->second->path;
+}
+
+void PathCache::insert(int start_cell, int goal_cell,
+                       std::uint64_t obstacle_version,
+                       std::shared_ptr<const std::vector<Point>> path) {
+  Key const key{start_cell, goal_cell, obstacle_version};
+  std::lock_guard<std::mutex> const lock(m_mutex);
+  auto it = m_lookup.find(key);
+  if (it != m_lookup.end()) {
+    it->second->path = std::move(path);
+    m_entries.splice(m_entries.begin(), m_entries, it->second);
+    return;
+  }
+
+  m_entries.push_front({key, std::move(path)});
+  m_lookup[key] = m_entries.begin();
+  while (m_entries.size() > m_capacity) {
+    m_lookup.erase(m_entries.back().key);
+    m_entries.pop_back();
+  }
+}
+
+void PathCache::clear() {
+  std::lock_guard<std::mutex> const lock(m_mutex);
+  m_entries.clear();
+  m_lookup.clear();
+}
+
+auto PathCache::size() const -> std::size_t {
+  std::lock_guard<std::mutex> const lock(m_mutex);
+  return m_entries.size();
+}
+
+} // namespace Game::Systems
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "pathfinding.h"
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace Game::Systems {
+
+// Least-recently-used store of finished searches keyed by start cell, goal
+// cell and obstacle version. Paths are shared read-only between requests.
+class PathCache {
+public:
+  static constexpr std::size_t kDefaultCapacity = 512;
+
+  explicit PathCache(std::size_t capacity = kDefaultCapacity)
+      : m_capacity(capacity) {}
+
+  auto find(int start_cell, int goal_cell, std::uint64_t obstacle_version)
+      -> std::shared_ptr<const std::vector<Point>>;
+  void insert(int start_cell, int goal_cell, std::uint64_t obstacle_version,
+              std::shared_ptr<const std::vector<Point>> path);
+  void clear();
+
+  [[nodiscard]] auto size() const -> std::size_t;
+
+private:
+  struct Key {
+    int start_cell;
+    int goal_cell;
+    std::uint64_t obstacle_version;
+
+    auto operator==(const Key &other) const -> bool {
+      return start_cell == other.start_cell && goal_cell == other.goal_cell &&
+             obstacle_version == other.obstacle_version;
+    }
+  };
+
+  struct KeyHash {
+    auto operator()(const Key &key) const -> std::size_t {
+      std::uint64_t hash = static_cast<std::uint32_t>(key.start_cell);
+      hash = hash * 0x9E3779B97F4A7C15ULL +
+             static_cast<std::uint32_t>(key.goal_cell);
+      hash = hash * 0x9E3779B97F4A7C15ULL + key.obstacle_version;
+      return static_cast<std::size_t>(hash ^ (hash >> 29));
+    }
+  };
+
+  struct Entry {
+    Key key;
+    std::shared_ptr<const std::vector<Point>> path;
+  };
+
+  std::size_t m_capacity;
+  mutable std::mutex m_mutex;
+  std::list<Entry> m_entries;
+  std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> m_lookup;
+};
+
+} // namespace Game::Systems
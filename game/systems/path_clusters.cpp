@@ -0,0 +1,236 @@
+#include "path_clusters.h"
+#include "blocked_cells.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace Game::Systems {
+
+namespace {
+
+constexpr int k_max_single_entrance_run = 6;
+
+} // namespace
+
+PathClusterGraph::PathClusterGraph(int width, int height)
+    : m_width(width), m_height(height),
+      m_clustersX((width + kClusterSize - 1) / kClusterSize),
+      m_clustersY((height + kClusterSize - 1) / kClusterSize) {
+  m_clusters.assign(static_cast<std::size_t>(m_clustersX * m_clustersY),
+                    std::make_shared<const Cluster>());
+}
+
+void PathClusterGraph::rebuild(const BlockedCells &blocked) {
+  for (int cluster = 0; cluster < m_clustersX * m_clustersY; ++cluster) {
+    buildCluster(blocked, cluster);
+  }
+}
+
+void PathClusterGraph::update(const BlockedCells &blocked,
+                              const std::vector<int> &clusters) {
+  for (int const cluster : clusters) {
+    buildCluster(blocked, cluster);
+  }
+}
+
+auto PathClusterGraph::changedClusters(
+    const std::vector<ClusterBounds> &regions) const -> std::vector<int> {
+  std::vector<std::uint8_t> marked(m_clusters.size(), 0);
+  std::vector<int> result;
+  for (const auto &region : regions) {
+    if (region.empty()) {
+      continue;
+    }
+    // Growing the region by a cell also catches the clusters across a
+    // border, whose entrances depend on the cells along it.
+    int const first_cx = std::max(region.min_x - 1, 0) / kClusterSize;
+    int const first_cy = std::max(region.min_y - 1, 0) / kClusterSize;
+    int const last_cx =
+        std::min(region.max_x + 1, m_width - 1) / kClusterSize;
+    int const last_cy =
+        std::min(region.max_y + 1, m_height - 1) / kClusterSize;
+    for (int cy = first_cy; cy <= last_cy; ++cy) {
+      for (int cx = first_cx; cx <= last_cx; ++cx) {
+        int const cluster = cy * m_clustersX + cx;
+        if (marked[static_cast<std::size_t>(cluster)] == 0) {
+          marked[static_cast<std::size_t>(cluster)] = 1;
+          result.push_back(cluster);
+        }
+      }
+    }
+  }
+  return result;
+}
+
+auto PathClusterGraph::bounds(int cluster) const -> ClusterBounds {
+  int const cx = cluster % m_clustersX;
+  int const cy = cluster / m_clustersX;
+  ClusterBounds area;
+  area.min_x = cx * kClusterSize;
+  area.min_y = cy * kClusterSize;
+  area.max_x = std::min(area.min_x + kClusterSize, m_width) - 1;
+  area.max_y = std::min(area.min_y + kClusterSize, m_height) - 1;
+  return area;
+}
+
+auto PathClusterGraph::findEntrance(int cluster, int cell) const -> int {
+  const auto &cells = entrances(cluster);
+  auto it = std::find(cells.begin(), cells.end(), cell);
+  return it == cells.end() ? -1 : static_cast<int>(it - cells.begin());
+}
+
+auto PathClusterGraph::distance(int cluster, int from, int to) const -> int {
+  const auto &data = *m_clusters[static_cast<std::size_t>(cluster)];
+  return data.distances[static_cast<std::size_t>(from) * data.cells.size() +
+                        static_cast<std::size_t>(to)];
+}
+
+void PathClusterGraph::distancesFrom(const BlockedCells &blocked,
+                                     int cell, const std::vector<int> &targets,
+                                     std::vector<int> &out) const {
+  ClusterBounds const area = bounds(clusterOfCell(cell));
+  std::vector<int> dist;
+  floodCluster(blocked, area, cell, dist);
+
+  out.clear();
+  out.reserve(targets.size());
+  for (int const target : targets) {
+    int const x = target % m_width;
+    int const y = target / m_width;
+    if (!area.contains(x, y)) {
+      out.push_back(kUnreachable);
+      continue;
+    }
+    out.push_back(dist[static_cast<std::size_t>(
+        (y - area.min_y) * area.width() + (x - area.min_x))]);
+  }
+}
+
+void PathClusterGraph::buildCluster(const BlockedCells &blocked,
+                                    int cluster) {
+  ClusterBounds const area = bounds(cluster);
+  auto built = std::make_shared<Cluster>();
+  auto &data = *built;
+  addBorderEntrances(blocked, area, 1, 0, data.cells);
+  addBorderEntrances(blocked, area, -1, 0, data.cells);
+  addBorderEntrances(blocked, area, 0, 1, data.cells);
+  addBorderEntrances(blocked, area, 0, -1, data.cells);
+  std::sort(data.cells.begin(), data.cells.end());
+  data.cells.erase(std::unique(data.cells.begin(), data.cells.end()),
+                   data.cells.end());
+
+  std::size_t const count = data.cells.size();
+  data.distances.assign(count * count, kUnreachable);
+  std::vector<int> dist;
+  for (std::size_t i = 0; i < count; ++i) {
+    floodCluster(blocked, area, data.cells[i], dist);
+    for (std::size_t j = 0; j < count; ++j) {
+      int const x = data.cells[j] % m_width;
+      int const y = data.cells[j] / m_width;
+      data.distances[i * count + j] = dist[static_cast<std::size_t>(
+          (y - area.min_y) * area.width() + (x - area.min_x))];
+    }
+  }
+  m_clusters[static_cast<std::size_t>(cluster)] = std::move(built);
+}
+
+void PathClusterGraph::addBorderEntrances(
+    const BlockedCells &blocked, const ClusterBounds &area,
+    int dx, int dy, std::vector<int> &cells) const {
+  // Walk the border row or column facing (dx, dy).
+  int const fixed = dx > 0 ? area.max_x
+                    : dx < 0 ? area.min_x
+                    : dy > 0 ? area.max_y
+                             : area.min_y;
+  int const begin = dx != 0 ? area.min_y : area.min_x;
+  int const end = dx != 0 ? area.max_y : area.max_x;
+
+  auto position = [&](int along, int &x, int &y) {
+    if (dx != 0) {
+      x = fixed;
+      y = along;
+    } else {
+      x = along;
+      y = fixed;
+    }
+  };
+  auto open = [&](int along) {
+    int x = 0;
+    int y = 0;
+    position(along, x, y);
+    return blocked.walkable(x, y) && blocked.walkable(x + dx, y + dy);
+  };
+  auto add = [&](int along) {
+    int x = 0;
+    int y = 0;
+    position(along, x, y);
+    cells.push_back(y * m_width + x);
+  };
+
+  int along = begin;
+  while (along <= end) {
+    if (!open(along)) {
+      ++along;
+      continue;
+    }
+    int const run_start = along;
+    while (along + 1 <= end && open(along + 1)) {
+      ++along;
+    }
+    int const run_end = along;
+    if (run_end - run_start + 1 < k_max_single_entrance_run) {
+      add((run_start + run_end) / 2);
+    } else {
+      add(run_start);
+      add(run_end);
+    }
+    ++along;
+  }
+}
+
+void PathClusterGraph::floodCluster(const BlockedCells &blocked,
+                                    const ClusterBounds &area, int cell,
+                                    std::vector<int> &dist) const {
+  int const w = area.width();
+  dist.assign(static_cast<std::size_t>(w * area.height()), kUnreachable);
+  auto local = [&](int x, int y) {
+    return static_cast<std::size_t>((y - area.min_y) * w + (x - area.min_x));
+  };
+
+  int const start_x = cell % m_width;
+  int const start_y = cell / m_width;
+  if (!area.contains(start_x, start_y) ||
+      !blocked.walkable(start_x, start_y)) {
+    return;
+  }
+
+  std::vector<int> queue;
+  queue.reserve(dist.size());
+  queue.push_back(cell);
+  dist[local(start_x, start_y)] = 0;
+
+  for (std::size_t head = 0; head < queue.size(); ++head) {
+    int const x = queue[head] % m_width;
+    int const y = queue[head] / m_width;
+    int const next_dist = dist[local(x, y)] + 1;
+    for (int ny = y - 1; ny <= y + 1; ++ny) {
+      for (int nx = x - 1; nx <= x + 1; ++nx) {
+        if ((nx == x && ny == y) || !area.contains(nx, ny) ||
+            !blocked.walkable(nx, ny) || dist[local(nx, ny)] >= 0) {
+          continue;
+        }
+        if (nx != x && ny != y &&
+            (!blocked.walkable(nx, y) || !blocked.walkable(x, ny))) {
+          continue;
+        }
+        dist[local(nx, ny)] = next_dist;
+        queue.push_back(ny * m_width + nx);
+      }
+    }
+  }
+}
+
+} // namespace Game::Systems
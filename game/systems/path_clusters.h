@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace Game::Systems {
+
+class BlockedCells;
+
+struct ClusterBounds {
+  int min_x = 0;
+  int min_y = 0;
+  int max_x = 0;
+  int max_y = 0;
+
+  [[nodiscard]] auto contains(int x, int y) const -> bool {
+    return x >= min_x && x <= max_x && y >= min_y && y <= max_y;
+  }
+  [[nodiscard]] auto width() const -> int { return max_x - min_x + 1; }
+  [[nodiscard]] auto height() const -> int { return max_y - min_y + 1; }
+  [[nodiscard]] auto empty() const -> bool {
+    return max_x < min_x || max_y < min_y;
+  }
+  static constexpr auto none() -> ClusterBounds { return {0, 0, -1, -1}; }
+
+  auto operator==(const ClusterBounds &other) const -> bool = default;
+};
+
+// Abstract graph for hierarchical pathfinding (HPA*). The grid is cut into
+// square clusters; every walkable run along a shared cluster border gets one
+// entrance (two for long runs), and each cluster stores the in-cluster step
+// distance between all of its entrance cells. Entrances on either side of a
+// border are orthogonal neighbours, so crossing one always costs one step.
+class PathClusterGraph {
+public:
+  static constexpr int kClusterSize = 16;
+  static constexpr int kUnreachable = -1;
+
+  PathClusterGraph(int width, int height);
+
+  void rebuild(const BlockedCells &blocked);
+  void update(const BlockedCells &blocked,
+              const std::vector<int> &clusters);
+
+  // Clusters whose entrances or distances may differ once the cells in
+  // `regions` have changed.
+  [[nodiscard]] auto
+  changedClusters(const std::vector<ClusterBounds> &regions) const
+      -> std::vector<int>;
+
+  [[nodiscard]] auto clusterOf(int x, int y) const -> int {
+    return (y / kClusterSize) * m_clustersX + (x / kClusterSize);
+  }
+  [[nodiscard]] auto clusterOfCell(int cell) const -> int {
+    return clusterOf(cell % m_width, cell / m_width);
+  }
+  [[nodiscard]] auto bounds(int cluster) const -> ClusterBounds;
+
+  [[nodiscard]] auto entrances(int cluster) const -> const std::vector<int> & {
+    return m_clusters[static_cast<std::size_t>(cluster)]->cells;
+  }
+  [[nodiscard]] auto findEntrance(int cluster, int cell) const -> int;
+  [[nodiscard]] auto distance(int cluster, int from, int to) const -> int;
+
+  // Step distances inside the cell's cluster from `cell` to each target
+  // cell, or kUnreachable.
+  void distancesFrom(const BlockedCells &blocked, int cell,
+                     const std::vector<int> &targets,
+                     std::vector<int> &out) const;
+
+  [[nodiscard]] auto width() const -> int { return m_width; }
+  [[nodiscard]] auto height() const -> int { return m_height; }
+
+private:
+  struct Cluster {
+    std::vector<int> cells;
+    std::vector<int> distances;
+  };
+
+  void buildCluster(const BlockedCells &blocked, int cluster);
+  void addBorderEntrances(const BlockedCells &blocked,
+                          const ClusterBounds &area, int dx, int dy,
+                          std::vector<int> &cells) const;
+  void floodCluster(const BlockedCells &blocked,
+                    const ClusterBounds &area, int cell,
+                    std::vector<int> &dist) const;
+
+  int m_width;
+  int m_height;
+  int m_clustersX;
+  int m_clustersY;
+  // Shared between snapshots; an update replaces only the clusters it
+  // rebuilds, so copying the graph copies pointers.
+  std::vector<std::shared_ptr<const Cluster>> m_clusters;
+};
+
+} // namespace Game::Systems
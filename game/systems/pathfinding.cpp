@@ -1,6 +1,11 @@
 #include "pathfinding.h"
+#include "../core/profiler.h"
 #include "../map/terrain_service.h"
 #include "building_collision_registry.h"
+#include "flow_field.h"
+#include "jump_point_table.h"
+#include "path_cache.h"
+#include "walkable_regions.h"
 #include "map/terrain.h"
 #include <algorithm>
 #include <array>
@@ -10,48 +15,97 @@
 #include <cstdint>
 #include <future>
 #include <limits>
+#include <memory>
 #include <mutex>
 #include <utility>
 #include <vector>
 
 namespace Game::Systems {
 
-Pathfinding::Pathfinding(int width, int height)
-    : m_width(width), m_height(height) {
-  m_obstacles.resize(height, std::vector<std::uint8_t>(width, 0));
-  ensureWorkingBuffers();
+Pathfinding::Pathfinding(int width, int height, std::size_t worker_count)
+    : m_width(width), m_height(height), m_obstacles(width, height),
+      m_flowFields(std::make_unique<FlowFieldCache>()),
+      m_pathCache(std::make_unique<PathCache>()) {
+  publishSnapshot();
   m_obstaclesDirty.store(true, std::memory_order_release);
-  m_workerThread = std::thread(&Pathfinding::workerLoop, this);
+
+  worker_count = std::max<std::size_t>(worker_count, 1);
+  m_workers.reserve(worker_count);
+  for (std::size_t i = 0; i < worker_count; ++i) {
+    m_workers.emplace_back(&Pathfinding::workerLoop, this);
+  }
 }
 
 Pathfinding::~Pathfinding() {
-  m_stopWorker.store(true, std::memory_order_release);
+  {
+    std::lock_guard<std::mutex> const lock(m_requestMutex);
+    m_stopWorker.store(true, std::memory_order_release);
+  }
   m_requestCondition.notify_all();
-  if (m_workerThread.joinable()) {
-    m_workerThread.join();
+  for (auto &worker : m_workers) {
+    if (worker.joinable()) {
+      worker.join();
+    }
   }
 }
 
+auto Pathfinding::defaultWorkerCount() -> std::size_t {
+  unsigned const hardware = std::thread::hardware_concurrency();
+  return std::clamp<std::size_t>(hardware / 2, 1, 8);
+}
+
 void Pathfinding::setGridOffset(float offset_x, float offset_z) {
   m_gridOffsetX = offset_x;
   m_gridOffsetZ = offset_z;
 }
 
+void Pathfinding::setSearchMode(SearchMode mode) {
+  if (m_searchMode.exchange(mode, std::memory_order_acq_rel) == mode) {
+    return;
+  }
+  // Republish so the next snapshot carries (or drops) the jump table.
+  std::lock_guard<std::mutex> const lock(m_mutex);
+  m_snapshotStale.store(true, std::memory_order_release);
+}
+
+void Pathfinding::setGoalRedirectRadius(int radius) {
+  radius = std::max(radius, 0);
+  if (m_goalRedirectRadius.exchange(radius, std::memory_order_acq_rel) !=
+      radius) {
+    // Cached paths towards unreachable goals depend on the radius.
+    m_pathCache->clear();
+  }
+}
+
+void Pathfinding::setSearchSliceBudget(std::size_t nodes) {
+  m_sliceBudget.store(nodes, std::memory_order_release);
+}
+
 void Pathfinding::setObstacle(int x, int y, bool isObstacle) {
   if (x >= 0 && x < m_width && y >= 0 && y < m_height) {
-    m_obstacles[y][x] = static_cast<std::uint8_t>(isObstacle);
+    std::lock_guard<std::mutex> const lock(m_mutex);
+    m_obstacles.setCell(ObstacleGrid::Layer::Overrides, x, y, isObstacle);
+    m_obstacleChanges.fetch_add(1, std::memory_order_acq_rel);
+    m_snapshotStale.store(true, std::memory_order_release);
   }
 }
 
 auto Pathfinding::isWalkable(int x, int y) const -> bool {
-  if (x < 0 || x >= m_width || y < 0 || y >= m_height) {
-    return false;
-  }
-  return m_obstacles[y][x] == 0;
+  auto const grid = m_snapshot.load(std::memory_order_acquire);
+  return grid->isWalkable(x, y);
 }
 
 void Pathfinding::markObstaclesDirty() {
   m_obstaclesDirty.store(true, std::memory_order_release);
+  m_obstacleChanges.fetch_add(1, std::memory_order_acq_rel);
+}
+
+void Pathfinding::markTerrainDirty() {
+  {
+    std::lock_guard<std::mutex> const lock(m_mutex);
+    m_terrainDirty = true;
+  }
+  markObstaclesDirty();
 }
 
 void Pathfinding::updateBuildingObstacles() {
@@ -66,9 +120,20 @@ void Pathfinding::updateBuildingObstacles() {
     return;
   }
 
-  for (auto &row : m_obstacles) {
-    std::fill(row.begin(), row.end(), static_cast<std::uint8_t>(0));
+  if (m_terrainDirty) {
+    loadTerrainLayer();
+    m_terrainDirty = false;
   }
+  updateBuildingLayer();
+
+  publishSnapshot();
+  m_obstaclesDirty.store(false, std::memory_order_release);
+}
+
+void Pathfinding::loadTerrainLayer() {
+  std::vector<std::uint8_t> blocked(static_cast<std::size_t>(m_width) *
+                                        static_cast<std::size_t>(m_height),
+                                    0);
 
   auto &terrain_service = Game::Map::TerrainService::instance();
   if (terrain_service.isInitialized()) {
@@ -81,50 +146,180 @@ void Pathfinding::updateBuildingObstacles() {
 
     for (int z = 0; z < m_height; ++z) {
       for (int x = 0; x < m_width; ++x) {
-        bool blocked = false;
+        bool blocked_cell = false;
         if (x < terrain_width && z < terrain_height) {
-          blocked = !terrain_service.isWalkable(x, z);
+          blocked_cell = !terrain_service.isWalkable(x, z);
         } else {
-          blocked = true;
+          blocked_cell = true;
         }
 
-        if (blocked) {
-          m_obstacles[z][x] = static_cast<std::uint8_t>(1);
+        if (blocked_cell) {
+          blocked[static_cast<std::size_t>(toIndex(x, z))] = 1;
         }
       }
     }
   }
 
-  auto &registry = BuildingCollisionRegistry::instance();
-  const auto &buildings = registry.getAllBuildings();
+  m_obstacles.assignLayer(ObstacleGrid::Layer::Terrain, blocked);
+}
 
-  for (const auto &building : buildings) {
-    auto cells = Game::Systems::BuildingCollisionRegistry::getOccupiedGridCells(
-        building, m_gridCellSize);
-    for (const auto &cell : cells) {
-      int const grid_x =
-          static_cast<int>(std::round(cell.first - m_gridOffsetX));
-      int const grid_z =
-          static_cast<int>(std::round(cell.second - m_gridOffsetZ));
+auto Pathfinding::footprintCells(const BuildingFootprint &footprint) const
+    -> ClusterBounds {
+  ClusterBounds cells = ClusterBounds::none();
+  auto const occupied =
+      BuildingCollisionRegistry::getOccupiedGridCells(footprint,
+                                                      m_gridCellSize);
+  for (const auto &cell : occupied) {
+    int const grid_x = static_cast<int>(std::round(cell.first - m_gridOffsetX));
+    int const grid_z =
+        static_cast<int>(std::round(cell.second - m_gridOffsetZ));
+    if (cells.empty()) {
+      cells = {grid_x, grid_z, grid_x, grid_z};
+      continue;
+    }
+    cells.min_x = std::min(cells.min_x, grid_x);
+    cells.min_y = std::min(cells.min_y, grid_z);
+    cells.max_x = std::max(cells.max_x, grid_x);
+    cells.max_y = std::max(cells.max_y, grid_z);
+  }
+  return cells;
+}
 
-      if (grid_x >= 0 && grid_x < m_width && grid_z >= 0 && grid_z < m_height) {
-        m_obstacles[grid_z][grid_x] = static_cast<std::uint8_t>(1);
-      }
+void Pathfinding::updateBuildingLayer() {
+  std::unordered_map<unsigned int, ClusterBounds> current;
+  for (const auto &building :
+       BuildingCollisionRegistry::instance().getAllBuildings()) {
+    ClusterBounds const cells = footprintCells(building);
+    if (!cells.empty()) {
+      current.emplace(building.entity_id, cells);
     }
   }
 
-  m_obstaclesDirty.store(false, std::memory_order_release);
+  // Buildings that appeared, vanished or moved touch their old and new
+  // rectangles; nothing else in the layer needs rewriting.
+  std::vector<ClusterBounds> touched;
+  for (const auto &[entity_id, cells] : m_buildingCells) {
+    auto it = current.find(entity_id);
+    if (it == current.end() || !(it->second == cells)) {
+      touched.push_back(cells);
+    }
+  }
+  for (const auto &[entity_id, cells] : current) {
+    auto it = m_buildingCells.find(entity_id);
+    if (it == m_buildingCells.end() || !(it->second == cells)) {
+      touched.push_back(cells);
+    }
+  }
+  m_buildingCells = std::move(current);
+  if (touched.empty()) {
+    return;
+  }
+
+  // Footprints may overlap, so every rectangle is redrawn from all of the
+  // buildings rather than just cleared or filled.
+  std::vector<ClusterBounds> footprints;
+  footprints.reserve(m_buildingCells.size());
+  for (const auto &entry : m_buildingCells) {
+    footprints.push_back(entry.second);
+  }
+  for (const auto &area : touched) {
+    m_obstacles.assignRect(ObstacleGrid::Layer::Buildings, area, footprints);
+  }
 }
 
-auto Pathfinding::findPath(const Point &start,
-                           const Point &end) -> std::vector<Point> {
+void Pathfinding::publishSnapshot() {
+  auto grid = std::make_shared<ObstacleSnapshot>();
+  grid->width = m_width;
+  grid->height = m_height;
+  grid->version = m_obstacles.version();
+  auto const dirty = m_obstacles.takeDirtyRegions();
+
+  // The new snapshot shares every chunk of cells and every cluster the
+  // dirty regions miss with the previous one; only the chunks they touch
+  // are read again and only the clusters around them are rebuilt.
+  auto const previous = m_snapshot.load(std::memory_order_acquire);
+  if (previous && previous->clusters) {
+    grid->blocked = BlockedCells(previous->blocked, m_obstacles, dirty);
+    auto const changed = previous->clusters->changedClusters(dirty);
+    if (changed.empty()) {
+      grid->clusters = previous->clusters;
+    } else {
+      auto clusters = std::make_shared<PathClusterGraph>(*previous->clusters);
+      clusters->update(grid->blocked, changed);
+      grid->clusters = std::move(clusters);
+    }
+  } else {
+    grid->blocked = BlockedCells(m_obstacles);
+    auto clusters = std::make_shared<PathClusterGraph>(m_width, m_height);
+    clusters->rebuild(grid->blocked);
+    grid->clusters = std::move(clusters);
+  }
+
+  if (previous && previous->regions && previous->version == grid->version) {
+    grid->regions = previous->regions;
+  } else if (previous && previous->regions) {
+    auto regions = std::make_shared<WalkableRegions>(*previous->regions);
+    regions->update(grid->blocked, dirty);
+    grid->regions = std::move(regions);
+  } else {
+    auto regions = std::make_shared<WalkableRegions>(m_width, m_height);
+    regions->build(grid->blocked);
+    grid->regions = std::move(regions);
+  }
+
+  if (m_searchMode.load(std::memory_order_acquire) == SearchMode::JumpPoint) {
+    if (previous && previous->jumps && previous->version == grid->version) {
+      grid->jumps = previous->jumps;
+    } else if (previous && previous->jumps) {
+      auto jumps = std::make_shared<JumpPointTable>(*previous->jumps);
+      jumps->update(grid->blocked, dirty);
+      grid->jumps = std::move(jumps);
+    } else {
+      auto jumps = std::make_shared<JumpPointTable>(m_width, m_height);
+      jumps->build(grid->blocked);
+      grid->jumps = std::move(jumps);
+    }
+  }
+
+  m_snapshot.store(std::move(grid), std::memory_order_release);
+  m_snapshotStale.store(false, std::memory_order_release);
+}
 
+auto Pathfinding::acquireSnapshot()
+    -> std::shared_ptr<const ObstacleSnapshot> {
   if (m_obstaclesDirty.load(std::memory_order_acquire)) {
     updateBuildingObstacles();
   }
+  if (m_snapshotStale.load(std::memory_order_acquire)) {
+    std::lock_guard<std::mutex> const lock(m_mutex);
+    if (m_snapshotStale.load(std::memory_order_acquire)) {
+      publishSnapshot();
+    }
+  }
+  return m_snapshot.load(std::memory_order_acquire);
+}
 
-  std::lock_guard<std::mutex> const lock(m_mutex);
-  return findPathInternal(start, end);
+auto Pathfinding::currentSnapshot() const
+    -> std::shared_ptr<const ObstacleSnapshot> {
+  // Pending obstacle changes would publish a newer version, so nothing
+  // keyed by the current one may be reused until they land.
+  if (m_obstaclesDirty.load(std::memory_order_acquire) ||
+      m_snapshotStale.load(std::memory_order_acquire)) {
+    return nullptr;
+  }
+  return m_snapshot.load(std::memory_order_acquire);
+}
+
+auto Pathfinding::findPath(const Point &start,
+                           const Point &end) -> std::vector<Point> {
+  auto const grid = acquireSnapshot();
+  std::lock_guard<std::mutex> const lock(m_syncSearchMutex);
+  return findPathInternal(start, end, *grid, m_syncBuffers);
+}
+
+auto Pathfinding::lastSearchExpansions() -> std::size_t {
+  std::lock_guard<std::mutex> const lock(m_syncSearchMutex);
+  return m_syncBuffers.expandedNodes;
 }
 
 auto Pathfinding::findPathAsync(const Point &start, const Point &end)
@@ -134,14 +329,279 @@ auto Pathfinding::findPathAsync(const Point &start, const Point &end)
 }
 
 void Pathfinding::submitPathRequest(std::uint64_t request_id,
-                                    const Point &start, const Point &end) {
+                                    const Point &start, const Point &end,
+                                    PathPriority priority) {
+  bool const cacheable = inGrid(start) && inGrid(end);
+  if (cacheable) {
+    if (auto const grid = currentSnapshot()) {
+      if (auto cached =
+              m_pathCache->find(toIndex(start), toIndex(end), grid->version)) {
+        m_cacheHits.fetch_add(1, std::memory_order_relaxed);
+        std::lock_guard<std::mutex> const lock(m_resultMutex);
+        m_resultQueue.push({request_id, *cached, nullptr});
+        return;
+      }
+    }
+  }
+
+  auto const lane = static_cast<std::size_t>(priority);
+  {
+    std::lock_guard<std::mutex> const lock(m_requestMutex);
+    if (cacheable) {
+      auto [it, inserted] = m_inFlight[lane].try_emplace(pairKey(start, end));
+      if (!inserted) {
+        it->second.push_back(request_id);
+        m_coalescedRequests.fetch_add(1, std::memory_order_relaxed);
+        return;
+      }
+    }
+    m_cacheMisses.fetch_add(1, std::memory_order_relaxed);
+    m_requestQueues[lane].push({request_id, start, end, false, priority});
+  }
+  m_requestCondition.notify_one();
+}
+
+auto Pathfinding::pathCacheStats() const -> PathCacheStats {
+  PathCacheStats stats;
+  stats.hits = m_cacheHits.load(std::memory_order_relaxed);
+  stats.misses = m_cacheMisses.load(std::memory_order_relaxed);
+  stats.coalesced = m_coalescedRequests.load(std::memory_order_relaxed);
+  stats.entries = m_pathCache->size();
+  return stats;
+}
+
+void Pathfinding::completePathRequest(const PathRequest &request,
+                                      const ObstacleSnapshot &grid,
+                                      std::vector<Point> path) {
+  path = smoothPath(path, grid);
+  std::vector<std::uint64_t> waiting;
+  if (inGrid(request.start) && inGrid(request.end)) {
+    m_pathCache->insert(toIndex(request.start), toIndex(request.end),
+                        grid.version,
+                        std::make_shared<const std::vector<Point>>(path));
+
+    std::lock_guard<std::mutex> const lock(m_requestMutex);
+    auto &in_flight = m_inFlight[static_cast<std::size_t>(request.priority)];
+    auto it = in_flight.find(pairKey(request.start, request.end));
+    if (it != in_flight.end()) {
+      waiting = std::move(it->second);
+      in_flight.erase(it);
+    }
+  }
+
+  std::lock_guard<std::mutex> const lock(m_resultMutex);
+  for (auto const request_id : waiting) {
+    m_resultQueue.push({request_id, path, nullptr});
+  }
+  m_resultQueue.push({request.request_id, std::move(path), nullptr});
+}
+
+void Pathfinding::publishPartialPath(const PathRequest &request,
+                                     const ObstacleSnapshot &grid,
+                                     const std::vector<Point> &raw_path) {
+  if (raw_path.size() < 2) {
+    return;
+  }
+  auto const path = smoothPath(raw_path, grid);
+
+  std::vector<std::uint64_t> waiting;
+  if (inGrid(request.start) && inGrid(request.end)) {
+    std::lock_guard<std::mutex> const lock(m_requestMutex);
+    auto &in_flight = m_inFlight[static_cast<std::size_t>(request.priority)];
+    auto it = in_flight.find(pairKey(request.start, request.end));
+    if (it != in_flight.end()) {
+      waiting = it->second;
+    }
+  }
+
+  std::lock_guard<std::mutex> const lock(m_resultMutex);
+  for (auto const request_id : waiting) {
+    m_resultQueue.push({request_id, path, nullptr, true});
+  }
+  m_resultQueue.push({request.request_id, path, nullptr, true});
+}
+
+void Pathfinding::runPathRequest(const PathRequest &request,
+                                 SearchBuffers &buffers) {
+  auto const grid = acquireSnapshot();
+  std::size_t const budget = m_sliceBudget.load(std::memory_order_acquire);
+
+  // Jump point searches expand few enough nodes to finish in one go.
+  Point goal;
+  if (budget == 0 || !resolveGoal(request.start, request.end, *grid, goal) ||
+      request.start == goal || usesJumpPoints(*grid)) {
+    completePathRequest(
+        request, *grid,
+        findPathInternal(request.start, request.end, *grid, buffers));
+    return;
+  }
+
+  auto slice = std::make_shared<SearchSlice>();
+  slice->buffers = std::move(buffers);
+  beginSearchSlice(*slice, grid, request.start, goal);
+
+  if (stepSearchSlice(*slice, budget)) {
+    auto path = searchSlicePath(*slice, false);
+    buffers = std::move(slice->buffers);
+    completePathRequest(request, *grid, std::move(path));
+    return;
+  }
+
+  auto const partial = searchSlicePath(*slice, true);
+  slice->partial_published = partial.size() >= 2;
+  publishPartialPath(request, *grid, partial);
+
+  // The suspended search takes these buffers along; the worker continues
+  // with spare ones.
   {
     std::lock_guard<std::mutex> const lock(m_requestMutex);
-    m_requestQueue.push({request_id, start, end});
+    if (m_spareBuffers.empty()) {
+      buffers = SearchBuffers{};
+    } else {
+      buffers = std::move(m_spareBuffers.back());
+      m_spareBuffers.pop_back();
+    }
+  }
+  PathRequest suspended = request;
+  suspended.slice = std::move(slice);
+  suspendPathRequest(std::move(suspended));
+}
+
+void Pathfinding::resumePathRequest(PathRequest request) {
+  SearchSlice &slice = *request.slice;
+  std::size_t budget = m_sliceBudget.load(std::memory_order_acquire);
+
+  // The cells a suspended search has expanded may have changed since it
+  // began, so it starts over on the current obstacles rather than finish
+  // on a stale snapshot.
+  auto const grid = acquireSnapshot();
+  if (grid->version != slice.grid->version) {
+    Point goal;
+    if (!resolveGoal(request.start, request.end, *grid, goal) ||
+        request.start == goal || usesJumpPoints(*grid)) {
+      slice.grid = grid;
+      auto path =
+          findPathInternal(request.start, request.end, *grid, slice.buffers);
+      finishPathRequest(std::move(request), std::move(path));
+      return;
+    }
+    beginSearchSlice(slice, grid, request.start, goal);
+    if (++slice.restarts > kMaxSliceRestarts) {
+      budget = 0;
+    }
+  }
+
+  if (!stepSearchSlice(slice, budget)) {
+    // A hierarchical search has no partial path until its first abstract
+    // steps are refined.
+    if (!slice.partial_published) {
+      auto const partial = searchSlicePath(slice, true);
+      slice.partial_published = partial.size() >= 2;
+      publishPartialPath(request, *slice.grid, partial);
+    }
+    suspendPathRequest(std::move(request));
+    return;
+  }
+
+  auto path = searchSlicePath(slice, false);
+  finishPathRequest(std::move(request), std::move(path));
+}
+
+void Pathfinding::finishPathRequest(PathRequest request,
+                                    std::vector<Point> path) {
+  SearchSlice &slice = *request.slice;
+  auto const grid = std::move(slice.grid);
+  {
+    std::lock_guard<std::mutex> const lock(m_requestMutex);
+    if (m_spareBuffers.size() < kMaxSpareBuffers) {
+      m_spareBuffers.push_back(std::move(slice.buffers));
+    }
+  }
+  request.slice.reset();
+  completePathRequest(request, *grid, std::move(path));
+}
+
+void Pathfinding::beginSearchSlice(
+    SearchSlice &slice, std::shared_ptr<const ObstacleSnapshot> grid,
+    const Point &start, const Point &goal) const {
+  slice.buffers.ensure(grid->width, grid->height);
+  slice.buffers.expandedNodes = 0;
+  slice.hierarchical = usesClusters(start, goal, *grid);
+  if (slice.hierarchical) {
+    slice.hierarchy =
+        beginHierarchicalSearch(start, goal, *grid, slice.buffers);
+  } else {
+    ClusterBounds const whole{0, 0, m_width - 1, m_height - 1};
+    slice.search = beginGridSearch(start, goal, whole, slice.buffers);
+  }
+  slice.grid = std::move(grid);
+}
+
+auto Pathfinding::stepSearchSlice(SearchSlice &slice,
+                                  std::size_t budget) const -> bool {
+  if (slice.hierarchical) {
+    return stepHierarchicalSearch(slice.hierarchy, *slice.grid, slice.buffers,
+                                  budget);
+  }
+  return stepGridSearch(slice.search, *slice.grid, slice.buffers, budget);
+}
+
+auto Pathfinding::searchSlicePath(const SearchSlice &slice,
+                                  bool best_so_far) const
+    -> std::vector<Point> {
+  if (slice.hierarchical) {
+    // Until it finishes, the refined prefix of the abstract path.
+    return slice.hierarchy.path;
+  }
+  return gridSearchPath(slice.search, slice.buffers, best_so_far);
+}
+
+void Pathfinding::suspendPathRequest(PathRequest request) {
+  {
+    std::lock_guard<std::mutex> const lock(m_requestMutex);
+    m_requestQueues[static_cast<std::size_t>(request.priority)].push(
+        std::move(request));
   }
   m_requestCondition.notify_one();
 }
 
+auto Pathfinding::findFlowField(const Point &goal)
+    -> std::shared_ptr<const FlowField> {
+  auto const grid = currentSnapshot();
+  if (!grid || !grid->isWalkable(goal.x, goal.y)) {
+    return nullptr;
+  }
+  return m_flowFields->find(toIndex(goal), grid->version);
+}
+
+void Pathfinding::submitFlowFieldRequest(std::uint64_t request_id,
+                                         const Point &goal,
+                                         PathPriority priority) {
+  {
+    std::lock_guard<std::mutex> const lock(m_requestMutex);
+    m_requestQueues[static_cast<std::size_t>(priority)].push(
+        {request_id, goal, goal, true, priority});
+  }
+  m_requestCondition.notify_one();
+}
+
+auto Pathfinding::acquireFlowField(const Point &goal,
+                                   const ObstacleSnapshot &grid)
+    -> std::shared_ptr<const FlowField> {
+  if (!grid.isWalkable(goal.x, goal.y)) {
+    return nullptr;
+  }
+  int const goal_cell = toIndex(goal);
+  if (auto cached = m_flowFields->find(goal_cell, grid.version)) {
+    return cached;
+  }
+  auto field =
+      std::make_shared<FlowField>(goal, grid.width, grid.height, grid.version);
+  field->build(grid.blocked);
+  m_flowFields->insert(goal_cell, field);
+  return field;
+}
+
 auto Pathfinding::fetchCompletedPaths()
     -> std::vector<Pathfinding::PathResult> {
   std::vector<PathResult> results;
@@ -153,91 +613,480 @@ auto Pathfinding::fetchCompletedPaths()
   return results;
 }
 
-auto Pathfinding::findPathInternal(const Point &start,
-                                   const Point &end) -> std::vector<Point> {
-  ensureWorkingBuffers();
+auto Pathfinding::findPathInternal(
+    const Point &start, const Point &end, const ObstacleSnapshot &grid,
+    SearchBuffers &buffers) const -> std::vector<Point> {
+  buffers.ensure(grid.width, grid.height);
+  buffers.expandedNodes = 0;
 
-  if (!isWalkable(start.x, start.y) || !isWalkable(end.x, end.y)) {
+  Point goal;
+  if (!resolveGoal(start, end, grid, goal)) {
     return {};
   }
 
+  if (start == goal) {
+    return {start};
+  }
+
+  if (usesJumpPoints(grid)) {
+    return findJumpPointPath(start, goal, grid, buffers);
+  }
+
+  if (usesClusters(start, goal, grid)) {
+    return findHierarchicalPath(start, goal, grid, buffers);
+  }
+
+  ClusterBounds const whole{0, 0, m_width - 1, m_height - 1};
+  return searchGrid(start, goal, whole, grid, buffers);
+}
+
+auto Pathfinding::resolveGoal(const Point &start, const Point &end,
+                              const ObstacleSnapshot &grid,
+                              Point &goal) const -> bool {
+  if (!grid.isWalkable(start.x, start.y)) {
+    return false;
+  }
+
+  goal = end;
+  if (grid.regions && !grid.regions->connected(start, end)) {
+    int const radius = m_goalRedirectRadius.load(std::memory_order_acquire);
+    goal = radius > 0 ? grid.regions->nearestInRegion(
+                            end, grid.regions->label(start), radius)
+                      : Point{-1, -1};
+  }
+  return grid.isWalkable(goal.x, goal.y);
+}
+
+auto Pathfinding::usesJumpPoints(const ObstacleSnapshot &grid) const -> bool {
+  return grid.jumps &&
+         m_searchMode.load(std::memory_order_acquire) == SearchMode::JumpPoint;
+}
+
+auto Pathfinding::usesClusters(const Point &start, const Point &goal,
+                               const ObstacleSnapshot &grid) -> bool {
+  return grid.clusters &&
+         std::max(std::abs(start.x - goal.x), std::abs(start.y - goal.y)) >
+             PathClusterGraph::kClusterSize;
+}
+
+auto Pathfinding::findHierarchicalPath(
+    const Point &start, const Point &end, const ObstacleSnapshot &grid,
+    SearchBuffers &buffers) const -> std::vector<Point> {
+  HierarchicalSearch search =
+      beginHierarchicalSearch(start, end, grid, buffers);
+  stepHierarchicalSearch(search, grid, buffers, 0);
+  return std::move(search.path);
+}
+
+auto Pathfinding::beginHierarchicalSearch(
+    const Point &start, const Point &end, const ObstacleSnapshot &grid,
+    SearchBuffers &buffers) const -> HierarchicalSearch {
+  const PathClusterGraph &clusters = *grid.clusters;
   const int start_idx = toIndex(start);
   const int end_idx = toIndex(end);
+  const int start_cluster = clusters.clusterOfCell(start_idx);
+  const int end_cluster = clusters.clusterOfCell(end_idx);
+
+  HierarchicalSearch search;
+  search.start = start;
+  search.end = end;
+  search.start_targets = clusters.entrances(start_cluster);
+  if (start_cluster == end_cluster) {
+    search.start_targets.push_back(end_idx);
+  }
+  clusters.distancesFrom(grid.blocked, start_idx, search.start_targets,
+                         search.start_dists);
+  clusters.distancesFrom(grid.blocked, end_idx,
+                         clusters.entrances(end_cluster), search.end_dists);
+
+  search.generation = buffers.nextGeneration();
+  buffers.openHeap.clear();
+  buffers.setNode(start_idx, search.generation, 0, start_idx);
+  buffers.pushOpenNode({start_idx, calculateHeuristic(start, end), 0});
+  return search;
+}
 
-  if (start_idx == end_idx) {
-    return {start};
+auto Pathfinding::stepHierarchicalSearch(HierarchicalSearch &search,
+                                         const ObstacleSnapshot &grid,
+                                         SearchBuffers &buffers,
+                                         std::size_t budget) const -> bool {
+  const PathClusterGraph &clusters = *grid.clusters;
+  const Point &end = search.end;
+  const int start_idx = toIndex(search.start);
+  const int end_idx = toIndex(end);
+  const int end_cluster = clusters.clusterOfCell(end_idx);
+  const std::uint32_t generation = search.generation;
+  std::size_t const expanded_before = buffers.expandedNodes;
+  auto out_of_budget = [&]() {
+    return budget > 0 && buffers.expandedNodes - expanded_before >= budget;
+  };
+  auto fail = [&]() {
+    search.path.clear();
+    search.finished = true;
+    return true;
+  };
+
+  auto relax = [&](const QueueNode &from, int to, int step) {
+    if (step == PathClusterGraph::kUnreachable ||
+        buffers.isClosed(to, generation)) {
+      return;
+    }
+    const int cost = from.gCost + step;
+    if (cost >= buffers.getGCost(to, generation)) {
+      return;
+    }
+    buffers.setNode(to, generation, cost, from.index);
+    buffers.pushOpenNode(
+        {to, cost + calculateHeuristic(toPoint(to), end), cost});
+  };
+
+  constexpr std::array<Point, 4> k_crossings{Point{1, 0}, Point{-1, 0},
+                                             Point{0, 1}, Point{0, -1}};
+  while (!search.abstract_done) {
+    if (buffers.openHeap.empty()) {
+      return fail();
+    }
+    if (out_of_budget()) {
+      return false;
+    }
+    QueueNode const current = buffers.popOpenNode();
+    if (current.gCost > buffers.getGCost(current.index, generation) ||
+        buffers.isClosed(current.index, generation)) {
+      continue;
+    }
+    buffers.setClosed(current.index, generation);
+    ++buffers.expandedNodes;
+
+    if (current.index == end_idx) {
+      buildPath(start_idx, end_idx, generation, 0, buffers, search.waypoints);
+      if (search.waypoints.empty()) {
+        return fail();
+      }
+      search.abstract_done = true;
+      search.path.reserve(static_cast<std::size_t>(
+          buffers.getGCost(end_idx, generation) + 1));
+      search.path.push_back(search.start);
+      search.refined = 1;
+      break;
+    }
+
+    const int cluster = clusters.clusterOfCell(current.index);
+    const auto &entrances = clusters.entrances(cluster);
+    if (current.index == start_idx) {
+      for (std::size_t i = 0; i < search.start_targets.size(); ++i) {
+        relax(current, search.start_targets[i], search.start_dists[i]);
+      }
+    } else if (int const entrance =
+                   clusters.findEntrance(cluster, current.index);
+               entrance >= 0) {
+      for (std::size_t i = 0; i < entrances.size(); ++i) {
+        relax(current, entrances[i],
+              clusters.distance(cluster, entrance, static_cast<int>(i)));
+      }
+      if (cluster == end_cluster) {
+        relax(current, end_idx,
+              search.end_dists[static_cast<std::size_t>(entrance)]);
+      }
+    }
+
+    const Point point = toPoint(current.index);
+    for (const Point &step : k_crossings) {
+      const Point next{point.x + step.x, point.y + step.y};
+      if (!grid.isWalkable(next.x, next.y)) {
+        continue;
+      }
+      const int next_cluster = clusters.clusterOf(next.x, next.y);
+      const int next_idx = toIndex(next);
+      if (next_cluster != cluster &&
+          clusters.findEntrance(next_cluster, next_idx) >= 0) {
+        relax(current, next_idx, 1);
+      }
+    }
   }
 
-  const std::uint32_t generation = nextGeneration();
+  // Each abstract step is refined whole; a slice only yields between them.
+  while (search.refined < search.waypoints.size()) {
+    if (out_of_budget()) {
+      return false;
+    }
+    const Point &from = search.waypoints[search.refined - 1];
+    const Point &to = search.waypoints[search.refined];
+    ++search.refined;
+    const int cluster = clusters.clusterOf(from.x, from.y);
+    if (cluster != clusters.clusterOf(to.x, to.y)) {
+      search.path.push_back(to);
+      continue;
+    }
+    auto const segment =
+        searchGrid(from, to, clusters.bounds(cluster), grid, buffers);
+    if (segment.empty()) {
+      return fail();
+    }
+    search.path.insert(search.path.end(), segment.begin() + 1, segment.end());
+  }
+  search.finished = true;
+  return true;
+}
 
-  m_openHeap.clear();
+auto Pathfinding::findJumpPointPath(
+    const Point &start, const Point &end, const ObstacleSnapshot &grid,
+    SearchBuffers &buffers) const -> std::vector<Point> {
+  const JumpPointTable &jumps = *grid.jumps;
+  const int start_idx = toIndex(start);
+  const int end_idx = toIndex(end);
+  auto sign = [](int value) { return (value > 0) - (value < 0); };
+
+  const std::uint32_t generation = buffers.nextGeneration();
+  buffers.openHeap.clear();
+  buffers.setNode(start_idx, generation, 0, start_idx);
+  buffers.pushOpenNode({start_idx, calculateHeuristic(start, end), 0});
+
+  std::array<int, 8> directions{};
+  bool found = false;
+  while (!buffers.openHeap.empty()) {
+    QueueNode const current = buffers.popOpenNode();
+    if (current.gCost > buffers.getGCost(current.index, generation) ||
+        buffers.isClosed(current.index, generation)) {
+      continue;
+    }
+    buffers.setClosed(current.index, generation);
+    ++buffers.expandedNodes;
 
-  setGCost(start_idx, generation, 0);
-  setParent(start_idx, generation, start_idx);
+    if (current.index == end_idx) {
+      found = true;
+      break;
+    }
 
-  pushOpenNode({start_idx, calculateHeuristic(start, end), 0});
+    // Prune to the canonical successors for the direction of arrival.
+    const Point point = toPoint(current.index);
+    const Point parent = toPoint(buffers.getParent(current.index, generation));
+    int const dx = sign(point.x - parent.x);
+    int const dy = sign(point.y - parent.y);
+    std::size_t count = 0;
+    if (dx == 0 && dy == 0) {
+      for (int d = 0; d < 8; ++d) {
+        directions[count++] = d;
+      }
+    } else if (dx != 0 && dy != 0) {
+      directions[count++] = JumpPointTable::directionIndex(dx, 0);
+      directions[count++] = JumpPointTable::directionIndex(0, dy);
+      directions[count++] = JumpPointTable::directionIndex(dx, dy);
+    } else {
+      // Without corner cutting, the sides of a straight move are only
+      // reachable through this node.
+      int const side_x = dy != 0 ? 1 : 0;
+      int const side_y = dx != 0 ? 1 : 0;
+      directions[count++] = JumpPointTable::directionIndex(dx, dy);
+      directions[count++] = JumpPointTable::directionIndex(side_x, side_y);
+      directions[count++] = JumpPointTable::directionIndex(-side_x, -side_y);
+      directions[count++] =
+          JumpPointTable::directionIndex(dx + side_x, dy + side_y);
+      directions[count++] =
+          JumpPointTable::directionIndex(dx - side_x, dy - side_y);
+    }
 
-  const int max_iterations = std::max(m_width * m_height, 1);
-  int iterations = 0;
+    int const to_x = end.x - point.x;
+    int const to_y = end.y - point.y;
+    for (std::size_t i = 0; i < count; ++i) {
+      int const direction = directions[i];
+      const Point &step =
+          JumpPointTable::kDirections[static_cast<std::size_t>(direction)];
+      int const dist = jumps.distance(point.x, point.y, direction);
+      int const open_steps = dist > 0 ? dist : -dist;
+
+      // Stop early where the goal lies on this line, or where a straight
+      // jump from the diagonal could reach it.
+      int travel = 0;
+      if (step.x != 0 && step.y != 0) {
+        if (sign(to_x) == step.x && sign(to_y) == step.y) {
+          int const k = std::min(std::abs(to_x), std::abs(to_y));
+          if (k <= open_steps) {
+            travel = k;
+          }
+        }
+      } else if (step.x != 0) {
+        if (to_y == 0 && sign(to_x) == step.x &&
+            std::abs(to_x) <= open_steps) {
+          travel = std::abs(to_x);
+        }
+      } else if (to_x == 0 && sign(to_y) == step.y &&
+                 std::abs(to_y) <= open_steps) {
+        travel = std::abs(to_y);
+      }
+      if (travel == 0 && dist > 0) {
+        travel = dist;
+      }
+      if (travel == 0) {
+        continue;
+      }
+
+      const Point next{point.x + step.x * travel, point.y + step.y * travel};
+      const int next_idx = toIndex(next);
+      if (buffers.isClosed(next_idx, generation)) {
+        continue;
+      }
+      const int cost = current.gCost + travel;
+      if (cost >= buffers.getGCost(next_idx, generation)) {
+        continue;
+      }
+      buffers.setNode(next_idx, generation, cost, current.index);
+      buffers.pushOpenNode(
+          {next_idx, cost + calculateHeuristic(next, end), cost});
+    }
+  }
+
+  if (!found) {
+    return {};
+  }
+
+  std::vector<Point> jump_points;
+  buildPath(start_idx, end_idx, generation, 0, buffers, jump_points);
+  if (jump_points.empty()) {
+    return {};
+  }
+
+  std::vector<Point> path;
+  path.reserve(static_cast<std::size_t>(
+      buffers.getGCost(end_idx, generation) + 1));
+  path.push_back(start);
+  for (std::size_t i = 1; i < jump_points.size(); ++i) {
+    Point cell = jump_points[i - 1];
+    const Point &target = jump_points[i];
+    int const step_x = sign(target.x - cell.x);
+    int const step_y = sign(target.y - cell.y);
+    while (!(cell == target)) {
+      cell = {cell.x + step_x, cell.y + step_y};
+      path.push_back(cell);
+    }
+  }
+  return path;
+}
+
+auto Pathfinding::searchGrid(const Point &start, const Point &end,
+                             const ClusterBounds &area,
+                             const ObstacleSnapshot &grid,
+                             SearchBuffers &buffers) const
+    -> std::vector<Point> {
+  GridSearch search = beginGridSearch(start, end, area, buffers);
+  stepGridSearch(search, grid, buffers, 0);
+  return gridSearchPath(search, buffers, false);
+}
 
-  int final_cost = -1;
+auto Pathfinding::beginGridSearch(const Point &start, const Point &end,
+                                  const ClusterBounds &area,
+                                  SearchBuffers &buffers) const -> GridSearch {
+  GridSearch search;
+  search.start = start;
+  search.end = end;
+  search.area = area;
+  search.generation = buffers.nextGeneration();
+  search.max_iterations = std::max(area.width() * area.height(), 1);
 
-  while (!m_openHeap.empty() && iterations < max_iterations) {
-    ++iterations;
+  const int start_idx = toIndex(start);
+  search.best_index = start_idx;
+  search.best_heuristic = calculateHeuristic(start, end);
+
+  buffers.openHeap.clear();
 
-    QueueNode const current = popOpenNode();
+  buffers.setNode(start_idx, search.generation, 0, start_idx);
 
-    if (current.gCost > getGCost(current.index, generation)) {
+  buffers.pushOpenNode({start_idx, search.best_heuristic, 0});
+  return search;
+}
+
+auto Pathfinding::stepGridSearch(GridSearch &search,
+                                 const ObstacleSnapshot &grid,
+                                 SearchBuffers &buffers,
+                                 std::size_t budget) const -> bool {
+  const int end_idx = toIndex(search.end);
+  const std::uint32_t generation = search.generation;
+  std::size_t expanded = 0;
+
+  while (!buffers.openHeap.empty() &&
+         search.iterations < search.max_iterations) {
+    if (budget > 0 && expanded >= budget) {
+      return false;
+    }
+
+    QueueNode const current = buffers.popOpenNode();
+
+    if (current.gCost > buffers.getGCost(current.index, generation)) {
       continue;
     }
 
-    if (isClosed(current.index, generation)) {
+    if (buffers.isClosed(current.index, generation)) {
       continue;
     }
 
-    setClosed(current.index, generation);
+    // Count expansions, not pops: stale heap entries would otherwise eat
+    // the budget of the small per-cluster searches.
+    ++search.iterations;
+    ++expanded;
+    ++buffers.expandedNodes;
+    buffers.setClosed(current.index, generation);
 
     if (current.index == end_idx) {
-      final_cost = current.gCost;
+      search.final_cost = current.gCost;
       break;
     }
 
     const Point current_point = toPoint(current.index);
+    const int heuristic = current.fCost - current.gCost;
+    if (heuristic < search.best_heuristic) {
+      search.best_heuristic = heuristic;
+      search.best_index = current.index;
+    }
+
     std::array<Point, 8> neighbors{};
     const std::size_t neighbor_count =
-        collectNeighbors(current_point, neighbors);
+        collectNeighbors(current_point, grid, neighbors);
 
     for (std::size_t i = 0; i < neighbor_count; ++i) {
       const Point &neighbor = neighbors[i];
-      if (!isWalkable(neighbor.x, neighbor.y)) {
+      if (!search.area.contains(neighbor.x, neighbor.y) ||
+          !grid.isWalkable(neighbor.x, neighbor.y)) {
         continue;
       }
 
       const int neighbor_idx = toIndex(neighbor);
-      if (isClosed(neighbor_idx, generation)) {
+      if (buffers.isClosed(neighbor_idx, generation)) {
         continue;
       }
 
       const int tentative_gcost = current.gCost + 1;
-      if (tentative_gcost >= getGCost(neighbor_idx, generation)) {
+      if (tentative_gcost >= buffers.getGCost(neighbor_idx, generation)) {
         continue;
       }
 
-      setGCost(neighbor_idx, generation, tentative_gcost);
-      setParent(neighbor_idx, generation, current.index);
+      buffers.setNode(neighbor_idx, generation, tentative_gcost, current.index);
 
-      const int h_cost = calculateHeuristic(neighbor, end);
-      pushOpenNode({neighbor_idx, tentative_gcost + h_cost, tentative_gcost});
+      const int h_cost = calculateHeuristic(neighbor, search.end);
+      buffers.pushOpenNode(
+          {neighbor_idx, tentative_gcost + h_cost, tentative_gcost});
     }
   }
 
-  if (final_cost < 0) {
+  search.finished = true;
+  return true;
+}
+
+auto Pathfinding::gridSearchPath(const GridSearch &search,
+                                 const SearchBuffers &buffers,
+                                 bool best_so_far) const
+    -> std::vector<Point> {
+  int end_idx = toIndex(search.end);
+  int cost = search.final_cost;
+  if (best_so_far && cost < 0) {
+    end_idx = search.best_index;
+    cost = buffers.getGCost(end_idx, search.generation);
+  }
+  if (cost < 0) {
     return {};
   }
 
   std::vector<Point> path;
-  path.reserve(final_cost + 1);
-  buildPath(start_idx, end_idx, generation, final_cost + 1, path);
+  buildPath(toIndex(search.start), end_idx, search.generation, cost + 1,
+            buffers, path);
   return path;
 }
 
@@ -245,102 +1094,217 @@ auto Pathfinding::calculateHeuristic(const Point &a, const Point &b) -> int {
   return std::abs(a.x - b.x) + std::abs(a.y - b.y);
 }
 
-void Pathfinding::ensureWorkingBuffers() {
-  const std::size_t total_cells =
-      static_cast<std::size_t>(m_width) * static_cast<std::size_t>(m_height);
+auto Pathfinding::hasLineOfSight(const Point &from, const Point &to,
+                                 const ObstacleSnapshot &grid) -> bool {
+  int const nx = std::abs(to.x - from.x);
+  int const ny = std::abs(to.y - from.y);
+  int const sx = to.x > from.x ? 1 : -1;
+  int const sy = to.y > from.y ? 1 : -1;
+
+  // Walks every cell the segment between the two centres touches. Through
+  // an exact corner both side cells must be open, as for a diagonal step.
+  Point cell = from;
+  int ix = 0;
+  int iy = 0;
+  while (ix < nx || iy < ny) {
+    int const decision = (1 + 2 * ix) * ny - (1 + 2 * iy) * nx;
+    if (decision == 0) {
+      if (!grid.isWalkable(cell.x + sx, cell.y) ||
+          !grid.isWalkable(cell.x, cell.y + sy)) {
+        return false;
+      }
+      cell.x += sx;
+      cell.y += sy;
+      ++ix;
+      ++iy;
+    } else if (decision < 0) {
+      cell.x += sx;
+      ++ix;
+    } else {
+      cell.y += sy;
+      ++iy;
+    }
+    if (!grid.isWalkable(cell.x, cell.y)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+auto Pathfinding::smoothPath(const std::vector<Point> &path,
+                             const ObstacleSnapshot &grid)
+    -> std::vector<Point> {
+  if (path.size() < 3) {
+    return path;
+  }
 
-  if (m_closedGeneration.size() != total_cells) {
-    m_closedGeneration.assign(total_cells, 0);
-    m_gCostGeneration.assign(total_cells, 0);
-    m_gCostValues.assign(total_cells, std::numeric_limits<int>::max());
-    m_parentGeneration.assign(total_cells, 0);
-    m_parentValues.assign(total_cells, -1);
+  std::vector<Point> smoothed;
+  smoothed.push_back(path.front());
+  std::size_t anchor = 0;
+  for (std::size_t i = 2; i < path.size(); ++i) {
+    if (!hasLineOfSight(path[anchor], path[i], grid)) {
+      anchor = i - 1;
+      smoothed.push_back(path[anchor]);
+    }
   }
+  smoothed.push_back(path.back());
+  return smoothed;
+}
 
-  const std::size_t min_open_capacity =
-      std::max<std::size_t>(total_cells / 8, 64);
-  if (m_openHeap.capacity() < min_open_capacity) {
-    m_openHeap.reserve(min_open_capacity);
+void Pathfinding::SearchBuffers::ensure(int grid_width, int grid_height) {
+  if (width != grid_width || height != grid_height) {
+    width = grid_width;
+    height = grid_height;
+    std::size_t const total_cells =
+        static_cast<std::size_t>(width) * static_cast<std::size_t>(height);
+    tiled = total_cells > kDenseCellLimit;
+    nodes.clear();
+    tiles.clear();
+    if (tiled) {
+      tilesX = (width + kTileSize - 1) >> kTileShift;
+      int const tiles_y = (height + kTileSize - 1) >> kTileShift;
+      tiles.resize(static_cast<std::size_t>(tilesX) *
+                   static_cast<std::size_t>(tiles_y));
+    } else {
+      nodes.assign(total_cells, SearchNode{});
+    }
+    generationCounter = 0;
+  }
+
+  const std::size_t min_open_capacity = std::min<std::size_t>(
+      std::max<std::size_t>(static_cast<std::size_t>(width) *
+                                static_cast<std::size_t>(height) / 8,
+                            64),
+      kDenseCellLimit / 8);
+  if (openHeap.capacity() < min_open_capacity) {
+    openHeap.reserve(min_open_capacity);
   }
 }
 
-auto Pathfinding::nextGeneration() -> std::uint32_t {
-  auto next = ++m_generationCounter;
-  if (next == 0) {
+auto Pathfinding::SearchBuffers::nextGeneration() -> std::uint32_t {
+  auto next = ++generationCounter;
+  if ((next & kClosedBit) != 0) {
     resetGenerations();
-    next = ++m_generationCounter;
+    next = ++generationCounter;
+  }
+  if (tiled && next % kTileIdleSearches == 0) {
+    releaseIdleTiles();
   }
   return next;
 }
 
-void Pathfinding::resetGenerations() {
-  std::fill(m_closedGeneration.begin(), m_closedGeneration.end(), 0);
-  std::fill(m_gCostGeneration.begin(), m_gCostGeneration.end(), 0);
-  std::fill(m_parentGeneration.begin(), m_parentGeneration.end(), 0);
-  std::fill(m_gCostValues.begin(), m_gCostValues.end(),
-            std::numeric_limits<int>::max());
-  std::fill(m_parentValues.begin(), m_parentValues.end(), -1);
-  m_generationCounter = 0;
+void Pathfinding::SearchBuffers::resetGenerations() {
+  std::fill(nodes.begin(), nodes.end(), SearchNode{});
+  for (auto &tile : tiles) {
+    tile.reset();
+  }
+  generationCounter = 0;
 }
 
-auto Pathfinding::isClosed(int index, std::uint32_t generation) const -> bool {
-  return index >= 0 &&
-         static_cast<std::size_t>(index) < m_closedGeneration.size() &&
-         m_closedGeneration[static_cast<std::size_t>(index)] == generation;
+void Pathfinding::SearchBuffers::releaseIdleTiles() {
+  for (auto &tile : tiles) {
+    if (tile && generationCounter - tile->lastGeneration > kTileIdleSearches) {
+      tile.reset();
+    }
+  }
 }
 
-void Pathfinding::setClosed(int index, std::uint32_t generation) {
-  if (index >= 0 &&
-      static_cast<std::size_t>(index) < m_closedGeneration.size()) {
-    m_closedGeneration[static_cast<std::size_t>(index)] = generation;
+auto Pathfinding::SearchBuffers::find(int index) const -> const SearchNode * {
+  if (index < 0 || index >= width * height) {
+    return nullptr;
+  }
+  if (!tiled) {
+    return &nodes[static_cast<std::size_t>(index)];
+  }
+  int const x = index % width;
+  int const y = index / width;
+  const auto &tile = tiles[static_cast<std::size_t>(
+      (y >> kTileShift) * tilesX + (x >> kTileShift))];
+  if (!tile) {
+    return nullptr;
   }
+  return &tile->nodes[static_cast<std::size_t>(
+      ((y & (kTileSize - 1)) << kTileShift) | (x & (kTileSize - 1)))];
 }
 
-auto Pathfinding::getGCost(int index, std::uint32_t generation) const -> int {
-  if (index < 0 ||
-      static_cast<std::size_t>(index) >= m_gCostGeneration.size()) {
-    return std::numeric_limits<int>::max();
+auto Pathfinding::SearchBuffers::touch(int index, std::uint32_t generation)
+    -> SearchNode * {
+  if (index < 0 || index >= width * height) {
+    return nullptr;
   }
-  if (m_gCostGeneration[static_cast<std::size_t>(index)] == generation) {
-    return m_gCostValues[static_cast<std::size_t>(index)];
+  SearchNode *node = nullptr;
+  if (tiled) {
+    int const x = index % width;
+    int const y = index / width;
+    auto &tile = tiles[static_cast<std::size_t>(
+        (y >> kTileShift) * tilesX + (x >> kTileShift))];
+    if (!tile) {
+      tile = std::make_unique<Tile>();
+    }
+    tile->lastGeneration = generation;
+    node = &tile->nodes[static_cast<std::size_t>(
+        ((y & (kTileSize - 1)) << kTileShift) | (x & (kTileSize - 1)))];
+  } else {
+    node = &nodes[static_cast<std::size_t>(index)];
   }
-  return std::numeric_limits<int>::max();
+  if ((node->generation & ~kClosedBit) != generation) {
+    *node = {generation, std::numeric_limits<int>::max(), -1};
+  }
+  return node;
+}
+
+auto Pathfinding::SearchBuffers::isClosed(int index,
+                                          std::uint32_t generation) const
+    -> bool {
+  const SearchNode *node = find(index);
+  return node != nullptr && node->generation == (generation | kClosedBit);
 }
 
-void Pathfinding::setGCost(int index, std::uint32_t generation, int cost) {
-  if (index >= 0 &&
-      static_cast<std::size_t>(index) < m_gCostGeneration.size()) {
-    const auto idx = static_cast<std::size_t>(index);
-    m_gCostGeneration[idx] = generation;
-    m_gCostValues[idx] = cost;
+void Pathfinding::SearchBuffers::setClosed(int index,
+                                           std::uint32_t generation) {
+  if (SearchNode *node = touch(index, generation)) {
+    node->generation = generation | kClosedBit;
   }
 }
 
-auto Pathfinding::hasParent(int index, std::uint32_t generation) const -> bool {
-  return index >= 0 &&
-         static_cast<std::size_t>(index) < m_parentGeneration.size() &&
-         m_parentGeneration[static_cast<std::size_t>(index)] == generation;
+auto Pathfinding::SearchBuffers::getGCost(int index,
+                                          std::uint32_t generation) const
+    -> int {
+  const SearchNode *node = find(index);
+  if (node != nullptr && (node->generation & ~kClosedBit) == generation) {
+    return node->gCost;
+  }
+  return std::numeric_limits<int>::max();
+}
+
+auto Pathfinding::SearchBuffers::hasParent(int index,
+                                           std::uint32_t generation) const
+    -> bool {
+  const SearchNode *node = find(index);
+  return node != nullptr && (node->generation & ~kClosedBit) == generation &&
+         node->parent >= 0;
 }
 
-auto Pathfinding::getParent(int index, std::uint32_t generation) const -> int {
+auto Pathfinding::SearchBuffers::getParent(int index,
+                                           std::uint32_t generation) const
+    -> int {
   if (hasParent(index, generation)) {
-    return m_parentValues[static_cast<std::size_t>(index)];
+    return find(index)->parent;
   }
   return -1;
 }
 
-void Pathfinding::setParent(int index, std::uint32_t generation,
-                            int parentIndex) {
-  if (index >= 0 &&
-      static_cast<std::size_t>(index) < m_parentGeneration.size()) {
-    const auto idx = static_cast<std::size_t>(index);
-    m_parentGeneration[idx] = generation;
-    m_parentValues[idx] = parentIndex;
+void Pathfinding::SearchBuffers::setNode(int index, std::uint32_t generation,
+                                         int cost, int parentIndex) {
+  if (SearchNode *node = touch(index, generation)) {
+    node->gCost = cost;
+    node->parent = parentIndex;
   }
 }
 
 auto Pathfinding::collectNeighbors(
-    const Point &point, std::array<Point, 8> &buffer) const -> std::size_t {
+    const Point &point, const ObstacleSnapshot &grid,
+    std::array<Point, 8> &buffer) const -> std::size_t {
   std::size_t count = 0;
   for (int dx = -1; dx <= 1; ++dx) {
     for (int dy = -1; dy <= 1; ++dy) {
@@ -356,8 +1320,8 @@ auto Pathfinding::collectNeighbors(
       }
 
       if (dx != 0 && dy != 0) {
-        if (!isWalkable(point.x + dx, point.y) ||
-            !isWalkable(point.x, point.y + dy)) {
+        if (!grid.isWalkable(point.x + dx, point.y) ||
+            !grid.isWalkable(point.x, point.y + dy)) {
           continue;
         }
       }
@@ -370,6 +1334,7 @@ auto Pathfinding::collectNeighbors(
 
 void Pathfinding::buildPath(int startIndex, int endIndex,
                             std::uint32_t generation, int expectedLength,
+                            const SearchBuffers &buffers,
                             std::vector<Point> &outPath) const {
   outPath.clear();
   if (expectedLength > 0) {
@@ -384,12 +1349,12 @@ void Pathfinding::buildPath(int startIndex, int endIndex,
       return;
     }
 
-    if (!hasParent(current, generation)) {
+    if (!buffers.hasParent(current, generation)) {
       outPath.clear();
       return;
     }
 
-    const int parent = getParent(current, generation);
+    const int parent = buffers.getParent(current, generation);
     if (parent == current || parent < 0) {
       outPath.clear();
       return;
@@ -407,42 +1372,42 @@ auto Pathfinding::heapLess(const QueueNode &lhs, const QueueNode &rhs) -> bool {
   return lhs.gCost < rhs.gCost;
 }
 
-void Pathfinding::pushOpenNode(const QueueNode &node) {
-  m_openHeap.push_back(node);
-  std::size_t index = m_openHeap.size() - 1;
+void Pathfinding::SearchBuffers::pushOpenNode(const QueueNode &node) {
+  openHeap.push_back(node);
+  std::size_t index = openHeap.size() - 1;
   while (index > 0) {
     std::size_t const parent = (index - 1) / 2;
-    if (heapLess(m_openHeap[parent], m_openHeap[index])) {
+    if (heapLess(openHeap[parent], openHeap[index])) {
       break;
     }
-    std::swap(m_openHeap[parent], m_openHeap[index]);
+    std::swap(openHeap[parent], openHeap[index]);
     index = parent;
   }
 }
 
-auto Pathfinding::popOpenNode() -> Pathfinding::QueueNode {
-  QueueNode top = m_openHeap.front();
-  QueueNode const last = m_openHeap.back();
-  m_openHeap.pop_back();
-  if (!m_openHeap.empty()) {
-    m_openHeap[0] = last;
+auto Pathfinding::SearchBuffers::popOpenNode() -> QueueNode {
+  QueueNode top = openHeap.front();
+  QueueNode const last = openHeap.back();
+  openHeap.pop_back();
+  if (!openHeap.empty()) {
+    openHeap[0] = last;
     std::size_t index = 0;
-    const std::size_t size = m_openHeap.size();
+    const std::size_t size = openHeap.size();
     while (true) {
       std::size_t const left = index * 2 + 1;
       std::size_t const right = left + 1;
       std::size_t smallest = index;
 
-      if (left < size && !heapLess(m_openHeap[smallest], m_openHeap[left])) {
+      if (left < size && !heapLess(openHeap[smallest], openHeap[left])) {
         smallest = left;
       }
-      if (right < size && !heapLess(m_openHeap[smallest], m_openHeap[right])) {
+      if (right < size && !heapLess(openHeap[smallest], openHeap[right])) {
         smallest = right;
       }
       if (smallest == index) {
         break;
       }
-      std::swap(m_openHeap[index], m_openHeap[smallest]);
+      std::swap(openHeap[index], openHeap[smallest]);
       index = smallest;
     }
   }
@@ -450,29 +1415,46 @@ auto Pathfinding::popOpenNode() -> Pathfinding::QueueNode {
 }
 
 void Pathfinding::workerLoop() {
+  Engine::Core::Profiler::instance().setThreadName("Pathfinding worker");
+  SearchBuffers buffers;
+  auto has_request = [this]() {
+    return std::any_of(m_requestQueues.begin(), m_requestQueues.end(),
+                       [](const auto &queue) { return !queue.empty(); });
+  };
+
   while (true) {
     PathRequest request;
     {
       std::unique_lock<std::mutex> lock(m_requestMutex);
-      m_requestCondition.wait(lock, [this]() {
-        return m_stopWorker.load(std::memory_order_acquire) ||
-               !m_requestQueue.empty();
+      m_requestCondition.wait(lock, [&]() {
+        return m_stopWorker.load(std::memory_order_acquire) || has_request();
       });
 
-      if (m_stopWorker.load(std::memory_order_acquire) &&
-          m_requestQueue.empty()) {
+      if (m_stopWorker.load(std::memory_order_acquire) && !has_request()) {
         break;
       }
 
-      request = m_requestQueue.front();
-      m_requestQueue.pop();
+      for (auto &queue : m_requestQueues) {
+        if (!queue.empty()) {
+          request = queue.front();
+          queue.pop();
+          break;
+        }
+      }
     }
 
-    auto path = findPath(request.start, request.end);
-
-    {
+    if (request.flow_field) {
+      Engine::Core::ProfileZone const zone("Pathfinding::flowField");
+      auto const grid = acquireSnapshot();
+      auto field = acquireFlowField(request.end, *grid);
       std::lock_guard<std::mutex> const lock(m_resultMutex);
-      m_resultQueue.push({request.request_id, std::move(path)});
+      m_resultQueue.push({request.request_id, {}, std::move(field)});
+    } else if (request.slice) {
+      Engine::Core::ProfileZone const zone("Pathfinding::resume");
+      resumePathRequest(std::move(request));
+    } else {
+      Engine::Core::ProfileZone const zone("Pathfinding::request");
+      runPathRequest(request, buffers);
     }
   }
 }
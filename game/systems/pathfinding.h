@@ -1,18 +1,30 @@
 #pragma once
 
+#include "blocked_cells.h"
+#include "obstacle_grid.h"
+#include "path_clusters.h"
 #include <array>
 #include <atomic>
 #include <condition_variable>
+#include <cstddef>
 #include <cstdint>
 #include <future>
+#include <memory>
 #include <mutex>
 #include <queue>
 #include <thread>
+#include <unordered_map>
 #include <vector>
 
 namespace Game::Systems {
 
 class BuildingCollisionRegistry;
+struct BuildingFootprint;
+class FlowField;
+class FlowFieldCache;
+class JumpPointTable;
+class PathCache;
+class WalkableRegions;
 
 struct Point {
   int x = 0;
@@ -26,13 +38,55 @@ struct Point {
   }
 };
 
+enum class PathPriority : std::uint8_t { Interactive, Background };
+
+enum class SearchMode : std::uint8_t { AStar, JumpPoint };
+
+struct PathCacheStats {
+  std::uint64_t hits = 0;
+  std::uint64_t misses = 0;
+  std::uint64_t coalesced = 0;
+  std::size_t entries = 0;
+};
+
+// A* over the obstacle grid, served by a pool of worker threads. Workers
+// search a shared read-only snapshot of the grid with their own scratch
+// buffers, so concurrent searches only meet on the request queues.
+// Interactive requests are always dequeued before background ones. Paths
+// longer than a cluster are planned on the cluster graph first and then
+// refined one cluster at a time. Goals outside the start's connected region
+// are rejected (or redirected) before any search runs. Identical queued
+// requests share one search, and finished paths are cached per obstacle
+// version. In JumpPoint mode every search instead runs JPS+ over jump
+// distances precomputed for each obstacle version. Paths delivered by the
+// workers are string-pulled down to the waypoints where they turn.
 class Pathfinding {
 public:
-  Pathfinding(int width, int height);
+  Pathfinding(int width, int height,
+              std::size_t worker_count = defaultWorkerCount());
   ~Pathfinding();
 
+  static auto defaultWorkerCount() -> std::size_t;
+
   void setGridOffset(float offset_x, float offset_z);
 
+  void setSearchMode(SearchMode mode);
+  auto searchMode() const -> SearchMode {
+    return m_searchMode.load(std::memory_order_acquire);
+  }
+
+  // Goals that cannot be reached from the start are moved to the closest
+  // reachable cell within `radius` cells, or rejected when it is zero.
+  void setGoalRedirectRadius(int radius);
+
+  // Grid and cluster searches on the workers expand at most `nodes` cells
+  // per slice. A search that runs out reports its best partial path once
+  // one is known and then
+  // queues behind the other requests of its lane before resuming, so long
+  // searches cannot starve short ones. Zero runs every search to the end.
+  static constexpr std::size_t kDefaultSliceBudget = 2048;
+  void setSearchSliceBudget(std::size_t nodes);
+
   auto getGridOffsetX() const -> float { return m_gridOffsetX; }
   auto getGridOffsetZ() const -> float { return m_gridOffsetZ; }
 
@@ -42,90 +96,313 @@ public:
   void updateBuildingObstacles();
 
   void markObstaclesDirty();
+  // Bumped by every obstacle change as soon as it is reported, before the
+  // next snapshot publishes it; cheap enough to poll every tick.
+  auto obstacleChangeCount() const -> std::uint64_t {
+    return m_obstacleChanges.load(std::memory_order_acquire);
+  }
+  // Reloads the terrain layer on the next update, e.g. after a saved game
+  // replaced the terrain under an existing pathfinder.
+  void markTerrainDirty();
 
   auto findPath(const Point &start, const Point &end) -> std::vector<Point>;
+  // Nodes closed by the most recent findPath() call.
+  auto lastSearchExpansions() -> std::size_t;
 
   auto findPathAsync(const Point &start,
                      const Point &end) -> std::future<std::vector<Point>>;
 
   void submitPathRequest(std::uint64_t request_id, const Point &start,
-                         const Point &end);
+                         const Point &end,
+                         PathPriority priority = PathPriority::Background);
+  auto pathCacheStats() const -> PathCacheStats;
+
+  // Flow fields towards `goal`, shared by every unit heading there. The
+  // lookup only consults the cache; the request builds the field on a
+  // worker and delivers it through fetchCompletedPaths().
+  auto findFlowField(const Point &goal) -> std::shared_ptr<const FlowField>;
+  void submitFlowFieldRequest(std::uint64_t request_id, const Point &goal,
+                              PathPriority priority = PathPriority::Background);
 
   struct PathResult {
     std::uint64_t request_id;
     std::vector<Point> path;
+    std::shared_ptr<const FlowField> flow_field;
+    // Best-so-far path of a search that is still running; the complete
+    // result follows under the same id.
+    bool partial{false};
   };
   auto fetchCompletedPaths() -> std::vector<PathResult>;
 
 private:
-  auto findPathInternal(const Point &start,
-                        const Point &end) -> std::vector<Point>;
+  struct ObstacleSnapshot {
+    int width = 0;
+    int height = 0;
+    std::uint64_t version = 0;
+    BlockedCells blocked{0, 0};
+    std::shared_ptr<const PathClusterGraph> clusters;
+    std::shared_ptr<const JumpPointTable> jumps;
+    std::shared_ptr<const WalkableRegions> regions;
 
-  static auto calculateHeuristic(const Point &a, const Point &b) -> int;
+    [[nodiscard]] auto isWalkable(int x, int y) const -> bool {
+      return blocked.walkable(x, y);
+    }
+  };
+
+  struct SearchSlice;
+
+  struct PathRequest {
+    std::uint64_t request_id{};
+    Point start;
+    Point end;
+    bool flow_field{false};
+    PathPriority priority{PathPriority::Background};
+    std::shared_ptr<SearchSlice> slice;
+  };
+
+  struct QueueNode {
+    int index;
+    int fCost;
+    int gCost;
+  };
+
+  // One cell of A* scratch state. The top bit of `generation` marks the
+  // cell closed in that generation.
+  struct SearchNode {
+    std::uint32_t generation{0};
+    int gCost{0};
+    int parent{-1};
+  };
+
+  // A* scratch state, one per searching thread. Maps up to kDenseCellLimit
+  // cells keep a record per cell; larger ones allocate square tiles of
+  // records on first touch and free tiles no search has touched for
+  // kTileIdleSearches searches, so memory follows the explored area.
+  struct SearchBuffers {
+    static constexpr std::size_t kDenseCellLimit = 512 * 512;
+    static constexpr int kTileShift = 5;
+    static constexpr int kTileSize = 1 << kTileShift;
+    static constexpr std::uint32_t kTileIdleSearches = 256;
+    static constexpr std::uint32_t kClosedBit = 0x80000000U;
+
+    struct Tile {
+      std::array<SearchNode, kTileSize * kTileSize> nodes;
+      std::uint32_t lastGeneration{0};
+    };
+
+    int width{0};
+    int height{0};
+    int tilesX{0};
+    bool tiled{false};
+    std::vector<SearchNode> nodes;
+    std::vector<std::unique_ptr<Tile>> tiles;
+    std::vector<QueueNode> openHeap;
+    std::uint32_t generationCounter{0};
+    std::size_t expandedNodes{0};
+
+    void ensure(int grid_width, int grid_height);
+    auto nextGeneration() -> std::uint32_t;
+    void resetGenerations();
+    void releaseIdleTiles();
 
-  void ensureWorkingBuffers();
-  auto nextGeneration() -> std::uint32_t;
-  void resetGenerations();
+    auto isClosed(int index, std::uint32_t generation) const -> bool;
+    void setClosed(int index, std::uint32_t generation);
+
+    auto getGCost(int index, std::uint32_t generation) const -> int;
+    auto hasParent(int index, std::uint32_t generation) const -> bool;
+    auto getParent(int index, std::uint32_t generation) const -> int;
+    void setNode(int index, std::uint32_t generation, int cost,
+                 int parentIndex);
+
+    void pushOpenNode(const QueueNode &node);
+    auto popOpenNode() -> QueueNode;
+
+  private:
+    auto find(int index) const -> const SearchNode *;
+    auto touch(int index, std::uint32_t generation) -> SearchNode *;
+  };
+
+  // Resumable state of an A* search over one area of the grid.
+  struct GridSearch {
+    Point start;
+    Point end;
+    ClusterBounds area;
+    std::uint32_t generation{0};
+    int iterations{0};
+    int max_iterations{0};
+    int best_index{-1};
+    int best_heuristic{0};
+    int final_cost{-1};
+    bool finished{false};
+  };
+
+  // Resumable state of a hierarchical search: an A* over the cluster
+  // entrances, then one in-cluster grid search per abstract step that
+  // refines it into cells.
+  struct HierarchicalSearch {
+    Point start;
+    Point end;
+    std::uint32_t generation{0};
+    std::vector<int> start_targets;
+    std::vector<int> start_dists;
+    std::vector<int> end_dists;
+    bool abstract_done{false};
+    std::vector<Point> waypoints;
+    // Waypoints refined so far; `path` holds the cells up to the last one.
+    std::size_t refined{0};
+    std::vector<Point> path;
+    bool finished{false};
+  };
+
+  // A worker search suspended between slices, with the buffers it owns.
+  struct SearchSlice {
+    bool hierarchical{false};
+    bool partial_published{false};
+    // Times the search started over because the obstacles changed.
+    int restarts{0};
+    GridSearch search;
+    HierarchicalSearch hierarchy;
+    std::shared_ptr<const ObstacleSnapshot> grid;
+    SearchBuffers buffers;
+  };
+
+  void loadTerrainLayer();
+  void updateBuildingLayer();
+  auto footprintCells(const BuildingFootprint &footprint) const
+      -> ClusterBounds;
+
+  auto acquireSnapshot() -> std::shared_ptr<const ObstacleSnapshot>;
+  void publishSnapshot();
+  auto acquireFlowField(const Point &goal, const ObstacleSnapshot &grid)
+      -> std::shared_ptr<const FlowField>;
+  auto currentSnapshot() const -> std::shared_ptr<const ObstacleSnapshot>;
+  void completePathRequest(const PathRequest &request,
+                           const ObstacleSnapshot &grid,
+                           std::vector<Point> path);
+  void publishPartialPath(const PathRequest &request,
+                          const ObstacleSnapshot &grid,
+                          const std::vector<Point> &raw_path);
+  void runPathRequest(const PathRequest &request, SearchBuffers &buffers);
+  void resumePathRequest(PathRequest request);
+  void suspendPathRequest(PathRequest request);
+  void finishPathRequest(PathRequest request, std::vector<Point> path);
+  void beginSearchSlice(SearchSlice &slice,
+                        std::shared_ptr<const ObstacleSnapshot> grid,
+                        const Point &start, const Point &goal) const;
+
+  auto findPathInternal(const Point &start, const Point &end,
+                        const ObstacleSnapshot &grid,
+                        SearchBuffers &buffers) const -> std::vector<Point>;
+  auto resolveGoal(const Point &start, const Point &end,
+                   const ObstacleSnapshot &grid, Point &goal) const -> bool;
+  auto usesJumpPoints(const ObstacleSnapshot &grid) const -> bool;
+  static auto usesClusters(const Point &start, const Point &goal,
+                           const ObstacleSnapshot &grid) -> bool;
+  auto findHierarchicalPath(const Point &start, const Point &end,
+                            const ObstacleSnapshot &grid,
+                            SearchBuffers &buffers) const
+      -> std::vector<Point>;
+  auto beginHierarchicalSearch(const Point &start, const Point &end,
+                               const ObstacleSnapshot &grid,
+                               SearchBuffers &buffers) const
+      -> HierarchicalSearch;
+  // Runs the abstract search for up to `budget` expansions, then refines
+  // abstract steps until their grid searches have used the budget (all of
+  // it when zero), and returns whether the search has finished.
+  auto stepHierarchicalSearch(HierarchicalSearch &search,
+                              const ObstacleSnapshot &grid,
+                              SearchBuffers &buffers,
+                              std::size_t budget) const -> bool;
+  auto stepSearchSlice(SearchSlice &slice, std::size_t budget) const -> bool;
+  auto searchSlicePath(const SearchSlice &slice, bool best_so_far) const
+      -> std::vector<Point>;
+  auto findJumpPointPath(const Point &start, const Point &end,
+                         const ObstacleSnapshot &grid,
+                         SearchBuffers &buffers) const -> std::vector<Point>;
+  auto searchGrid(const Point &start, const Point &end,
+                  const ClusterBounds &area, const ObstacleSnapshot &grid,
+                  SearchBuffers &buffers) const -> std::vector<Point>;
+  auto beginGridSearch(const Point &start, const Point &end,
+                       const ClusterBounds &area,
+                       SearchBuffers &buffers) const -> GridSearch;
+  // Expands up to `budget` nodes (all of them when zero) and returns
+  // whether the search has finished.
+  auto stepGridSearch(GridSearch &search, const ObstacleSnapshot &grid,
+                      SearchBuffers &buffers, std::size_t budget) const
+      -> bool;
+  auto gridSearchPath(const GridSearch &search, const SearchBuffers &buffers,
+                      bool best_so_far) const -> std::vector<Point>;
+
+  static auto calculateHeuristic(const Point &a, const Point &b) -> int;
+  static auto hasLineOfSight(const Point &from, const Point &to,
+                             const ObstacleSnapshot &grid) -> bool;
+  static auto smoothPath(const std::vector<Point> &path,
+                         const ObstacleSnapshot &grid) -> std::vector<Point>;
 
   auto toIndex(int x, int y) const -> int { return y * m_width + x; }
   auto toIndex(const Point &p) const -> int { return toIndex(p.x, p.y); }
+  auto inGrid(const Point &p) const -> bool {
+    return p.x >= 0 && p.x < m_width && p.y >= 0 && p.y < m_height;
+  }
+  auto pairKey(const Point &start, const Point &end) const -> std::uint64_t {
+    return (static_cast<std::uint64_t>(toIndex(start)) << 32) |
+           static_cast<std::uint32_t>(toIndex(end));
+  }
   auto toPoint(int index) const -> Point {
     return {index % m_width, index / m_width};
   }
 
-  auto isClosed(int index, std::uint32_t generation) const -> bool;
-  void setClosed(int index, std::uint32_t generation);
-
-  auto getGCost(int index, std::uint32_t generation) const -> int;
-  void setGCost(int index, std::uint32_t generation, int cost);
-
-  auto hasParent(int index, std::uint32_t generation) const -> bool;
-  auto getParent(int index, std::uint32_t generation) const -> int;
-  void setParent(int index, std::uint32_t generation, int parentIndex);
-
-  auto collectNeighbors(const Point &point,
+  auto collectNeighbors(const Point &point, const ObstacleSnapshot &grid,
                         std::array<Point, 8> &buffer) const -> std::size_t;
   void buildPath(int startIndex, int endIndex, std::uint32_t generation,
-                 int expectedLength, std::vector<Point> &outPath) const;
-
-  struct QueueNode {
-    int index;
-    int fCost;
-    int gCost;
-  };
+                 int expectedLength, const SearchBuffers &buffers,
+                 std::vector<Point> &outPath) const;
 
   static auto heapLess(const QueueNode &lhs, const QueueNode &rhs) -> bool;
-  void pushOpenNode(const QueueNode &node);
-  auto popOpenNode() -> QueueNode;
 
   void workerLoop();
 
   int m_width, m_height;
-  std::vector<std::vector<std::uint8_t>> m_obstacles;
+  ObstacleGrid m_obstacles;
+  bool m_terrainDirty{true};
+  // Grid rectangle each building was last rasterized into, by entity id.
+  std::unordered_map<unsigned int, ClusterBounds> m_buildingCells;
   float m_gridCellSize{1.0F};
   float m_gridOffsetX{0.0F}, m_gridOffsetZ{0.0F};
   std::atomic<bool> m_obstaclesDirty;
+  std::atomic<std::uint64_t> m_obstacleChanges{0};
+  std::atomic<bool> m_snapshotStale{false};
+  std::atomic<SearchMode> m_searchMode{SearchMode::AStar};
+  std::atomic<int> m_goalRedirectRadius{0};
+  std::atomic<std::size_t> m_sliceBudget{kDefaultSliceBudget};
   mutable std::mutex m_mutex;
+  std::atomic<std::shared_ptr<const ObstacleSnapshot>> m_snapshot;
+
+  std::mutex m_syncSearchMutex;
+  SearchBuffers m_syncBuffers;
+  std::unique_ptr<FlowFieldCache> m_flowFields;
+
   std::atomic<bool> m_stopWorker{false};
-  std::thread m_workerThread;
+  std::vector<std::thread> m_workers;
   std::mutex m_requestMutex;
   std::condition_variable m_requestCondition;
-  struct PathRequest {
-    std::uint64_t request_id{};
-    Point start;
-    Point end;
-  };
-  std::queue<PathRequest> m_requestQueue;
+  std::array<std::queue<PathRequest>, 2> m_requestQueues;
+  // Queued searches per lane by start/goal cell pair, with the ids of the
+  // identical requests waiting on them.
+  std::array<std::unordered_map<std::uint64_t, std::vector<std::uint64_t>>, 2>
+      m_inFlight;
+  // Buffers left behind by finished slices, reused for later suspensions.
+  static constexpr std::size_t kMaxSpareBuffers = 4;
+  // A suspended search that finds the obstacles changed starts over on the
+  // new ones; past this many restarts it runs to the end in one go.
+  static constexpr int kMaxSliceRestarts = 3;
+  std::vector<SearchBuffers> m_spareBuffers;
+  std::unique_ptr<PathCache> m_pathCache;
+  std::atomic<std::uint64_t> m_cacheHits{0};
+  std::atomic<std::uint64_t> m_cacheMisses{0};
+  std::atomic<std::uint64_t> m_coalescedRequests{0};
   std::mutex m_resultMutex;
   std::queue<PathResult> m_resultQueue;
-
-  mutable std::vector<std::uint32_t> m_closedGeneration;
-  mutable std::vector<std::uint32_t> m_gCostGeneration;
-  mutable std::vector<int> m_gCostValues;
-  mutable std::vector<std::uint32_t> m_parentGeneration;
-  mutable std::vector<int> m_parentValues;
-  mutable std::vector<QueueNode> m_openHeap;
-  mutable std::uint32_t m_generationCounter{0};
 };
 
-} // namespace Game::Systems
\ No newline at end of file
+} // namespace Game::Systems
@@ -1,6 +1,7 @@
 #include "patrol_system.h"
 #include "../core/component.h"
 #include "../core/world.h"
+#include "spatial_index.h"
 #include <QVector3D>
 #include <cmath>
 
@@ -11,7 +12,7 @@ void PatrolSystem::update(Engine::Core::World *world, float deltaTime) {
     return;
   }
 
-  auto entities = world->getEntitiesWith<Engine::Core::PatrolComponent>();
+  auto entities = world->query<Engine::Core::PatrolComponent>();
 
   for (auto *entity : entities) {
     auto *patrol = entity->getComponent<Engine::Core::PatrolComponent>();
@@ -39,42 +40,27 @@ void PatrolSystem::update(Engine::Core::World *world, float deltaTime) {
       continue;
     }
 
-    bool enemy_nearby = false;
-    auto all_entities = world->getEntitiesWith<Engine::Core::UnitComponent>();
-    for (auto *other : all_entities) {
-      auto *other_unit = other->getComponent<Engine::Core::UnitComponent>();
-      auto *other_transform =
-          other->getComponent<Engine::Core::TransformComponent>();
-
-      if ((other_unit == nullptr) || (other_transform == nullptr) ||
-          other_unit->health <= 0) {
-        continue;
-      }
-      if (other_unit->owner_id == unit->owner_id) {
-        continue;
-      }
-
-      float const dx = other_transform->position.x - transform->position.x;
-      float const dz = other_transform->position.z - transform->position.z;
-      float const dist_sq = dx * dx + dz * dz;
-
-      if (dist_sq < 25.0F) {
-        enemy_nearby = true;
-
-        if (attack_target == nullptr) {
-          entity->addComponent<Engine::Core::AttackTargetComponent>();
-          attack_target =
-              entity->getComponent<Engine::Core::AttackTargetComponent>();
-        }
-        if (attack_target != nullptr) {
-          attack_target->target_id = other->getId();
-          attack_target->shouldChase = false;
-        }
-        break;
+    const SpatialEntry *enemy = SpatialIndex::instance().units().findNearest(
+        transform->position.x, transform->position.z, 5.0F,
+        [&](const SpatialEntry &entry) {
+          if (entry.owner_id == unit->owner_id) {
+            return false;
+          }
+          auto *other_unit =
+              entry.entity->getComponent<Engine::Core::UnitComponent>();
+          return (other_unit != nullptr) && other_unit->health > 0;
+        });
+
+    if (enemy != nullptr) {
+      if (attack_target == nullptr) {
+        Engine::Core::AttackTargetComponent new_target;
+        new_target.target_id = enemy->id;
+        world->commands().addComponent<Engine::Core::AttackTargetComponent>(
+            entity->getId(), new_target);
+      } else {
+        attack_target->target_id = enemy->id;
+        attack_target->shouldChase = false;
       }
-    }
-
-    if (enemy_nearby) {
 
       continue;
     }
@@ -104,4 +90,12 @@ void PatrolSystem::update(Engine::Core::World *world, float deltaTime) {
   }
 }
 
+auto PatrolSystem::access() const -> Engine::Core::SystemAccess {
+  return Engine::Core::SystemAccess{}
+      .read<Engine::Core::TransformComponent, Engine::Core::UnitComponent,
+            SpatialIndex>()
+      .write<Engine::Core::PatrolComponent, Engine::Core::MovementComponent,
+             Engine::Core::AttackTargetComponent>();
+}
+
 } // namespace Game::Systems
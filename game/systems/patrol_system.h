@@ -10,6 +10,7 @@ public:
   ~PatrolSystem() override = default;
 
   void update(Engine::Core::World *world, float deltaTime) override;
+  [[nodiscard]] auto access() const -> Engine::Core::SystemAccess override;
 };
 
 } // namespace Game::Systems
@@ -6,6 +6,7 @@
 #include "core/entity.h"
 #include "units/spawn_type.h"
 #include "units/troop_type.h"
+#include <utility>
 #include <vector>
 
 namespace Game::Systems {
@@ -36,12 +37,13 @@ auto ProductionService::startProductionForFirstSelectedBarracks(
   if (e == nullptr) {
     return ProductionResult::NoBarracks;
   }
+  // Called from the GUI thread, so a barracks without production yet gets
+  // it through the command buffer once the order is accepted.
+  Engine::Core::ProductionComponent added;
   auto *p = e->getComponent<Engine::Core::ProductionComponent>();
-  if (p == nullptr) {
-    p = e->addComponent<Engine::Core::ProductionComponent>();
-  }
-  if (p == nullptr) {
-    return ProductionResult::NoBarracks;
+  bool const missing = p == nullptr;
+  if (missing) {
+    p = &added;
   }
 
   int const individuals_per_unit =
@@ -74,6 +76,10 @@ auto ProductionService::startProductionForFirstSelectedBarracks(
     p->inProgress = true;
   }
 
+  if (missing) {
+    world.commands().addComponent<Engine::Core::ProductionComponent>(
+        e->getId(), std::move(added));
+  }
   return ProductionResult::Success;
 }
 
@@ -85,16 +91,19 @@ auto ProductionService::setRallyForFirstSelectedBarracks(
   if (e == nullptr) {
     return false;
   }
+  Engine::Core::ProductionComponent added;
   auto *p = e->getComponent<Engine::Core::ProductionComponent>();
-  if (p == nullptr) {
-    p = e->addComponent<Engine::Core::ProductionComponent>();
-  }
-  if (p == nullptr) {
-    return false;
+  bool const missing = p == nullptr;
+  if (missing) {
+    p = &added;
   }
   p->rallyX = x;
   p->rallyZ = z;
   p->rallySet = true;
+  if (missing) {
+    world.commands().addComponent<Engine::Core::ProductionComponent>(
+        e->getId(), std::move(added));
+  }
   return true;
 }
 
@@ -6,10 +6,12 @@
 #include "../map/map_transformer.h"
 #include "../units/factory.h"
 #include "../units/troop_config.h"
+#include "troop_count_registry.h"
 #include "units/spawn_type.h"
 #include "units/unit.h"
 #include <cmath>
 #include <qvectornd.h>
+#include <unordered_map>
 
 namespace Game::Systems {
 
@@ -17,7 +19,8 @@ void ProductionSystem::update(Engine::Core::World *world, float deltaTime) {
   if (world == nullptr) {
     return;
   }
-  auto entities = world->getEntitiesWith<Engine::Core::ProductionComponent>();
+  std::unordered_map<int, int> pending_troops;
+  auto entities = world->query<Engine::Core::ProductionComponent>();
   for (auto *e : entities) {
     auto *prod = e->getComponent<Engine::Core::ProductionComponent>();
     if (prod == nullptr) {
@@ -50,7 +53,8 @@ void ProductionSystem::update(Engine::Core::World *world, float deltaTime) {
       if ((t != nullptr) && (u != nullptr)) {
 
         int const current_troops =
-            Engine::Core::World::countTroopsForPlayer(u->owner_id);
+            Engine::Core::World::countTroopsForPlayer(u->owner_id) +
+            pending_troops[u->owner_id];
         int const max_troops =
             Game::GameConfig::instance().getMaxTroopsPerPlayer();
         if (current_troops + individuals_per_unit > max_troops) {
@@ -74,11 +78,17 @@ void ProductionSystem::update(Engine::Core::World *world, float deltaTime) {
               Game::Units::spawn_typeFromTroopType(prod->product_type);
           sp.aiControlled =
               e->hasComponent<Engine::Core::AIControlledComponent>();
-          auto unit = reg->create(sp.spawn_type, *world, sp);
-
-          if (unit && prod->rallySet) {
-            unit->moveTo(prod->rallyX, prod->rallyZ);
-          }
+          bool const rally_set = prod->rallySet;
+          float const rally_x = prod->rallyX;
+          float const rally_z = prod->rallyZ;
+          world->commands().defer([reg, sp, rally_set, rally_x,
+                                   rally_z](Engine::Core::World &target) {
+            auto unit = reg->create(sp.spawn_type, target, sp);
+            if (unit && rally_set) {
+              unit->moveTo(rally_x, rally_z);
+            }
+          });
+          pending_troops[u->owner_id] += individuals_per_unit;
         }
 
         prod->producedCount += individuals_per_unit;
@@ -97,4 +107,11 @@ void ProductionSystem::update(Engine::Core::World *world, float deltaTime) {
   }
 }
 
+auto ProductionSystem::access() const -> Engine::Core::SystemAccess {
+  return Engine::Core::SystemAccess{}
+      .read<Engine::Core::UnitComponent, Engine::Core::TransformComponent,
+            Engine::Core::AIControlledComponent, TroopCountRegistry>()
+      .write<Engine::Core::ProductionComponent>();
+}
+
 } // namespace Game::Systems
@@ -7,6 +7,7 @@ namespace Game::Systems {
 class ProductionSystem : public Engine::Core::System {
 public:
   void update(Engine::Core::World *world, float deltaTime) override;
+  [[nodiscard]] auto access() const -> Engine::Core::SystemAccess override;
 };
 
 } // namespace Game::Systems
@@ -0,0 +1,97 @@
+#include "spatial_index.h"
+#include "../core/component.h"
+#include "../core/world.h"
+#include "owner_registry.h"
+#include <algorithm>
+#include <cstdint>
+
+namespace Game::Systems {
+
+void SpatialHashGrid::build() {
+  std::sort(m_entries.begin(), m_entries.end(),
+            [](const Item &a, const Item &b) { return a.key < b.key; });
+
+  m_cells.clear();
+  auto const count = static_cast<std::uint32_t>(m_entries.size());
+  std::uint32_t begin = 0;
+  while (begin < count) {
+    std::uint64_t const key = m_entries[begin].key;
+    std::uint32_t end = begin + 1;
+    while (end < count && m_entries[end].key == key) {
+      ++end;
+    }
+    m_cells.emplace(key, CellRange{begin, end});
+    begin = end;
+  }
+}
+
+auto SpatialIndex::instance() -> SpatialIndex & {
+  static SpatialIndex inst;
+  return inst;
+}
+
+void SpatialIndex::rebuild(Engine::Core::World &world) {
+  m_units.clear();
+  m_maxUnitRadius = 0.0F;
+  auto units = world.query<Engine::Core::UnitComponent,
+                           Engine::Core::TransformComponent>(
+      Engine::Core::Without<Engine::Core::PendingRemovalComponent>{});
+  m_units.reserve(units.size());
+
+  for (auto *entity : units) {
+    auto *unit = entity->getComponent<Engine::Core::UnitComponent>();
+    auto *transform = entity->getComponent<Engine::Core::TransformComponent>();
+    if (unit->health <= 0) {
+      continue;
+    }
+
+    SpatialEntry entry;
+    entry.id = entity->getId();
+    entry.x = transform->position.x;
+    entry.z = transform->position.z;
+    entry.radius = std::max(transform->scale.x, transform->scale.z) * 0.5F;
+    entry.owner_id = unit->owner_id;
+    entry.is_building =
+        entity->hasComponent<Engine::Core::BuildingComponent>();
+    entry.entity = entity;
+    m_units.insert(entry);
+    if (!entry.is_building) {
+      m_maxUnitRadius = std::max(m_maxUnitRadius, entry.radius);
+    }
+  }
+  m_units.build();
+}
+
+void SpatialIndex::clear() {
+  m_units.clear();
+  m_maxUnitRadius = 0.0F;
+}
+
+auto SpatialIndex::findNearestEnemy(int owner_id, float x, float z,
+                                    float max_range,
+                                    Engine::Core::EntityID exclude_id,
+                                    bool include_buildings) const
+    -> Engine::Core::Entity * {
+  auto &owner_registry = OwnerRegistry::instance();
+  const SpatialEntry *nearest = m_units.findNearest(
+      x, z, max_range, [&](const SpatialEntry &entry) {
+        if (entry.id == exclude_id || entry.owner_id == owner_id) {
+          return false;
+        }
+        if (!include_buildings && entry.is_building) {
+          return false;
+        }
+        if (owner_registry.areAllies(owner_id, entry.owner_id)) {
+          return false;
+        }
+        if (entry.entity->hasComponent<
+                Engine::Core::PendingRemovalComponent>()) {
+          return false;
+        }
+        auto *unit = entry.entity->getComponent<Engine::Core::UnitComponent>();
+        return (unit != nullptr) && unit->health > 0;
+      });
+  return nearest != nullptr ? nearest->entity : nullptr;
+}
+
+} // namespace Game::Systems
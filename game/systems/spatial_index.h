@@ -0,0 +1,216 @@
+#pragma once
+
+#include "../core/entity.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace Engine::Core {
+class World;
+}
+
+namespace Game::Systems {
+
+struct SpatialEntry {
+  Engine::Core::EntityID id = 0;
+  float x = 0.0F;
+  float z = 0.0F;
+  float radius = 0.0F;
+  int owner_id = 0;
+  bool is_building = false;
+  Engine::Core::Entity *entity = nullptr;
+};
+
+// Uniform grid over the XZ plane. Entries are bucketed by cell and sorted so
+// each cell is a contiguous range; build() must run after the last insert and
+// before the first query.
+class SpatialHashGrid {
+public:
+  static constexpr float kDefaultCellSize = 4.0F;
+
+  explicit SpatialHashGrid(float cell_size = kDefaultCellSize)
+      : m_invCellSize(1.0F / cell_size) {}
+
+  void clear() {
+    m_entries.clear();
+    m_cells.clear();
+  }
+
+  void reserve(std::size_t count) { m_entries.reserve(count); }
+
+  void insert(const SpatialEntry &entry) {
+    m_entries.push_back({cellKey(cellCoord(entry.x), cellCoord(entry.z)),
+                         entry});
+  }
+
+  void build();
+
+  [[nodiscard]] auto size() const -> std::size_t { return m_entries.size(); }
+
+  template <typename Fn>
+  void forEachInRect(float min_x, float min_z, float max_x, float max_z,
+                     Fn &&fn) const {
+    int const cx0 = cellCoord(min_x);
+    int const cz0 = cellCoord(min_z);
+    int const cx1 = cellCoord(max_x);
+    int const cz1 = cellCoord(max_z);
+    auto visit = [&](const CellRange &range) {
+      for (std::uint32_t i = range.begin; i < range.end; ++i) {
+        const SpatialEntry &entry = m_entries[i].entry;
+        if (entry.x >= min_x && entry.x <= max_x && entry.z >= min_z &&
+            entry.z <= max_z) {
+          fn(entry);
+        }
+      }
+    };
+
+    auto const span_cells = static_cast<std::size_t>(cx1 - cx0 + 1) *
+                            static_cast<std::size_t>(cz1 - cz0 + 1);
+    if (span_cells > m_cells.size()) {
+      for (const auto &[key, range] : m_cells) {
+        int const cx = cellX(key);
+        int const cz = cellZ(key);
+        if (cx >= cx0 && cx <= cx1 && cz >= cz0 && cz <= cz1) {
+          visit(range);
+        }
+      }
+      return;
+    }
+
+    for (int cz = cz0; cz <= cz1; ++cz) {
+      for (int cx = cx0; cx <= cx1; ++cx) {
+        auto it = m_cells.find(cellKey(cx, cz));
+        if (it != m_cells.end()) {
+          visit(it->second);
+        }
+      }
+    }
+  }
+
+  template <typename Fn>
+  void forEachInRadius(float x, float z, float radius, Fn &&fn) const {
+    float const radius_sq = radius * radius;
+    forEachInRect(x - radius, z - radius, x + radius, z + radius,
+                  [&](const SpatialEntry &entry) {
+                    float const dx = entry.x - x;
+                    float const dz = entry.z - z;
+                    if (dx * dx + dz * dz <= radius_sq) {
+                      fn(entry);
+                    }
+                  });
+  }
+
+  template <typename Pred>
+  auto findNearest(float x, float z, float max_range,
+                   Pred &&pred) const -> const SpatialEntry * {
+    const SpatialEntry *nearest = nullptr;
+    float nearest_dist_sq = max_range * max_range;
+    forEachInRadius(x, z, max_range, [&](const SpatialEntry &entry) {
+      float const dx = entry.x - x;
+      float const dz = entry.z - z;
+      float const dist_sq = dx * dx + dz * dz;
+      if (dist_sq < nearest_dist_sq && pred(entry)) {
+        nearest_dist_sq = dist_sq;
+        nearest = &entry;
+      }
+    });
+    return nearest;
+  }
+
+  template <typename Pred>
+  void findKNearest(float x, float z, std::size_t k, float max_range,
+                    Pred &&pred,
+                    std::vector<const SpatialEntry *> &out) const {
+    out.clear();
+    if (k == 0) {
+      return;
+    }
+    forEachInRadius(x, z, max_range, [&](const SpatialEntry &entry) {
+      if (pred(entry)) {
+        out.push_back(&entry);
+      }
+    });
+    auto dist_sq = [x, z](const SpatialEntry *entry) {
+      float const dx = entry->x - x;
+      float const dz = entry->z - z;
+      return dx * dx + dz * dz;
+    };
+    auto closer = [&](const SpatialEntry *a, const SpatialEntry *b) {
+      return dist_sq(a) < dist_sq(b);
+    };
+    if (out.size() > k) {
+      std::partial_sort(out.begin(), out.begin() + k, out.end(), closer);
+      out.resize(k);
+    } else {
+      std::sort(out.begin(), out.end(), closer);
+    }
+  }
+
+private:
+  struct Item {
+    std::uint64_t key;
+    SpatialEntry entry;
+  };
+
+  struct CellRange {
+    std::uint32_t begin;
+    std::uint32_t end;
+  };
+
+  [[nodiscard]] auto cellCoord(float v) const -> int {
+    return static_cast<int>(std::floor(v * m_invCellSize));
+  }
+
+  static auto cellKey(int cx, int cz) -> std::uint64_t {
+    return (static_cast<std::uint64_t>(static_cast<std::uint32_t>(cx)) << 32) |
+           static_cast<std::uint32_t>(cz);
+  }
+
+  static auto cellX(std::uint64_t key) -> int {
+    return static_cast<int>(static_cast<std::uint32_t>(key >> 32));
+  }
+
+  static auto cellZ(std::uint64_t key) -> int {
+    return static_cast<int>(static_cast<std::uint32_t>(key));
+  }
+
+  float m_invCellSize;
+  std::vector<Item> m_entries;
+  std::unordered_map<std::uint64_t, CellRange> m_cells;
+};
+
+// Per-tick index of living units, rebuilt by SpatialIndexSystem after
+// movement. Entity pointers stay valid until CleanupSystem destroys entities
+// at the end of the tick, so queries are meant for the simulation thread.
+class SpatialIndex {
+public:
+  static auto instance() -> SpatialIndex &;
+
+  void rebuild(Engine::Core::World &world);
+  void clear();
+
+  [[nodiscard]] auto units() const -> const SpatialHashGrid & {
+    return m_units;
+  }
+
+  [[nodiscard]] auto maxUnitRadius() const -> float { return m_maxUnitRadius; }
+
+  auto findNearestEnemy(int owner_id, float x, float z, float max_range,
+                        Engine::Core::EntityID exclude_id = 0,
+                        bool include_buildings = false) const
+      -> Engine::Core::Entity *;
+
+private:
+  SpatialIndex() = default;
+  ~SpatialIndex() = default;
+  SpatialIndex(const SpatialIndex &) = delete;
+  auto operator=(const SpatialIndex &) -> SpatialIndex & = delete;
+
+  SpatialHashGrid m_units;
+  float m_maxUnitRadius = 0.0F;
+};
+
+} // namespace Game::Systems
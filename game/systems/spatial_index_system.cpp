@@ -0,0 +1,21 @@
+#include "spatial_index_system.h"
+#include "../core/component.h"
+#include "../core/world.h"
+#include "spatial_index.h"
+
+namespace Game::Systems {
+
+void SpatialIndexSystem::update(Engine::Core::World *world,
+                                float /*deltaTime*/) {
+  SpatialIndex::instance().rebuild(*world);
+}
+
+auto SpatialIndexSystem::access() const -> Engine::Core::SystemAccess {
+  return Engine::Core::SystemAccess{}
+      .read<Engine::Core::UnitComponent, Engine::Core::TransformComponent,
+            Engine::Core::BuildingComponent,
+            Engine::Core::PendingRemovalComponent>()
+      .write<SpatialIndex>();
+}
+
+} // namespace Game::Systems
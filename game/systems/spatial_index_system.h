@@ -0,0 +1,13 @@
+#pragma once
+
+#include "../core/system.h"
+
+namespace Game::Systems {
+
+class SpatialIndexSystem : public Engine::Core::System {
+public:
+  void update(Engine::Core::World *world, float deltaTime) override;
+  [[nodiscard]] auto access() const -> Engine::Core::SystemAccess override;
+};
+
+} // namespace Game::Systems
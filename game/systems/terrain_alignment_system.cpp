@@ -15,10 +15,16 @@ void TerrainAlignmentSystem::update(Engine::Core::World *world,
     return;
   }
 
-  auto entities = world->getEntitiesWith<Engine::Core::TransformComponent>();
-  for (auto *entity : entities) {
-    alignEntityToTerrain(entity);
-  }
+  world->parallelForEach<Engine::Core::TransformComponent>(
+      [](Engine::Core::Entity &entity, Engine::Core::TransformComponent &) {
+        alignEntityToTerrain(&entity);
+      });
+}
+
+auto TerrainAlignmentSystem::access() const -> Engine::Core::SystemAccess {
+  return Engine::Core::SystemAccess{}
+      .read<Engine::Core::UnitComponent, Game::Map::TerrainService>()
+      .write<Engine::Core::TransformComponent>();
 }
 
 void TerrainAlignmentSystem::alignEntityToTerrain(
@@ -11,6 +11,7 @@ namespace Game::Systems {
 class TerrainAlignmentSystem : public Engine::Core::System {
 public:
   void update(Engine::Core::World *world, float deltaTime) override;
+  [[nodiscard]] auto access() const -> Engine::Core::SystemAccess override;
 
 private:
   static void alignEntityToTerrain(Engine::Core::Entity *entity);
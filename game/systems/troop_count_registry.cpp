@@ -63,7 +63,7 @@ void TroopCountRegistry::onUnitDied(const Engine::Core::UnitDiedEvent &event) {
 void TroopCountRegistry::rebuildFromWorld(Engine::Core::World &world) {
   m_troop_counts.clear();
 
-  auto entities = world.getEntitiesWith<Engine::Core::UnitComponent>();
+  auto entities = world.query<Engine::Core::UnitComponent>();
   for (auto *e : entities) {
     auto *unit = e->getComponent<Engine::Core::UnitComponent>();
     if ((unit == nullptr) || unit->health <= 0) {
@@ -190,7 +190,7 @@ auto VictoryService::checkElimination(Engine::Core::World &world) -> bool {
 
   int const local_team = m_owner_registry.getOwnerTeam(m_localOwnerId);
 
-  auto entities = world.getEntitiesWith<Engine::Core::UnitComponent>();
+  auto entities = world.query<Engine::Core::UnitComponent>();
   for (auto *e : entities) {
     auto *unit = e->getComponent<Engine::Core::UnitComponent>();
     if ((unit == nullptr) || unit->health <= 0) {
@@ -223,7 +223,7 @@ auto VictoryService::checkSurviveTime() const -> bool {
 
 auto VictoryService::checkNoUnits(Engine::Core::World &world) const -> bool {
 
-  auto entities = world.getEntitiesWith<Engine::Core::UnitComponent>();
+  auto entities = world.query<Engine::Core::UnitComponent>();
   for (auto *e : entities) {
     auto *unit = e->getComponent<Engine::Core::UnitComponent>();
     if ((unit == nullptr) || unit->health <= 0) {
@@ -240,7 +240,7 @@ auto VictoryService::checkNoUnits(Engine::Core::World &world) const -> bool {
 
 auto VictoryService::checkNoKeyStructures(Engine::Core::World &world) -> bool {
 
-  auto entities = world.getEntitiesWith<Engine::Core::UnitComponent>();
+  auto entities = world.query<Engine::Core::UnitComponent>();
   for (auto *e : entities) {
     auto *unit = e->getComponent<Engine::Core::UnitComponent>();
     if ((unit == nullptr) || unit->health <= 0) {
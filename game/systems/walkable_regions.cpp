@@ -0,0 +1,256 @@
+#include "walkable_regions.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace Game::Systems {
+
+WalkableRegions::WalkableRegions(int width, int height)
+    : m_width(width), m_height(height),
+      m_blocksX((width + kBlockSize - 1) / kBlockSize),
+      m_blocksY((height + kBlockSize - 1) / kBlockSize),
+      m_blocks(static_cast<std::size_t>(m_blocksX * m_blocksY)),
+      m_links(static_cast<std::size_t>(m_blocksX * m_blocksY)) {}
+
+void WalkableRegions::build(const BlockedCells &blocked) {
+  int const count = m_blocksX * m_blocksY;
+  for (int block = 0; block < count; ++block) {
+    labelBlock(blocked, block);
+  }
+  for (int block = 0; block < count; ++block) {
+    linkBlock(block);
+  }
+  join();
+}
+
+void WalkableRegions::update(const BlockedCells &blocked,
+                             const std::vector<ClusterBounds> &regions) {
+  std::vector<std::uint8_t> relabelled(m_blocks.size(), 0);
+  for (const auto &region : regions) {
+    if (region.empty()) {
+      continue;
+    }
+    int const first_bx = std::max(region.min_x, 0) / kBlockSize;
+    int const first_by = std::max(region.min_y, 0) / kBlockSize;
+    int const last_bx = std::min(region.max_x, m_width - 1) / kBlockSize;
+    int const last_by = std::min(region.max_y, m_height - 1) / kBlockSize;
+    for (int by = first_by; by <= last_by; ++by) {
+      for (int bx = first_bx; bx <= last_bx; ++bx) {
+        int const block = by * m_blocksX + bx;
+        if (relabelled[static_cast<std::size_t>(block)] == 0) {
+          relabelled[static_cast<std::size_t>(block)] = 1;
+          labelBlock(blocked, block);
+        }
+      }
+    }
+  }
+
+  // A block's links also depend on the labels east and south of it.
+  for (int by = 0; by < m_blocksY; ++by) {
+    for (int bx = 0; bx < m_blocksX; ++bx) {
+      int const block = by * m_blocksX + bx;
+      bool const changed =
+          relabelled[static_cast<std::size_t>(block)] != 0 ||
+          (bx + 1 < m_blocksX &&
+           relabelled[static_cast<std::size_t>(block + 1)] != 0) ||
+          (by + 1 < m_blocksY &&
+           relabelled[static_cast<std::size_t>(block + m_blocksX)] != 0);
+      if (changed) {
+        linkBlock(block);
+      }
+    }
+  }
+  join();
+}
+
+void WalkableRegions::labelBlock(const BlockedCells &blocked, int block) {
+  int const origin_x = (block % m_blocksX) * kBlockSize;
+  int const origin_y = (block / m_blocksX) * kBlockSize;
+  auto data = std::make_shared<Block>();
+
+  std::vector<int> stack;
+  for (int seed = 0; seed < kBlockSize * kBlockSize; ++seed) {
+    if (data->labels[static_cast<std::size_t>(seed)] != 0 ||
+        !blocked.walkable(origin_x + seed % kBlockSize,
+                          origin_y + seed / kBlockSize)) {
+      continue;
+    }
+    auto const component = static_cast<std::uint8_t>(++data->count);
+    data->labels[static_cast<std::size_t>(seed)] = component;
+    stack.push_back(seed);
+    while (!stack.empty()) {
+      int const cell = stack.back();
+      stack.pop_back();
+      int const x = cell % kBlockSize;
+      int const y = cell / kBlockSize;
+      auto visit = [&](int nx, int ny) {
+        if (nx < 0 || nx >= kBlockSize || ny < 0 || ny >= kBlockSize) {
+          return;
+        }
+        int const next = ny * kBlockSize + nx;
+        auto &label = data->labels[static_cast<std::size_t>(next)];
+        if (label == 0 && blocked.walkable(origin_x + nx, origin_y + ny)) {
+          label = component;
+          stack.push_back(next);
+        }
+      };
+      visit(x - 1, y);
+      visit(x + 1, y);
+      visit(x, y - 1);
+      visit(x, y + 1);
+    }
+  }
+  m_blocks[static_cast<std::size_t>(block)] = std::move(data);
+}
+
+void WalkableRegions::linkBlock(int block) {
+  int const bx = block % m_blocksX;
+  int const by = block / m_blocksX;
+  const Block &here = *m_blocks[static_cast<std::size_t>(block)];
+  auto links = std::make_shared<Links>();
+
+  auto add = [](std::vector<std::pair<std::uint8_t, std::uint8_t>> &out,
+                std::uint8_t from, std::uint8_t to) {
+    if (from != 0 && to != 0 &&
+        (out.empty() || out.back() != std::make_pair(from, to))) {
+      out.emplace_back(from, to);
+    }
+  };
+  // Blocks with a neighbour east or south are full-sized, so the shared
+  // border spans the whole block.
+  if (bx + 1 < m_blocksX) {
+    const Block &east = *m_blocks[static_cast<std::size_t>(block + 1)];
+    for (int y = 0; y < kBlockSize; ++y) {
+      add(links->east,
+          here.labels[static_cast<std::size_t>(y * kBlockSize + kBlockSize -
+                                               1)],
+          east.labels[static_cast<std::size_t>(y * kBlockSize)]);
+    }
+  }
+  if (by + 1 < m_blocksY) {
+    const Block &south =
+        *m_blocks[static_cast<std::size_t>(block + m_blocksX)];
+    for (int x = 0; x < kBlockSize; ++x) {
+      add(links->south,
+          here.labels[static_cast<std::size_t>(
+              (kBlockSize - 1) * kBlockSize + x)],
+          south.labels[static_cast<std::size_t>(x)]);
+    }
+  }
+  m_links[static_cast<std::size_t>(block)] = std::move(links);
+}
+
+void WalkableRegions::join() {
+  std::size_t const blocks = m_blocks.size();
+  m_firstComponent.resize(blocks + 1);
+  std::uint32_t total = 0;
+  for (std::size_t block = 0; block < blocks; ++block) {
+    m_firstComponent[block] = total;
+    total += m_blocks[block]->count;
+  }
+  m_firstComponent[blocks] = total;
+
+  std::vector<std::uint32_t> parent(total);
+  for (std::uint32_t component = 0; component < total; ++component) {
+    parent[component] = component;
+  }
+  auto find = [&](std::uint32_t component) {
+    while (parent[component] != component) {
+      parent[component] = parent[parent[component]];
+      component = parent[component];
+    }
+    return component;
+  };
+  auto unite = [&](std::uint32_t a, std::uint32_t b) {
+    a = find(a);
+    b = find(b);
+    if (a != b) {
+      parent[std::max(a, b)] = std::min(a, b);
+    }
+  };
+
+  for (std::size_t block = 0; block < blocks; ++block) {
+    const Links &links = *m_links[block];
+    std::uint32_t const first = m_firstComponent[block];
+    for (const auto &[from, to] : links.east) {
+      unite(first + from - 1, m_firstComponent[block + 1] + to - 1);
+    }
+    std::size_t const south = block + static_cast<std::size_t>(m_blocksX);
+    for (const auto &[from, to] : links.south) {
+      unite(first + from - 1, m_firstComponent[south] + to - 1);
+    }
+  }
+
+  // Roots are always the lowest component of their set, so they get their
+  // region before any other member is reached.
+  m_componentRegions.assign(total, kNone);
+  m_count = 0;
+  for (std::uint32_t component = 0; component < total; ++component) {
+    std::uint32_t const root = find(component);
+    m_componentRegions[component] =
+        root == component ? ++m_count : m_componentRegions[root];
+  }
+}
+
+auto WalkableRegions::label(const Point &cell) const -> std::uint32_t {
+  if (cell.x < 0 || cell.x >= m_width || cell.y < 0 || cell.y >= m_height) {
+    return kNone;
+  }
+  int const block = (cell.y / kBlockSize) * m_blocksX + cell.x / kBlockSize;
+  std::uint8_t const component =
+      m_blocks[static_cast<std::size_t>(block)]
+          ->labels[static_cast<std::size_t>((cell.y % kBlockSize) *
+                                                kBlockSize +
+                                            cell.x % kBlockSize)];
+  if (component == 0) {
+    return kNone;
+  }
+  return m_componentRegions[m_firstComponent[static_cast<std::size_t>(block)] +
+                            component - 1];
+}
+
+auto WalkableRegions::nearestInRegion(const Point &target,
+                                      std::uint32_t region,
+                                      int radius) const -> Point {
+  Point best{-1, -1};
+  if (region == kNone) {
+    return best;
+  }
+  int best_distance = std::numeric_limits<int>::max();
+  auto consider = [&](int x, int y) {
+    if (label({x, y}) != region) {
+      return;
+    }
+    int const dx = x - target.x;
+    int const dy = y - target.y;
+    int const distance = dx * dx + dy * dy;
+    if (distance < best_distance) {
+      best_distance = distance;
+      best = {x, y};
+    }
+  };
+
+  // Rings grow by one cell of Chebyshev distance; once a ring starts beyond
+  // the best match found, no later ring can hold a closer cell.
+  for (int ring = 0; ring <= radius && ring * ring <= best_distance; ++ring) {
+    if (ring == 0) {
+      consider(target.x, target.y);
+      continue;
+    }
+    for (int offset = -ring; offset <= ring; ++offset) {
+      consider(target.x + offset, target.y - ring);
+      consider(target.x + offset, target.y + ring);
+    }
+    for (int offset = -ring + 1; offset < ring; ++offset) {
+      consider(target.x - ring, target.y + offset);
+      consider(target.x + ring, target.y + offset);
+    }
+  }
+  return best;
+}
+
+} // namespace Game::Systems
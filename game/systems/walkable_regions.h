@@ -0,0 +1,80 @@
+#pragma once
+
+#include "blocked_cells.h"
+#include "pathfinding.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace Game::Systems {
+
+// Connected-component labels of the walkable cells. Diagonal steps never cut
+// corners, so two cells joined by one are always joined orthogonally too and
+// 4-connectivity gives exactly the regions the searches can cross. Cells in
+// different regions cannot reach each other, which answers unreachable
+// requests without a search.
+//
+// Cells are labelled per cluster-sized block and the block components are
+// joined through the open cells facing each other across block borders.
+// Blocks and their border links are shared by copies, so an update after an
+// obstacle change only floods the blocks the dirty regions touch and
+// re-joins the per-block components, which are far fewer than the cells.
+class WalkableRegions {
+public:
+  static constexpr std::uint32_t kNone = 0;
+  static constexpr int kBlockSize = PathClusterGraph::kClusterSize;
+
+  WalkableRegions(int width, int height);
+
+  void build(const BlockedCells &blocked);
+  // Relabels the blocks overlapping `regions`, whose cells in `blocked`
+  // may differ from the ones these labels were built from.
+  void update(const BlockedCells &blocked,
+              const std::vector<ClusterBounds> &regions);
+
+  [[nodiscard]] auto label(const Point &cell) const -> std::uint32_t;
+  [[nodiscard]] auto connected(const Point &a, const Point &b) const -> bool {
+    std::uint32_t const region = label(a);
+    return region != kNone && region == label(b);
+  }
+  [[nodiscard]] auto regionCount() const -> std::uint32_t { return m_count; }
+
+  // The cell of `region` closest to `target` within `radius` cells of it,
+  // or {-1, -1} when there is none.
+  [[nodiscard]] auto nearestInRegion(const Point &target, std::uint32_t region,
+                                     int radius) const -> Point;
+
+private:
+  struct Block {
+    // Component of each cell within the block, counted from 1; 0 marks a
+    // blocked cell. A 16x16 block holds at most 128 components.
+    std::array<std::uint8_t, kBlockSize * kBlockSize> labels{};
+    std::uint8_t count{0};
+  };
+  // Pairs of components, one in this block and one in the block east or
+  // south of it, that touch across the shared border.
+  struct Links {
+    std::vector<std::pair<std::uint8_t, std::uint8_t>> east;
+    std::vector<std::pair<std::uint8_t, std::uint8_t>> south;
+  };
+
+  void labelBlock(const BlockedCells &blocked, int block);
+  void linkBlock(int block);
+  void join();
+
+  int m_width;
+  int m_height;
+  int m_blocksX;
+  int m_blocksY;
+  std::uint32_t m_count{0};
+  std::vector<std::shared_ptr<const Block>> m_blocks;
+  std::vector<std::shared_ptr<const Links>> m_links;
+  // Index of each block's first component in m_componentRegions.
+  std::vector<std::uint32_t> m_firstComponent;
+  std::vector<std::uint32_t> m_componentRegions;
+};
+
+} // namespace Game::Systems
@@ -51,8 +51,8 @@ void Archer::init(const SpawnParams &params) {
   m_u->health = 80;
   m_u->max_health = 80;
   m_u->speed = 3.0F;
-  m_u->owner_id = params.player_id;
   m_u->vision_range = 16.0F;
+  m_world->setUnitOwner(*e, params.player_id);
 
   if (params.aiControlled) {
     e->addComponent<Engine::Core::AIControlledComponent>();
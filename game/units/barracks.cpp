@@ -39,8 +39,8 @@ void Barracks::init(const SpawnParams &params) {
   m_u->health = 2000;
   m_u->max_health = 2000;
   m_u->speed = 0.0F;
-  m_u->owner_id = params.player_id;
   m_u->vision_range = 22.0F;
+  m_world->setUnitOwner(*e, params.player_id);
 
   if (params.aiControlled) {
     e->addComponent<Engine::Core::AIControlledComponent>();
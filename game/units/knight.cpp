@@ -51,8 +51,8 @@ void Knight::init(const SpawnParams &params) {
   m_u->health = 150;
   m_u->max_health = 150;
   m_u->speed = 2.0F;
-  m_u->owner_id = params.player_id;
   m_u->vision_range = 14.0F;
+  m_world->setUnitOwner(*e, params.player_id);
 
   if (params.aiControlled) {
     e->addComponent<Engine::Core::AIControlledComponent>();
@@ -53,8 +53,8 @@ void MountedKnight::init(const SpawnParams &params) {
   m_u->health = 200;
   m_u->max_health = 200;
   m_u->speed = 8.0F;
-  m_u->owner_id = params.player_id;
   m_u->vision_range = 16.0F;
+  m_world->setUnitOwner(*e, params.player_id);
 
   if (params.aiControlled) {
     e->addComponent<Engine::Core::AIControlledComponent>();
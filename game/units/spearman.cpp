@@ -52,8 +52,8 @@ void Spearman::init(const SpawnParams &params) {
   m_u->health = 120;
   m_u->max_health = 120;
   m_u->speed = 2.5F;
-  m_u->owner_id = params.player_id;
   m_u->vision_range = 15.0F;
+  m_world->setUnitOwner(*e, params.player_id);
 
   if (params.aiControlled) {
     e->addComponent<Engine::Core::AIControlledComponent>();
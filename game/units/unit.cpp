@@ -56,6 +56,7 @@ void Unit::moveTo(float x, float z) {
     m_mv->goalX = x;
     m_mv->goalY = z;
     m_mv->path.clear();
+    m_mv->flowField.reset();
     m_mv->pathPending = false;
     m_mv->pendingRequestId = 0;
   }
@@ -105,6 +106,7 @@ void Unit::setHoldMode(bool enabled) {
     if (mv != nullptr) {
       mv->hasTarget = false;
       mv->path.clear();
+      mv->flowField.reset();
       mv->pathPending = false;
     }
   } else {
@@ -43,16 +43,23 @@ struct CylinderCmd {
   float alpha = 1.0F;
 };
 
+// Laid out as the fog shader's instance attributes read it, so the fog
+// pass uploads its instances as they are.
 struct FogInstanceData {
   QVector3D center{0.0F, 0.25F, 0.0F};
+  float size = 1.0F;
   QVector3D color{0.05F, 0.05F, 0.05F};
   float alpha = 1.0F;
-  float size = 1.0F;
+  float fade_from = 1.0F;
+  float fade_start = 0.0F;
 };
 
 struct FogBatchCmd {
-  const FogInstanceData *instances = nullptr;
-  std::size_t count = 0;
+  Buffer *instanceBuffer = nullptr;
+  std::size_t first_instance = 0;
+  std::size_t instance_count = 0;
+  float time = 0.0F;
+  float fade_duration = 0.0F;
 };
 
 struct GrassBatchCmd {
@@ -45,7 +45,7 @@ void renderPatrolFlags(Renderer *renderer, ResourceManager *resources,
     rendered_positions.insert(pos_hash);
   }
 
-  auto patrol_entities = world.getEntitiesWith<Engine::Core::PatrolComponent>();
+  auto patrol_entities = world.query<Engine::Core::PatrolComponent>();
 
   for (auto *entity : patrol_entities) {
     auto *patrol = entity->getComponent<Engine::Core::PatrolComponent>();
@@ -9,6 +9,7 @@
 #include "backend/vegetation_pipeline.h"
 #include "backend/water_pipeline.h"
 #include "buffer.h"
+#include "game/core/profiler.h"
 #include "gl/camera.h"
 #include "gl/resources.h"
 #include "ground/firecamp_gpu.h"
@@ -24,13 +25,16 @@
 #include <GL/gl.h>
 #include <QDebug>
 #include <QOpenGLContext>
+#include <array>
 #include <cmath>
 #include <cstddef>
 #include <memory>
+#include <optional>
 #include <qglobal.h>
 #include <qmatrix4x4.h>
 #include <qstringliteral.h>
 #include <qvectornd.h>
+#include <variant>
 #include <vector>
 
 namespace Render::GL {
@@ -42,7 +46,21 @@ using namespace Render::GL::ComponentCount;
 namespace {
 
 const QVector3D k_grid_line_color(0.22F, 0.25F, 0.22F);
-}
+
+constexpr std::array<const char *, std::variant_size_v<DrawCmd>>
+    k_pipeline_zone_names = {"Backend::grid",
+                             "Backend::selectionRing",
+                             "Backend::selectionSmoke",
+                             "Backend::cylinder",
+                             "Backend::mesh",
+                             "Backend::fog",
+                             "Backend::grass",
+                             "Backend::stone",
+                             "Backend::plant",
+                             "Backend::pine",
+                             "Backend::firecamp",
+                             "Backend::terrain"};
+} // namespace
 
 Backend::Backend() = default;
 
@@ -185,10 +203,20 @@ void Backend::execute(const DrawQueue &queue, const Camera &cam) {
   m_lastBoundShader = nullptr;
   m_lastBoundTexture = nullptr;
 
+  Engine::Core::ProfileZone const execute_zone("Backend::execute");
+  bool const profiling = Engine::Core::Profiler::isEnabled();
+  std::optional<Engine::Core::ProfileZone> pipeline_zone;
+  std::size_t pipeline_zone_index = std::variant_npos;
+
   const std::size_t count = queue.size();
   std::size_t i = 0;
   while (i < count) {
     const auto &cmd = queue.getSorted(i);
+    if (profiling && cmd.index() != pipeline_zone_index) {
+      pipeline_zone_index = cmd.index();
+      pipeline_zone.reset();
+      pipeline_zone.emplace(k_pipeline_zone_names[pipeline_zone_index]);
+    }
     switch (cmd.index()) {
     case CylinderCmdIndex: {
       if (!m_cylinderPipeline) {
@@ -238,19 +266,8 @@ void Backend::execute(const DrawQueue &queue, const Camera &cam) {
         continue;
       }
       const auto &batch = std::get<FogBatchCmdIndex>(cmd);
-      const FogInstanceData *instances = batch.instances;
-      const std::size_t instance_count = batch.count;
-      if ((instances != nullptr) && instance_count > 0 &&
+      if ((batch.instanceBuffer != nullptr) && batch.instance_count > 0 &&
           (m_cylinderPipeline->fogShader() != nullptr)) {
-        m_cylinderPipeline->m_fogScratch.resize(instance_count);
-        for (std::size_t idx = 0; idx < instance_count; ++idx) {
-          BackendPipelines::CylinderPipeline::FogInstanceGpu gpu{};
-          gpu.center = instances[idx].center;
-          gpu.size = instances[idx].size;
-          gpu.color = instances[idx].color;
-          gpu.alpha = instances[idx].alpha;
-          m_cylinderPipeline->m_fogScratch[idx] = gpu;
-        }
         glDepthMask(GL_TRUE);
         if (glIsEnabled(GL_POLYGON_OFFSET_FILL) != 0U) {
           glDisable(GL_POLYGON_OFFSET_FILL);
@@ -266,8 +283,18 @@ void Backend::execute(const DrawQueue &queue, const Camera &cam) {
           fogShader->setUniform(m_cylinderPipeline->m_fogUniforms.view_proj,
                                 view_proj);
         }
-        m_cylinderPipeline->uploadFogInstances(instance_count);
-        m_cylinderPipeline->drawFog(instance_count);
+        if (m_cylinderPipeline->m_fogUniforms.time != Shader::InvalidUniform) {
+          fogShader->setUniform(m_cylinderPipeline->m_fogUniforms.time,
+                                batch.time);
+        }
+        if (m_cylinderPipeline->m_fogUniforms.fade_duration !=
+            Shader::InvalidUniform) {
+          fogShader->setUniform(m_cylinderPipeline->m_fogUniforms.fade_duration,
+                                batch.fade_duration);
+        }
+        m_cylinderPipeline->drawFog(batch.instanceBuffer,
+                                    batch.first_instance,
+                                    batch.instance_count);
       }
       ++i;
       continue;
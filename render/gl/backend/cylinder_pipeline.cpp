@@ -1,5 +1,7 @@
 #include "cylinder_pipeline.h"
+#include "../../draw_queue.h"
 #include "../backend.h"
+#include "../buffer.h"
 #include "../mesh.h"
 #include "../primitives.h"
 #include "../render_constants.h"
@@ -60,6 +62,9 @@ void CylinderPipeline::cacheUniforms() {
 
   if (m_fogShader != nullptr) {
     m_fogUniforms.view_proj = m_fogShader->uniformHandle("u_viewProj");
+    m_fogUniforms.time = m_fogShader->uniformHandle("u_time");
+    m_fogUniforms.fade_duration =
+        m_fogShader->uniformHandle("u_fadeDuration");
   }
 }
 
@@ -67,10 +72,6 @@ void CylinderPipeline::beginFrame() {
   if (m_cylinderPersistentBuffer.isValid()) {
     m_cylinderPersistentBuffer.beginFrame();
   }
-
-  if (m_fogPersistentBuffer.isValid()) {
-    m_fogPersistentBuffer.beginFrame();
-  }
 }
 
 void CylinderPipeline::initializeCylinderPipeline() {
@@ -298,42 +299,21 @@ void CylinderPipeline::initializeFogPipeline() {
                         GL_FALSE, sizeof(Vertex),
                         reinterpret_cast<void *>(offsetof(Vertex, tex_coord)));
 
-  glGenBuffers(1, &m_fogInstanceBuffer);
-  glBindBuffer(GL_ARRAY_BUFFER, m_fogInstanceBuffer);
-  m_fogInstanceCapacity = BufferCapacity::DefaultFogInstances;
-  glBufferData(GL_ARRAY_BUFFER, m_fogInstanceCapacity * sizeof(FogInstanceGpu),
-               nullptr, GL_DYNAMIC_DRAW);
-
-  const auto stride = static_cast<GLsizei>(sizeof(FogInstanceGpu));
+  // drawFog points the instance attributes at the fog pass's own buffer.
   glEnableVertexAttribArray(VertexAttrib::InstancePosition);
-  glVertexAttribPointer(
-      VertexAttrib::InstancePosition, ComponentCount::Vec3, GL_FLOAT, GL_FALSE,
-      stride, reinterpret_cast<void *>(offsetof(FogInstanceGpu, center)));
   glVertexAttribDivisor(VertexAttrib::InstancePosition, 1);
-
   glEnableVertexAttribArray(VertexAttrib::InstanceScale);
-  glVertexAttribPointer(
-      VertexAttrib::InstanceScale, 1, GL_FLOAT, GL_FALSE, stride,
-      reinterpret_cast<void *>(offsetof(FogInstanceGpu, size)));
   glVertexAttribDivisor(VertexAttrib::InstanceScale, 1);
-
   glEnableVertexAttribArray(VertexAttrib::InstanceColor);
-  glVertexAttribPointer(
-      VertexAttrib::InstanceColor, ComponentCount::Vec3, GL_FLOAT, GL_FALSE,
-      stride, reinterpret_cast<void *>(offsetof(FogInstanceGpu, color)));
   glVertexAttribDivisor(VertexAttrib::InstanceColor, 1);
-
   glEnableVertexAttribArray(VertexAttrib::InstanceAlpha);
-  glVertexAttribPointer(
-      VertexAttrib::InstanceAlpha, 1, GL_FLOAT, GL_FALSE, stride,
-      reinterpret_cast<void *>(offsetof(FogInstanceGpu, alpha)));
   glVertexAttribDivisor(VertexAttrib::InstanceAlpha, 1);
+  glEnableVertexAttribArray(VertexAttrib::InstanceFade);
+  glVertexAttribDivisor(VertexAttrib::InstanceFade, 1);
 
   glBindVertexArray(0);
   glBindBuffer(GL_ARRAY_BUFFER, 0);
   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-
-  m_fogScratch.reserve(m_fogInstanceCapacity);
 }
 
 void CylinderPipeline::shutdownFogPipeline() {
@@ -343,19 +323,12 @@ void CylinderPipeline::shutdownFogPipeline() {
     m_fogVao = 0;
     m_fogVertexBuffer = 0;
     m_fogIndexBuffer = 0;
-    m_fogInstanceBuffer = 0;
     m_fogIndexCount = 0;
-    m_fogInstanceCapacity = 0;
-    m_fogScratch.clear();
     return;
   }
 
   initializeOpenGLFunctions();
 
-  if (m_fogInstanceBuffer != 0U) {
-    glDeleteBuffers(1, &m_fogInstanceBuffer);
-    m_fogInstanceBuffer = 0;
-  }
   if (m_fogVertexBuffer != 0U) {
     glDeleteBuffers(1, &m_fogVertexBuffer);
     m_fogVertexBuffer = 0;
@@ -369,39 +342,42 @@ void CylinderPipeline::shutdownFogPipeline() {
     m_fogVao = 0;
   }
   m_fogIndexCount = 0;
-  m_fogInstanceCapacity = 0;
-  m_fogScratch.clear();
-}
-
-void CylinderPipeline::uploadFogInstances(std::size_t count) {
-  if ((m_fogInstanceBuffer == 0U) || count == 0) {
-    return;
-  }
-
-  initializeOpenGLFunctions();
-  glBindBuffer(GL_ARRAY_BUFFER, m_fogInstanceBuffer);
-  if (count > m_fogInstanceCapacity) {
-    m_fogInstanceCapacity = std::max<std::size_t>(
-        count, (m_fogInstanceCapacity != 0U)
-                   ? m_fogInstanceCapacity * Growth::CapacityMultiplier
-                   : count);
-    glBufferData(GL_ARRAY_BUFFER,
-                 m_fogInstanceCapacity * sizeof(FogInstanceGpu), nullptr,
-                 GL_DYNAMIC_DRAW);
-    m_fogScratch.reserve(m_fogInstanceCapacity);
-  }
-  glBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(FogInstanceGpu),
-                  m_fogScratch.data());
-  glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
-void CylinderPipeline::drawFog(std::size_t count) {
-  if ((m_fogVao == 0U) || m_fogIndexCount == 0 || count == 0) {
+void CylinderPipeline::drawFog(GL::Buffer *instanceBuffer, std::size_t first,
+                               std::size_t count) {
+  if ((m_fogVao == 0U) || m_fogIndexCount == 0 ||
+      (instanceBuffer == nullptr) || count == 0) {
     return;
   }
 
   initializeOpenGLFunctions();
   glBindVertexArray(m_fogVao);
+  instanceBuffer->bind();
+  const auto stride = static_cast<GLsizei>(sizeof(FogInstanceData));
+  // Offsetting the attribute pointers starts the draw at `first` without
+  // needing base-instance draws.
+  const std::size_t base = first * sizeof(FogInstanceData);
+  glVertexAttribPointer(
+      VertexAttrib::InstancePosition, ComponentCount::Vec3, GL_FLOAT, GL_FALSE,
+      stride,
+      reinterpret_cast<void *>(base + offsetof(FogInstanceData, center)));
+  glVertexAttribPointer(
+      VertexAttrib::InstanceScale, 1, GL_FLOAT, GL_FALSE, stride,
+      reinterpret_cast<void *>(base + offsetof(FogInstanceData, size)));
+  glVertexAttribPointer(
+      VertexAttrib::InstanceColor, ComponentCount::Vec3, GL_FLOAT, GL_FALSE,
+      stride,
+      reinterpret_cast<void *>(base + offsetof(FogInstanceData, color)));
+  glVertexAttribPointer(
+      VertexAttrib::InstanceAlpha, 1, GL_FLOAT, GL_FALSE, stride,
+      reinterpret_cast<void *>(base + offsetof(FogInstanceData, alpha)));
+  glVertexAttribPointer(
+      VertexAttrib::InstanceFade, ComponentCount::Vec2, GL_FLOAT, GL_FALSE,
+      stride,
+      reinterpret_cast<void *>(base + offsetof(FogInstanceData, fade_from)));
+  instanceBuffer->unbind();
+
   glDrawElementsInstanced(GL_TRIANGLES, m_fogIndexCount, GL_UNSIGNED_INT,
                           nullptr, static_cast<GLsizei>(count));
   glBindVertexArray(0);
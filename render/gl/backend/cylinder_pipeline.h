@@ -7,6 +7,10 @@
 #include <memory>
 #include <vector>
 
+namespace Render::GL {
+class Buffer;
+}
+
 namespace Render::GL::BackendPipelines {
 
 class CylinderPipeline : public IPipeline {
@@ -26,8 +30,10 @@ public:
   void uploadCylinderInstances(std::size_t count);
   void drawCylinders(std::size_t count);
 
-  void uploadFogInstances(std::size_t count);
-  void drawFog(std::size_t count);
+  // Draws `count` fog instances, starting at `first`, straight from a buffer
+  // the fog pass owns.
+  void drawFog(GL::Buffer *instanceBuffer, std::size_t first,
+               std::size_t count);
 
   [[nodiscard]] auto cylinderShader() const -> GL::Shader * {
     return m_cylinderShader;
@@ -40,6 +46,8 @@ public:
 
   struct FogUniforms {
     GL::Shader::UniformHandle view_proj{GL::Shader::InvalidUniform};
+    GL::Shader::UniformHandle time{GL::Shader::InvalidUniform};
+    GL::Shader::UniformHandle fade_duration{GL::Shader::InvalidUniform};
   };
 
   struct CylinderInstanceGpu {
@@ -51,17 +59,9 @@ public:
     float padding{0.0F};
   };
 
-  struct FogInstanceGpu {
-    QVector3D center;
-    float size{1.0F};
-    QVector3D color;
-    float alpha{1.0F};
-  };
-
   CylinderUniforms m_cylinderUniforms;
   FogUniforms m_fogUniforms;
   std::vector<CylinderInstanceGpu> m_cylinderScratch;
-  std::vector<FogInstanceGpu> m_fogScratch;
 
 private:
   void initializeCylinderPipeline();
@@ -86,10 +86,7 @@ private:
   GLuint m_fogVao{0};
   GLuint m_fogVertexBuffer{0};
   GLuint m_fogIndexBuffer{0};
-  GLuint m_fogInstanceBuffer{0};
   GLsizei m_fogIndexCount{0};
-  std::size_t m_fogInstanceCapacity{0};
-  GL::PersistentRingBuffer<FogInstanceGpu> m_fogPersistentBuffer;
 };
 
 } // namespace Render::GL::BackendPipelines
@@ -24,6 +24,9 @@ public:
     setData(data.data(), data.size() * sizeof(T), usage);
   }
 
+  // Overwrites part of the storage the last setData allocated.
+  void setSubData(size_t offset, const void *data, size_t size);
+
 private:
   GLuint m_buffer = 0;
   Type m_type;
@@ -17,6 +17,7 @@ inline constexpr int InstanceScale = 4;
 inline constexpr int InstanceColor = 5;
 inline constexpr int InstanceAlpha = 6;
 inline constexpr int InstanceTint = 7;
+inline constexpr int InstanceFade = 8;
 } // namespace Render::GL::VertexAttrib
 
 namespace Render::GL::ComponentCount {
@@ -27,7 +28,6 @@ inline constexpr int Vec4 = 4;
 
 namespace Render::GL::BufferCapacity {
 inline constexpr int DefaultCylinderInstances = 256;
-inline constexpr int DefaultFogInstances = 512;
 inline constexpr int BuffersInFlight = 3;
 inline constexpr int ShaderInfoLogSize = 512;
 } // namespace Render::GL::BufferCapacity
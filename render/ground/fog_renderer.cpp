@@ -1,11 +1,11 @@
 #include "fog_renderer.h"
 
+#include "../gl/buffer.h"
 #include "../scene_renderer.h"
-#include <QElapsedTimer>
 #include <algorithm>
 #include <cstddef>
 #include <cstdint>
-#include <qelapsedtimer.h>
+#include <memory>
 #include <qmatrix4x4.h>
 #include <vector>
 
@@ -13,19 +13,80 @@ namespace Render::GL {
 
 namespace {
 const QMatrix4x4 k_identity_matrix;
+
+auto stateAlpha(std::uint8_t state) -> float {
+  if (state >= 2) {
+    return 0.0F;
+  }
+  return (state == 0) ? 0.9F : 0.45F;
+}
+
+auto stateColor(std::uint8_t state) -> QVector3D {
+  return (state == 0) ? QVector3D(0.02F, 0.02F, 0.05F)
+                      : QVector3D(0.05F, 0.05F, 0.05F);
 }
+} // namespace
+
+FogRenderer::FogRenderer() = default;
+FogRenderer::~FogRenderer() = default;
 
 void FogRenderer::updateMask(int width, int height, float tile_size,
                              const std::vector<std::uint8_t> &cells) {
   m_width = std::max(0, width);
   m_height = std::max(0, height);
-  m_tile_size = std::max(0.0001F, tile_size);
+  m_tile_size = std::max(kMinTileSize, tile_size);
   m_half_width = m_width * 0.5F - 0.5F;
   m_half_height = m_height * 0.5F - 0.5F;
   m_cells = cells;
+
+  // A whole new mask shows at once; only later region updates fade.
+  m_fades.assign(m_cells.size(), CellFade{});
+  for (std::size_t idx = 0; idx < m_cells.size(); ++idx) {
+    m_fades[idx].from = stateAlpha(m_cells[idx]);
+    m_fades[idx].previous = m_cells[idx];
+  }
   buildChunks();
 }
 
+void FogRenderer::updateRegion(int min_x, int min_z, int max_x, int max_z,
+                               const std::vector<std::uint8_t> &cells) {
+  if (min_x < 0 || min_z < 0 || max_x >= m_width || max_z >= m_height ||
+      min_x > max_x || min_z > max_z) {
+    return;
+  }
+  const int row_length = max_x - min_x + 1;
+  if (cells.size() !=
+      static_cast<std::size_t>(row_length) * (max_z - min_z + 1)) {
+    return;
+  }
+
+  std::vector<std::uint8_t> touched(m_chunks.size(), 0);
+  for (int z = min_z; z <= max_z; ++z) {
+    const auto *row = cells.data() + (z - min_z) * row_length;
+    for (int x = min_x; x <= max_x; ++x) {
+      const int idx = z * m_width + x;
+      const std::uint8_t state = row[x - min_x];
+      if (state == m_cells[idx]) {
+        continue;
+      }
+      auto &fade = m_fades[idx];
+      fade.from = displayedAlpha(idx);
+      fade.start = m_time;
+      fade.previous = m_cells[idx];
+      m_cells[idx] = state;
+      touched[(z / kChunkSize) * m_chunks_x + x / kChunkSize] = 1;
+    }
+  }
+
+  for (int chunk_z = 0; chunk_z < m_chunks_z; ++chunk_z) {
+    for (int chunk_x = 0; chunk_x < m_chunks_x; ++chunk_x) {
+      if (touched[chunk_z * m_chunks_x + chunk_x] != 0) {
+        rebuildChunk(chunk_x, chunk_z);
+      }
+    }
+  }
+}
+
 void FogRenderer::submit(Renderer &renderer, ResourceManager *resources) {
   if (!m_enabled) {
     return;
@@ -39,12 +100,28 @@ void FogRenderer::submit(Renderer &renderer, ResourceManager *resources) {
 
   (void)resources;
 
-  if (!m_instances.empty()) {
-    renderer.fogBatch(m_instances.data(), m_instances.size());
+  // Cells that faded out to visible keep an instance until the fade ends.
+  m_time = renderer.getAnimationTime();
+  for (int chunk_z = 0; chunk_z < m_chunks_z; ++chunk_z) {
+    for (int chunk_x = 0; chunk_x < m_chunks_x; ++chunk_x) {
+      const auto &chunk = m_chunks[chunk_z * m_chunks_x + chunk_x];
+      if (chunk.fade_until > 0.0F && m_time >= chunk.fade_until) {
+        rebuildChunk(chunk_x, chunk_z);
+      }
+    }
+  }
+  if (m_instances.empty()) {
+    return;
   }
+
+  uploadInstances();
+  drawRuns(renderer);
 }
 
 void FogRenderer::buildChunks() {
+  m_chunks.clear();
+  m_chunks_x = 0;
+  m_chunks_z = 0;
   m_instances.clear();
 
   if (m_width <= 0 || m_height <= 0) {
@@ -54,34 +131,128 @@ void FogRenderer::buildChunks() {
     return;
   }
 
-  QElapsedTimer timer;
-  timer.start();
-
-  const float half_tile = m_tile_size * 0.5F;
-  m_instances.reserve(static_cast<std::size_t>(m_width) * m_height);
+  m_chunks_x = (m_width + kChunkSize - 1) / kChunkSize;
+  m_chunks_z = (m_height + kChunkSize - 1) / kChunkSize;
+  m_chunks.resize(static_cast<std::size_t>(m_chunks_x) * m_chunks_z);
+  m_instances.resize(m_chunks.size() * kChunkSlots);
+  for (int chunk_z = 0; chunk_z < m_chunks_z; ++chunk_z) {
+    for (int chunk_x = 0; chunk_x < m_chunks_x; ++chunk_x) {
+      rebuildChunk(chunk_x, chunk_z);
+    }
+  }
+  m_upload_all = true;
+}
 
-  std::size_t total_quads = 0;
+void FogRenderer::rebuildChunk(int chunk_x, int chunk_z) {
+  const int chunk_idx = chunk_z * m_chunks_x + chunk_x;
+  auto &chunk = m_chunks[chunk_idx];
+  chunk.fade_until = 0.0F;
+  chunk.dirty = true;
+  auto *slot = m_instances.data() + chunk_idx * kChunkSlots;
+  auto *const slice_end = slot + kChunkSlots;
 
-  for (int z = 0; z < m_height; ++z) {
-    for (int x = 0; x < m_width; ++x) {
-      const std::uint8_t state = m_cells[z * m_width + x];
+  const int max_z = std::min((chunk_z + 1) * kChunkSize, m_height);
+  const int max_x = std::min((chunk_x + 1) * kChunkSize, m_width);
+  for (int z = chunk_z * kChunkSize; z < max_z; ++z) {
+    for (int x = chunk_x * kChunkSize; x < max_x; ++x) {
+      const int idx = z * m_width + x;
+      const std::uint8_t state = m_cells[idx];
+      const auto &fade = m_fades[idx];
+      std::uint8_t shade = state;
       if (state >= 2) {
-        continue;
+        const float fade_end = fade.start + kFadeDuration;
+        if (fade.from <= 0.0F || m_time >= fade_end) {
+          continue;
+        }
+        chunk.fade_until = std::max(chunk.fade_until, fade_end);
+        shade = fade.previous;
       }
 
-      FogInstance instance;
+      FogInstance &instance = *slot++;
       const float world_x = (x - m_half_width) * m_tile_size;
       const float world_z = (z - m_half_height) * m_tile_size;
       instance.center = QVector3D(world_x, 0.25F, world_z);
-      instance.color = (state == 0) ? QVector3D(0.02F, 0.02F, 0.05F)
-                                    : QVector3D(0.05F, 0.05F, 0.05F);
-      instance.alpha = (state == 0) ? 0.9F : 0.45F;
+      instance.color = stateColor(shade);
+      instance.alpha = stateAlpha(state);
       instance.size = m_tile_size;
+      instance.fade_from = fade.from;
+      instance.fade_start = fade.start;
+    }
+  }
+
+  chunk.live = static_cast<std::size_t>(slot - (slice_end - kChunkSlots));
+
+  // Unused slots collapse to nothing in the vertex shader.
+  FogInstance empty;
+  empty.size = 0.0F;
+  empty.alpha = 0.0F;
+  empty.fade_from = 0.0F;
+  std::fill(slot, slice_end, empty);
+}
+
+void FogRenderer::uploadInstances() {
+  if (!m_instanceBuffer) {
+    m_instanceBuffer = std::make_unique<Buffer>(Buffer::Type::Vertex);
+    m_upload_all = true;
+  }
+  if (m_upload_all) {
+    m_instanceBuffer->setData(m_instances, Buffer::Usage::Dynamic);
+    for (auto &chunk : m_chunks) {
+      chunk.dirty = false;
+    }
+    m_upload_all = false;
+    return;
+  }
 
-      m_instances.push_back(instance);
-      ++total_quads;
+  // Neighbouring dirty chunks have neighbouring slices; send each run once.
+  std::size_t const chunk_bytes = kChunkSlots * sizeof(FogInstance);
+  std::size_t run_start = 0;
+  std::size_t run_length = 0;
+  for (std::size_t idx = 0; idx <= m_chunks.size(); ++idx) {
+    if (idx < m_chunks.size() && m_chunks[idx].dirty) {
+      if (run_length == 0) {
+        run_start = idx;
+      }
+      ++run_length;
+      m_chunks[idx].dirty = false;
+      continue;
+    }
+    if (run_length > 0) {
+      m_instanceBuffer->setSubData(run_start * chunk_bytes,
+                                   m_instances.data() + run_start * kChunkSlots,
+                                   run_length * chunk_bytes);
+      run_length = 0;
     }
   }
 }
 
+void FogRenderer::drawRuns(Renderer &renderer) {
+  // Each run of neighbouring chunks with live instances is one draw, from
+  // the start of its first slice to the last live instance of its last.
+  // Fully visible chunks end a run and cost nothing; only the padding of
+  // partly fogged chunks inside a run still reaches the vertex shader.
+  std::size_t run_start = 0;
+  std::size_t run_end = 0;
+  for (std::size_t idx = 0; idx <= m_chunks.size(); ++idx) {
+    if (idx < m_chunks.size() && m_chunks[idx].live > 0) {
+      if (run_end == 0) {
+        run_start = idx * kChunkSlots;
+      }
+      run_end = idx * kChunkSlots + m_chunks[idx].live;
+      continue;
+    }
+    if (run_end > 0) {
+      renderer.fogBatch(m_instanceBuffer.get(), run_start,
+                        run_end - run_start, m_time, kFadeDuration);
+      run_end = 0;
+    }
+  }
+}
+
+auto FogRenderer::displayedAlpha(int idx) const -> float {
+  const auto &fade = m_fades[idx];
+  const float t = std::clamp((m_time - fade.start) / kFadeDuration, 0.0F, 1.0F);
+  return fade.from + (stateAlpha(m_cells[idx]) - fade.from) * t;
+}
+
 } // namespace Render::GL
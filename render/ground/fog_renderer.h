@@ -4,6 +4,8 @@
 #include "../i_render_pass.h"
 #include <QMatrix4x4>
 #include <QVector3D>
+#include <algorithm>
+#include <cstddef>
 #include <cstdint>
 #include <memory>
 #include <vector>
@@ -11,25 +13,61 @@
 namespace Render::GL {
 class Renderer;
 class ResourceManager;
+class Buffer;
 
 class FogRenderer : public IRenderPass {
 public:
-  FogRenderer() = default;
-  ~FogRenderer() override = default;
+  FogRenderer();
+  ~FogRenderer() override;
 
   void setEnabled(bool enabled) { m_enabled = enabled; }
   [[nodiscard]] auto isEnabled() const -> bool { return m_enabled; }
 
   void updateMask(int width, int height, float tile_size,
                   const std::vector<std::uint8_t> &cells);
+  // Applies one changed rectangle of the mask, `cells` holding its rows in
+  // order. Only the chunks it touches are rebuilt, and cells that changed
+  // state fade in the shader instead of popping.
+  void updateRegion(int min_x, int min_z, int max_x, int max_z,
+                    const std::vector<std::uint8_t> &cells);
+  // True when the current mask was built for this grid and tile size, so
+  // updateRegion can patch it; otherwise the caller rebuilds it whole.
+  [[nodiscard]] auto hasMask(int width, int height, float tile_size) const
+      -> bool {
+    return m_width == width && m_height == height &&
+           m_tile_size == std::max(kMinTileSize, tile_size) &&
+           !m_cells.empty();
+  }
 
   void submit(Renderer &renderer, ResourceManager *resources) override;
 
 private:
-  void buildChunks();
-
   using FogInstance = FogInstanceData;
 
+  static constexpr float kMinTileSize = 0.0001F;
+  static constexpr int kChunkSize = 16;
+  static constexpr std::size_t kChunkSlots = kChunkSize * kChunkSize;
+  static constexpr float kFadeDuration = 0.35F;
+
+  struct CellFade {
+    float from = 0.0F;
+    float start = 0.0F;
+    std::uint8_t previous = 0;
+  };
+
+  struct Chunk {
+    float fade_until = 0.0F;
+    // Instances written at the front of the chunk's slice.
+    std::size_t live = 0;
+    bool dirty = false;
+  };
+
+  void buildChunks();
+  void rebuildChunk(int chunk_x, int chunk_z);
+  void uploadInstances();
+  void drawRuns(Renderer &renderer);
+  [[nodiscard]] auto displayedAlpha(int idx) const -> float;
+
   bool m_enabled = true;
   int m_width = 0;
   int m_height = 0;
@@ -37,7 +75,16 @@ private:
   float m_half_width = 0.0F;
   float m_half_height = 0.0F;
   std::vector<std::uint8_t> m_cells;
+  std::vector<CellFade> m_fades;
+  std::vector<Chunk> m_chunks;
+  int m_chunks_x = 0;
+  int m_chunks_z = 0;
+  float m_time = 0.0F;
+  // Each chunk owns a fixed slice of kChunkSlots instances, padded with
+  // empty ones, so a rebuilt chunk is uploaded in place.
   std::vector<FogInstance> m_instances;
+  bool m_upload_all = false;
+  std::unique_ptr<Buffer> m_instanceBuffer;
 };
 
 } // namespace Render::GL
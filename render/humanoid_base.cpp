@@ -143,7 +143,7 @@ auto HumanoidRendererBase::sampleAnimState(const DrawContext &ctx)
     bool target_in_range = false;
 
     if (ctx.world != nullptr) {
-      auto *target = ctx.world->getEntity(attack_target->target_id);
+      auto *target = ctx.world->getLiveEntity(attack_target->target_id);
       if (target != nullptr) {
         auto *target_transform =
             target->getComponent<Engine::Core::TransformComponent>();
@@ -6,6 +6,7 @@
 #include "draw_queue.h"
 #include "entity/registry.h"
 #include "game/core/component.h"
+#include "game/core/profiler.h"
 #include "game/core/world.h"
 #include "gl/backend.h"
 #include "gl/buffer.h"
@@ -141,13 +142,19 @@ void Renderer::cylinder(const QVector3D &start, const QVector3D &end,
   }
 }
 
-void Renderer::fogBatch(const FogInstanceData *instances, std::size_t count) {
-  if ((instances == nullptr) || count == 0 || (m_activeQueue == nullptr)) {
+void Renderer::fogBatch(Buffer *instanceBuffer, std::size_t first_instance,
+                        std::size_t instance_count, float time,
+                        float fade_duration) {
+  if ((instanceBuffer == nullptr) || instance_count == 0 ||
+      (m_activeQueue == nullptr)) {
     return;
   }
   FogBatchCmd cmd;
-  cmd.instances = instances;
-  cmd.count = count;
+  cmd.instanceBuffer = instanceBuffer;
+  cmd.first_instance = first_instance;
+  cmd.instance_count = instance_count;
+  cmd.time = time;
+  cmd.fade_duration = fade_duration;
   m_activeQueue->submit(cmd);
 }
 
@@ -318,6 +325,7 @@ void Renderer::enqueueSelectionRing(Engine::Core::Entity *,
 }
 
 void Renderer::renderWorld(Engine::Core::World *world) {
+  Engine::Core::ProfileZone const zone("Renderer::renderWorld");
   if (m_paused.load()) {
     return;
   }
@@ -325,20 +333,19 @@ void Renderer::renderWorld(Engine::Core::World *world) {
     return;
   }
 
+  // World::update() has already joined its stages on this thread, but the
+  // QML handlers (selection, orders) still write to the world from the GUI
+  // thread outside synchronize(), so the frame holds the world lock.
   std::lock_guard<std::recursive_mutex> const guard(world->getEntityMutex());
 
   auto &vis = Game::Map::VisibilityService::instance();
   const bool visibility_enabled = vis.isInitialized();
 
-  auto renderable_entities =
-      world->getEntitiesWith<Engine::Core::RenderableComponent>();
+  auto renderable_entities = world->query<Engine::Core::RenderableComponent>(
+      Engine::Core::Without<Engine::Core::PendingRemovalComponent>{});
 
   for (auto *entity : renderable_entities) {
 
-    if (entity->hasComponent<Engine::Core::PendingRemovalComponent>()) {
-      continue;
-    }
-
     auto *renderable =
         entity->getComponent<Engine::Core::RenderableComponent>();
     auto *transform = entity->getComponent<Engine::Core::TransformComponent>();
@@ -132,7 +132,8 @@ public:
   void lockWorldForModification() { m_worldMutex.lock(); }
   void unlockWorldForModification() { m_worldMutex.unlock(); }
 
-  void fogBatch(const FogInstanceData *instances, std::size_t count);
+  void fogBatch(Buffer *instanceBuffer, std::size_t first_instance,
+                std::size_t instance_count, float time, float fade_duration);
   void grassBatch(Buffer *instanceBuffer, std::size_t instance_count,
                   const GrassBatchParams &params);
   void stoneBatch(Buffer *instanceBuffer, std::size_t instance_count,
@@ -0,0 +1,147 @@
+#include "core/event_manager.h"
+#include "core/event_ring.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdio>
+#include <span>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr std::size_t k_overfill = 3000;
+constexpr std::size_t k_threaded_events = 200000;
+constexpr int k_threaded_rounds = 20;
+
+using Engine::Core::EventManager;
+using Engine::Core::UnitMovedEvent;
+
+// Receives deferred UnitMovedEvent batches whose x carries a sequence
+// number and checks that every number arrives once and in order.
+class OrderCheck {
+public:
+  OrderCheck()
+      : m_handle(EventManager::instance().subscribeDeferred<UnitMovedEvent>(
+            [this](std::span<const UnitMovedEvent> batch) {
+              for (const auto &event : batch) {
+                auto const sequence = static_cast<std::size_t>(event.x);
+                if (sequence != m_next && m_firstError == 0) {
+                  m_firstError = m_next + 1;
+                }
+                m_next = sequence + 1;
+              }
+            })) {}
+
+  ~OrderCheck() {
+    EventManager::instance().unsubscribe<UnitMovedEvent>(m_handle);
+  }
+
+  OrderCheck(const OrderCheck &) = delete;
+  OrderCheck(OrderCheck &&) = delete;
+  auto operator=(const OrderCheck &) -> OrderCheck & = delete;
+  auto operator=(OrderCheck &&) -> OrderCheck & = delete;
+
+  [[nodiscard]] auto received() const -> std::size_t { return m_next; }
+  // The sequence number expected where the order first broke, plus one, or
+  // zero while it held.
+  [[nodiscard]] auto firstError() const -> std::size_t { return m_firstError; }
+
+private:
+  Engine::Core::SubscriptionHandle m_handle;
+  std::size_t m_next = 0;
+  std::size_t m_firstError = 0;
+};
+
+void publish(std::size_t sequence) {
+  EventManager::instance().publish(
+      UnitMovedEvent(0, static_cast<float>(sequence), 0.0F));
+}
+
+auto checkRingCapacity() -> bool {
+  Engine::Core::EventRing<int> ring(3);
+  if (ring.capacity() != 4) {
+    std::fprintf(stderr, "a ring asked for 3 slots holds %zu\n",
+                 ring.capacity());
+    return false;
+  }
+  for (int i = 0; i < 4; ++i) {
+    if (!ring.tryPush(i)) {
+      std::fprintf(stderr, "ring rejected push %d of 4\n", i);
+      return false;
+    }
+  }
+  if (ring.tryPush(4)) {
+    std::fprintf(stderr, "full ring accepted a fifth push\n");
+    return false;
+  }
+  int expected = 0;
+  bool ordered = true;
+  ring.drain([&](int &&value) { ordered = ordered && value == expected++; });
+  if (!ordered || expected != 4) {
+    std::fprintf(stderr, "ring drained out of order\n");
+    return false;
+  }
+  return true;
+}
+
+// Publishes more events than the ring holds before one dispatch, so the
+// tail goes through the overflow.
+auto checkOverfill() -> bool {
+  OrderCheck check;
+  for (std::size_t i = 0; i < k_overfill; ++i) {
+    publish(i);
+  }
+  EventManager::instance().dispatchDeferred();
+  if (check.firstError() != 0 || check.received() != k_overfill) {
+    std::fprintf(stderr,
+                 "overfilled ring dispatched %zu of %zu events, order broke "
+                 "at %zu\n",
+                 check.received(), k_overfill, check.firstError());
+    return false;
+  }
+  return true;
+}
+
+// One thread publishes while this one dispatches, so drains free ring space
+// while earlier events still wait in the overflow.
+auto checkThreaded() -> bool {
+  for (int round = 0; round < k_threaded_rounds; ++round) {
+    OrderCheck check;
+    std::atomic<bool> done{false};
+    std::thread producer([&done] {
+      for (std::size_t i = 0; i < k_threaded_events; ++i) {
+        publish(i);
+      }
+      done.store(true, std::memory_order_release);
+    });
+    while (!done.load(std::memory_order_acquire)) {
+      EventManager::instance().dispatchDeferred();
+    }
+    producer.join();
+    EventManager::instance().dispatchDeferred();
+    if (check.firstError() != 0 || check.received() != k_threaded_events) {
+      std::fprintf(stderr,
+                   "round %d dispatched %zu of %zu events, order broke at "
+                   "%zu\n",
+                   round, check.received(), k_threaded_events,
+                   check.firstError());
+      return false;
+    }
+  }
+  return true;
+}
+
+} // namespace
+
+// Checks that deferred events keep their publish order through the ring and
+// its overflow, on one thread and with a producer racing the dispatches.
+// Exits non-zero on the first failure.
+auto main() -> int {
+  if (!checkRingCapacity() || !checkOverfill() || !checkThreaded()) {
+    return 1;
+  }
+  auto const stats = EventManager::instance().getStats<UnitMovedEvent>();
+  std::printf("deferred events kept their order; %zu of %zu overflowed\n",
+              stats.overflowCount, stats.publishCount);
+  return 0;
+}
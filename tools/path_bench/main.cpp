@@ -0,0 +1,152 @@
+#include "map/map_definition.h"
+#include "map/map_loader.h"
+#include "map/terrain_service.h"
+#include "systems/pathfinding.h"
+#include <QCoreApplication>
+#include <QDir>
+#include <QString>
+#include <QStringList>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace {
+
+constexpr int k_queries_per_map = 500;
+constexpr std::uint32_t k_query_seed = 1337;
+constexpr int k_max_query_attempts = 100000;
+
+using Game::Systems::Pathfinding;
+using Game::Systems::Point;
+using Game::Systems::SearchMode;
+
+struct Query {
+  Point start;
+  Point end;
+};
+
+struct ModeResult {
+  double total_ms = 0.0;
+  std::size_t expanded = 0;
+  std::size_t found = 0;
+  std::size_t steps = 0;
+};
+
+auto makeQueries(Pathfinding &pathfinder, int width,
+                 int height) -> std::vector<Query> {
+  std::mt19937 rng(k_query_seed);
+  std::uniform_int_distribution<int> pick_x(0, width - 1);
+  std::uniform_int_distribution<int> pick_y(0, height - 1);
+  auto random_walkable = [&]() {
+    for (int attempt = 0; attempt < k_max_query_attempts; ++attempt) {
+      Point const cell{pick_x(rng), pick_y(rng)};
+      if (pathfinder.isWalkable(cell.x, cell.y)) {
+        return cell;
+      }
+    }
+    return Point{-1, -1};
+  };
+
+  std::vector<Query> queries;
+  queries.reserve(k_queries_per_map);
+  for (int i = 0; i < k_queries_per_map; ++i) {
+    Query const query{random_walkable(), random_walkable()};
+    if (query.start.x < 0 || query.end.x < 0) {
+      break;
+    }
+    queries.push_back(query);
+  }
+  return queries;
+}
+
+auto runQueries(Pathfinding &pathfinder, SearchMode mode,
+                const std::vector<Query> &queries) -> ModeResult {
+  pathfinder.setSearchMode(mode);
+  // The first search publishes the snapshot (and the jump table) for the
+  // mode, which should not count against it.
+  pathfinder.findPath(queries.front().start, queries.front().start);
+
+  ModeResult result;
+  for (const auto &query : queries) {
+    auto const begin = std::chrono::steady_clock::now();
+    auto const path = pathfinder.findPath(query.start, query.end);
+    auto const end = std::chrono::steady_clock::now();
+    result.total_ms +=
+        std::chrono::duration<double, std::milli>(end - begin).count();
+    result.expanded += pathfinder.lastSearchExpansions();
+    if (!path.empty()) {
+      ++result.found;
+      result.steps += path.size() - 1;
+    }
+  }
+  return result;
+}
+
+void printResult(const char *label, const ModeResult &result,
+                 std::size_t query_count) {
+  double const count = static_cast<double>(query_count);
+  std::printf("  %-10s %9.3f ms total %8.4f ms/query %10.1f nodes/query "
+              "%6zu found %9zu steps\n",
+              label, result.total_ms, result.total_ms / count,
+              static_cast<double>(result.expanded) / count, result.found,
+              result.steps);
+}
+
+} // namespace
+
+// Compares nodes expanded and wall time of A* (with the hierarchical layer)
+// and JPS+ on the same random queries. Maps default to assets/maps/*.json
+// relative to the working directory.
+auto main(int argc, char *argv[]) -> int {
+  QCoreApplication const app(argc, argv);
+
+  QStringList maps = QCoreApplication::arguments().mid(1);
+  if (maps.isEmpty()) {
+    QDir const dir(QStringLiteral("assets/maps"));
+    for (const auto &entry :
+         dir.entryList({QStringLiteral("*.json")}, QDir::Files, QDir::Name)) {
+      maps << dir.filePath(entry);
+    }
+  }
+  if (maps.isEmpty()) {
+    std::fprintf(stderr, "usage: path_bench [map.json...]\n");
+    return 1;
+  }
+
+  for (const auto &map_path : maps) {
+    Game::Map::MapDefinition definition;
+    QString error;
+    if (!Game::Map::MapLoader::loadFromJsonFile(map_path, definition,
+                                                &error)) {
+      std::fprintf(stderr, "%s: %s\n", qPrintable(map_path),
+                   qPrintable(error));
+      continue;
+    }
+
+    Game::Map::TerrainService::instance().initialize(definition);
+    int const width = definition.grid.width;
+    int const height = definition.grid.height;
+    Pathfinding pathfinder(width, height, 1);
+    pathfinder.updateBuildingObstacles();
+
+    auto const queries = makeQueries(pathfinder, width, height);
+    if (queries.empty()) {
+      std::fprintf(stderr, "%s: no walkable cells\n", qPrintable(map_path));
+      continue;
+    }
+
+    std::printf("%s (%dx%d, %zu queries)\n", qPrintable(map_path), width,
+                height, queries.size());
+    printResult("A*", runQueries(pathfinder, SearchMode::AStar, queries),
+                queries.size());
+    printResult("JPS+", runQueries(pathfinder, SearchMode::JumpPoint, queries),
+                queries.size());
+  }
+
+  Game::Map::TerrainService::instance().clear();
+  return 0;
+}
@@ -0,0 +1,238 @@
+#include "core/component.h"
+#include "core/entity.h"
+#include "core/job_system.h"
+#include "core/ownership_constants.h"
+#include "core/profiler.h"
+#include "core/system.h"
+#include "core/world.h"
+#include "systems/capture_system.h"
+#include "systems/cleanup_system.h"
+#include "systems/patrol_system.h"
+#include "systems/spatial_index_system.h"
+#include "units/spawn_type.h"
+#include <QCoreApplication>
+#include <QString>
+#include <QStringList>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace {
+
+constexpr int k_units = 20000;
+constexpr int k_barracks = 200;
+constexpr int k_owners = 4;
+constexpr float k_map_side = 512.0F;
+constexpr int k_frames = 21;
+constexpr float k_frame_time = 0.5F;
+constexpr int k_parallel_runs = 3;
+constexpr int k_churn_per_frame = 64;
+constexpr std::uint32_t k_seed = 1337;
+
+using Engine::Core::Entity;
+using Engine::Core::System;
+using Engine::Core::SystemAccess;
+using Engine::Core::World;
+
+// Creates short-lived entities through the command buffer each frame. Two
+// of them share a stage, so their creates race for ids unless ids are
+// assigned at playback.
+class ChurnSystem : public System {
+public:
+  explicit ChurnSystem(float x) : m_x(x) {}
+
+  void update(World *world, float /*deltaTime*/) override {
+    auto &commands = world->commands();
+    for (int i = 0; i < k_churn_per_frame; ++i) {
+      auto const entity_id = commands.createEntity();
+      commands.addComponent<Engine::Core::TransformComponent>(
+          entity_id, m_x, 0.0F, static_cast<float>(i));
+      commands.addComponent<Engine::Core::PendingRemovalComponent>(entity_id);
+    }
+  }
+
+  [[nodiscard]] auto access() const -> SystemAccess override {
+    return SystemAccess{}.read<Engine::Core::TransformComponent>();
+  }
+
+private:
+  float m_x;
+};
+
+// Runs a system with its default, exclusive access so the scheduler gives
+// it a stage of its own: the sequential reference.
+class Sequential : public System {
+public:
+  explicit Sequential(std::unique_ptr<System> inner)
+      : m_inner(std::move(inner)) {}
+
+  void update(World *world, float deltaTime) override {
+    m_inner->update(world, deltaTime);
+  }
+
+private:
+  std::unique_ptr<System> m_inner;
+};
+
+void populate(World &world) {
+  std::mt19937 rng(k_seed);
+  std::uniform_real_distribution<float> pick(0.0F, k_map_side);
+
+  for (int i = 0; i < k_barracks; ++i) {
+    auto *barrack = world.createEntity();
+    barrack->addComponent<Engine::Core::TransformComponent>(pick(rng), 0.0F,
+                                                            pick(rng));
+    barrack->addComponent<Engine::Core::RenderableComponent>("", "");
+    barrack->addComponent<Engine::Core::BuildingComponent>();
+    auto *unit = barrack->addComponent<Engine::Core::UnitComponent>();
+    unit->spawn_type = Game::Units::SpawnType::Barracks;
+    world.setUnitOwner(*barrack, Game::Core::NEUTRAL_OWNER_ID);
+  }
+
+  for (int i = 0; i < k_units; ++i) {
+    auto *entity = world.createEntity();
+    float const x = pick(rng);
+    float const z = pick(rng);
+    entity->addComponent<Engine::Core::TransformComponent>(x, 0.0F, z);
+    entity->addComponent<Engine::Core::MovementComponent>();
+    entity->addComponent<Engine::Core::UnitComponent>();
+    world.setUnitOwner(*entity, 1 + i % k_owners);
+    auto *patrol = entity->addComponent<Engine::Core::PatrolComponent>();
+    patrol->waypoints = {{x, z}, {pick(rng), pick(rng)}};
+    patrol->patrolling = true;
+  }
+}
+
+// Cleanup runs ahead of the churn systems, so it destroys the previous
+// frame's entities whether or not it shares their stage.
+void addSystems(World &world, bool sequential) {
+  std::vector<std::unique_ptr<System>> systems;
+  systems.push_back(std::make_unique<Game::Systems::SpatialIndexSystem>());
+  systems.push_back(std::make_unique<Game::Systems::PatrolSystem>());
+  systems.push_back(std::make_unique<Game::Systems::CaptureSystem>());
+  systems.push_back(std::make_unique<Game::Systems::CleanupSystem>());
+  systems.push_back(std::make_unique<ChurnSystem>(-1.0F));
+  systems.push_back(std::make_unique<ChurnSystem>(-2.0F));
+  for (auto &system : systems) {
+    if (sequential) {
+      system = std::make_unique<Sequential>(std::move(system));
+    }
+    world.addSystem(std::move(system));
+  }
+}
+
+template <typename T> void mix(std::uint64_t &hash, const T &value) {
+  unsigned char bytes[sizeof(T)];
+  std::memcpy(bytes, &value, sizeof(T));
+  for (unsigned char const byte : bytes) {
+    hash = (hash ^ byte) * 0x100000001b3ULL;
+  }
+}
+
+// FNV-1a over every entity, in id order, and the state the systems above
+// change.
+auto digest(World &world) -> std::uint64_t {
+  std::vector<Entity *> entities;
+  world.forEachEntity([&](Entity &entity) { entities.push_back(&entity); });
+  std::sort(entities.begin(), entities.end(),
+            [](const Entity *a, const Entity *b) {
+              return a->getId() < b->getId();
+            });
+
+  std::uint64_t hash = 0xcbf29ce484222325ULL;
+  for (auto *entity : entities) {
+    mix(hash, entity->getId());
+    if (auto *transform =
+            entity->getComponent<Engine::Core::TransformComponent>()) {
+      mix(hash, transform->position.x);
+      mix(hash, transform->position.z);
+    }
+    if (auto *unit = entity->getComponent<Engine::Core::UnitComponent>()) {
+      mix(hash, unit->owner_id);
+    }
+    if (auto *movement =
+            entity->getComponent<Engine::Core::MovementComponent>()) {
+      mix(hash, movement->target_x);
+      mix(hash, movement->target_y);
+    }
+    if (auto *target =
+            entity->getComponent<Engine::Core::AttackTargetComponent>()) {
+      mix(hash, target->target_id);
+    }
+    if (auto *capture =
+            entity->getComponent<Engine::Core::CaptureComponent>()) {
+      mix(hash, capture->capturing_player_id);
+      mix(hash, capture->captureProgress);
+    }
+    mix(hash, entity->hasComponent<Engine::Core::PendingRemovalComponent>());
+  }
+  return hash;
+}
+
+auto runScenario(bool sequential) -> std::vector<std::uint64_t> {
+  World world;
+  populate(world);
+  addSystems(world, sequential);
+
+  std::vector<std::uint64_t> digests;
+  digests.reserve(k_frames);
+  for (int frame = 0; frame < k_frames; ++frame) {
+    world.update(k_frame_time);
+    digests.push_back(digest(world));
+  }
+  return digests;
+}
+
+} // namespace
+
+// Runs the spatial index, patrol, capture and cleanup systems through
+// World::update, once with every system in a stage of its own and then
+// several times with the scheduler's parallel stages, and checks that the
+// world matches after every frame. Exits non-zero on the first mismatch.
+// An optional argument names a Chrome trace to write for the last run.
+// Build with -fsanitize=thread (make check-schedule-tsan) to race-check it.
+auto main(int argc, char *argv[]) -> int {
+  QCoreApplication const app(argc, argv);
+  QStringList const args = QCoreApplication::arguments().mid(1);
+
+  std::printf("%d units, %d barracks, %d frames, %zu job workers\n", k_units,
+              k_barracks, k_frames,
+              Engine::Core::JobSystem::instance().workerCount());
+
+  auto const reference = runScenario(true);
+  for (int run = 0; run < k_parallel_runs; ++run) {
+    bool const traced = !args.isEmpty() && run + 1 == k_parallel_runs;
+    if (traced) {
+      Engine::Core::Profiler::setEnabled(true);
+      Engine::Core::Profiler::instance().setThreadName("Main");
+    }
+    auto const parallel = runScenario(false);
+    if (traced) {
+      Engine::Core::Profiler::setEnabled(false);
+      if (!Engine::Core::Profiler::instance().saveChromeTrace(args.front())) {
+        std::fprintf(stderr, "could not write %s\n",
+                     qPrintable(args.front()));
+      }
+    }
+
+    for (std::size_t frame = 0; frame < reference.size(); ++frame) {
+      if (parallel[frame] != reference[frame]) {
+        std::fprintf(stderr,
+                     "parallel run %d differs from the sequential run "
+                     "after frame %zu\n",
+                     run, frame);
+        return 1;
+      }
+    }
+  }
+
+  std::printf("%d parallel runs match the sequential run on every frame\n",
+              k_parallel_runs);
+  return 0;
+}
@@ -0,0 +1,264 @@
+#include "map/vision_raster.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace {
+
+constexpr int k_check_cases = 200000;
+constexpr int k_max_check_side = 96;
+constexpr std::uint32_t k_check_seed = 1337;
+constexpr int k_bench_side = 256;
+constexpr int k_bench_sources = 4000;
+constexpr int k_bench_rounds = 20;
+
+using Game::Map::addToSpan;
+using Game::Map::addToSpanScalar;
+using Game::Map::forEachSpanInRange;
+
+// One vision source on one grid, with the radius and padded range the
+// visibility service derives from a unit's vision range.
+struct Case {
+  int width = 0;
+  int height = 0;
+  float tile_size = 1.0F;
+  int center_x = 0;
+  int center_z = 0;
+  int cell_radius = 0;
+  float range_sq = 0.0F;
+};
+
+auto makeCase(int width, int height, float tile_size, float vision_range,
+              int center_x, int center_z) -> Case {
+  float const padded = vision_range + tile_size * 0.5F;
+  int const radius =
+      std::max(1, static_cast<int>(std::ceil(vision_range / tile_size)));
+  return {width,  height, tile_size, center_x, center_z,
+          radius, padded * padded};
+}
+
+// The per-cell distance test the spans replace: every cell of the clamped
+// bounding square, kept when its centre lies within range.
+template <typename Visit>
+void forEachCellInRange(const Case &c, Visit &&visit) {
+  int const min_z = std::max(c.center_z - c.cell_radius, 0);
+  int const max_z = std::min(c.center_z + c.cell_radius, c.height - 1);
+  int const min_x = std::max(c.center_x - c.cell_radius, 0);
+  int const max_x = std::min(c.center_x + c.cell_radius, c.width - 1);
+  for (int grid_z = min_z; grid_z <= max_z; ++grid_z) {
+    float const world_dz =
+        static_cast<float>(grid_z - c.center_z) * c.tile_size;
+    for (int grid_x = min_x; grid_x <= max_x; ++grid_x) {
+      float const world_dx =
+          static_cast<float>(grid_x - c.center_x) * c.tile_size;
+      if (world_dx * world_dx + world_dz * world_dz <= c.range_sq) {
+        visit(grid_z * c.width + grid_x);
+      }
+    }
+  }
+}
+
+template <typename VisitSpan>
+void forEachSpan(const Case &c, VisitSpan &&visit) {
+  forEachSpanInRange(c.center_x, c.center_z, c.cell_radius, c.range_sq,
+                     c.width, c.height, c.tile_size, visit);
+}
+
+void printCase(const Case &c) {
+  std::fprintf(stderr,
+               "  grid %dx%d tile %.4f centre (%d, %d) radius %d "
+               "range_sq %.4f\n",
+               c.width, c.height, static_cast<double>(c.tile_size),
+               c.center_x, c.center_z, c.cell_radius,
+               static_cast<double>(c.range_sq));
+}
+
+// Checks that the spans cover exactly the cells the per-cell test accepts,
+// once each, and that both count updates agree on counts and crossings.
+// Starting counts include zeros and the 16-bit wrap point.
+auto checkCase(const Case &c, std::mt19937 &rng) -> bool {
+  auto const cell_count = static_cast<std::size_t>(c.width) * c.height;
+  std::vector<std::uint8_t> expected(cell_count, 0);
+  forEachCellInRange(c, [&](int idx) { expected[idx] = 1; });
+
+  std::vector<std::uint8_t> covered(cell_count, 0);
+  bool overlapped = false;
+  int last_row = -1;
+  forEachSpan(c, [&](int first_idx, int length) {
+    int const row = first_idx / c.width;
+    overlapped = overlapped || row <= last_row ||
+                 first_idx % c.width + length > c.width;
+    last_row = row;
+    for (int idx = first_idx; idx < first_idx + length; ++idx) {
+      overlapped = overlapped || covered[idx] != 0;
+      covered[idx] = 1;
+    }
+  });
+  if (overlapped || covered != expected) {
+    std::fprintf(stderr, "span coverage differs from the per-cell test\n");
+    printCase(c);
+    return false;
+  }
+
+  static constexpr std::uint16_t k_seeds[] = {0, 0, 1, 2, 0xFFFF};
+  std::uniform_int_distribution<int> pick_seed(0, 4);
+  std::vector<std::uint16_t> scalar(cell_count);
+  for (auto &count : scalar) {
+    count = k_seeds[pick_seed(rng)];
+  }
+  std::vector<std::uint16_t> simd = scalar;
+
+  for (int const delta : {1, -1}) {
+    std::vector<int> scalar_crossings;
+    std::vector<int> simd_crossings;
+    forEachSpan(c, [&](int first_idx, int length) {
+      addToSpanScalar(scalar.data() + first_idx, first_idx, length, delta,
+                      scalar_crossings);
+      addToSpan(simd.data() + first_idx, first_idx, length, delta,
+                simd_crossings);
+    });
+    if (simd != scalar || simd_crossings != scalar_crossings) {
+      std::fprintf(stderr, "addToSpan differs from the scalar update "
+                           "(delta %d)\n",
+                   delta);
+      printCase(c);
+      return false;
+    }
+  }
+  return true;
+}
+
+// Sources centred on and just past every border and corner, with ranges
+// that land exactly on cell centres so the edge rows hit the equality case.
+auto borderCases() -> std::vector<Case> {
+  std::vector<Case> cases;
+  for (int const side : {1, 2, 7, 8, 9, 17, 64}) {
+    for (float const range : {1.0F, 3.0F, 5.0F, 12.0F}) {
+      for (int const cz : {-3, -1, 0, side / 2, side - 1, side, side + 2}) {
+        for (int const cx : {-3, -1, 0, side / 2, side - 1, side, side + 2}) {
+          cases.push_back(makeCase(side, side, 1.0F, range, cx, cz));
+          Case exact = makeCase(side, side, 1.0F, range, cx, cz);
+          exact.range_sq = range * range;
+          cases.push_back(exact);
+        }
+      }
+    }
+  }
+  return cases;
+}
+
+auto runChecks() -> bool {
+  std::mt19937 rng(k_check_seed);
+  std::size_t checked = 0;
+  for (const auto &c : borderCases()) {
+    if (!checkCase(c, rng)) {
+      return false;
+    }
+    ++checked;
+  }
+
+  std::uniform_int_distribution<int> pick_side(1, k_max_check_side);
+  std::uniform_real_distribution<float> pick_tile(0.3F, 2.5F);
+  std::uniform_real_distribution<float> pick_range(1.0F, 24.0F);
+  for (int i = 0; i < k_check_cases; ++i) {
+    int const width = pick_side(rng);
+    int const height = pick_side(rng);
+    // Centres may sit a few cells off the map to clip the circle.
+    std::uniform_int_distribution<int> pick_x(-6, width + 5);
+    std::uniform_int_distribution<int> pick_z(-6, height + 5);
+    Case const c = makeCase(width, height, pick_tile(rng), pick_range(rng),
+                            pick_x(rng), pick_z(rng));
+    if (!checkCase(c, rng)) {
+      return false;
+    }
+    ++checked;
+  }
+  std::printf("checked %zu sources: spans and addToSpan match the per-cell "
+              "test\n",
+              checked);
+  return true;
+}
+
+template <typename Stamp>
+auto timeStamps(const std::vector<Case> &sources, Stamp &&stamp) -> double {
+  std::vector<std::uint16_t> counts(
+      static_cast<std::size_t>(k_bench_side) * k_bench_side, 0);
+  std::vector<int> crossings;
+  auto const begin = std::chrono::steady_clock::now();
+  for (int round = 0; round < k_bench_rounds; ++round) {
+    for (int const delta : {1, -1}) {
+      for (const auto &c : sources) {
+        crossings.clear();
+        stamp(c, counts.data(), delta, crossings);
+      }
+    }
+  }
+  auto const end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::milli>(end - begin).count() /
+         k_bench_rounds;
+}
+
+void runBench() {
+  std::mt19937 rng(k_check_seed);
+  std::uniform_int_distribution<int> pick_cell(0, k_bench_side - 1);
+  std::uniform_real_distribution<float> pick_range(12.0F, 20.0F);
+  std::vector<Case> sources;
+  sources.reserve(k_bench_sources);
+  for (int i = 0; i < k_bench_sources; ++i) {
+    sources.push_back(makeCase(k_bench_side, k_bench_side, 1.0F,
+                               pick_range(rng), pick_cell(rng),
+                               pick_cell(rng)));
+  }
+
+  double const per_cell = timeStamps(
+      sources, [](const Case &c, std::uint16_t *counts, int delta,
+                  std::vector<int> &crossings) {
+        forEachCellInRange(c, [&](int idx) {
+          addToSpanScalar(counts + idx, idx, 1, delta, crossings);
+        });
+      });
+  double const spans_scalar = timeStamps(
+      sources, [](const Case &c, std::uint16_t *counts, int delta,
+                  std::vector<int> &crossings) {
+        forEachSpan(c, [&](int first_idx, int length) {
+          addToSpanScalar(counts + first_idx, first_idx, length, delta,
+                          crossings);
+        });
+      });
+  double const spans_simd = timeStamps(
+      sources, [](const Case &c, std::uint16_t *counts, int delta,
+                  std::vector<int> &crossings) {
+        forEachSpan(c, [&](int first_idx, int length) {
+          addToSpan(counts + first_idx, first_idx, length, delta, crossings);
+        });
+      });
+
+  std::printf("%dx%d grid, %d sources stamped and removed per round\n",
+              k_bench_side, k_bench_side, k_bench_sources);
+  std::printf("  %-14s %9.3f ms/round\n", "per-cell", per_cell);
+  std::printf("  %-14s %9.3f ms/round\n", "spans scalar", spans_scalar);
+#ifdef VISIBILITY_USE_SSE2
+  std::printf("  %-14s %9.3f ms/round\n", "spans sse2", spans_simd);
+#else
+  std::printf("  %-14s %9.3f ms/round (no SSE2, scalar build)\n",
+              "spans", spans_simd);
+#endif
+}
+
+} // namespace
+
+// Checks the visibility service's span rasterization and observer count
+// update against the per-cell distance test it replaced, then times all
+// three. Exits non-zero on the first mismatch.
+auto main() -> int {
+  if (!runChecks()) {
+    return 1;
+  }
+  runBench();
+  return 0;
+}